@@ -1,3 +1,10 @@
 export 'src/bluetooth_classic_multiplatform.dart';
 export 'src/model/bluetooth_connection.dart';
 export 'src/model/bluetooth_device.dart';
+export 'src/model/channel_cache_stats.dart';
+export 'src/model/connect_result.dart';
+export 'src/model/connect_timeout_exception.dart';
+export 'src/model/connection_stats.dart';
+export 'src/model/file_transfer_progress.dart';
+export 'src/model/link_state_event.dart';
+export 'src/model/write_timeout_exception.dart';
@@ -1,6 +1,9 @@
 import 'bluetooth_classic_multiplatform_platform_interface.dart';
 import 'model/bluetooth_connection.dart';
 import 'model/bluetooth_device.dart';
+import 'model/channel_cache_stats.dart';
+import 'model/connect_result.dart';
+import 'model/connect_timeout_exception.dart';
 
 class BluetoothClassicMultiplatform {
   final _instance = BluetoothClassicMultiplatformPlatformInterface.instance;
@@ -50,8 +53,98 @@ class BluetoothClassicMultiplatform {
   Future<bool> bondDevice(String address) => _instance.bondDevice(address);
 
   /// Tries to create a connection to the device with the given address.
-  Future<BluetoothConnection?> connect(String address, {String? uuid}) =>
-      _instance.connect(address, uuid: uuid);
+  ///
+  /// On Windows, [readCoalescingWindow] holds received bytes back for up to
+  /// that long so bursts arrive on [BluetoothConnection.input] as one chunk.
+  /// At most [receiveBufferSize] bytes (1 MiB by default) are held for a
+  /// connection; [overflowPolicy] decides what happens beyond that.
+  /// [socketReceiveBufferSize] and [socketSendBufferSize] set the socket's
+  /// SO_RCVBUF and SO_SNDBUF. Given both [writeCoalescingBytes] and
+  /// [writeCoalescingWindow], small writes are merged into buffers of up to
+  /// that many bytes, waiting at most that long for more to arrive.
+  /// [writeRateBytesPerSecond] paces outgoing data for peers that lose
+  /// bytes when fed faster, letting through at most [writeBurstBytes] (10 ms
+  /// worth by default) at once.
+  ///
+  /// On Windows the connect runs off the UI thread. Given a [timeout], it
+  /// throws a [ConnectTimeoutException] once that passed, and
+  /// [cancelConnect] calls it off, which completes it with null.
+  ///
+  /// With [autoReconnect], Windows brings the link back when it drops,
+  /// under the same connection: the first attempt starts at once, later
+  /// ones after [reconnectInitialDelay] (100 ms by default), doubling up to
+  /// [reconnectMaxDelay] (5 s), for [reconnectMaxAttempts] attempts (10;
+  /// 0 for no limit). Writes that had not started wait for the new link.
+  /// [BluetoothConnection.linkStates] reports each step.
+  Future<BluetoothConnection?> connect(
+    String address, {
+    String? uuid,
+    Duration? readCoalescingWindow,
+    int? receiveBufferSize,
+    ReceiveOverflowPolicy? overflowPolicy,
+    int? socketReceiveBufferSize,
+    int? socketSendBufferSize,
+    int? writeCoalescingBytes,
+    Duration? writeCoalescingWindow,
+    int? writeRateBytesPerSecond,
+    int? writeBurstBytes,
+    Duration? timeout,
+    bool? autoReconnect,
+    Duration? reconnectInitialDelay,
+    Duration? reconnectMaxDelay,
+    int? reconnectMaxAttempts,
+  }) => _instance.connect(
+    address,
+    uuid: uuid,
+    readCoalescingWindow: readCoalescingWindow,
+    receiveBufferSize: receiveBufferSize,
+    overflowPolicy: overflowPolicy,
+    socketReceiveBufferSize: socketReceiveBufferSize,
+    socketSendBufferSize: socketSendBufferSize,
+    writeCoalescingBytes: writeCoalescingBytes,
+    writeCoalescingWindow: writeCoalescingWindow,
+    writeRateBytesPerSecond: writeRateBytesPerSecond,
+    writeBurstBytes: writeBurstBytes,
+    timeout: timeout,
+    autoReconnect: autoReconnect,
+    reconnectInitialDelay: reconnectInitialDelay,
+    reconnectMaxDelay: reconnectMaxDelay,
+    reconnectMaxAttempts: reconnectMaxAttempts,
+  );
+
+  /// Connects to every device in [addresses], at most [maxParallel] at a
+  /// time, and reports each on the returned stream as it finishes; the
+  /// stream closes after the last.
+  ///
+  /// Paging many devices at once slows each page down, so a small
+  /// [maxParallel] brings a fleet up faster than connecting to all at
+  /// once. [timeout] limits each device, counted from when its connect
+  /// starts. A device connected already is reported right away, and
+  /// [cancelConnect] skips or calls off that of a single device.
+  Stream<ConnectResult> connectMany(
+    List<String> addresses, {
+    int maxParallel = 4,
+    Duration? timeout,
+    String? uuid,
+  }) => _instance.connectMany(
+    addresses,
+    maxParallel: maxParallel,
+    timeout: timeout,
+    uuid: uuid,
+  );
+
+  /// Calls off a [connect] to [address] that is under way.
+  ///
+  /// Returns false if there is none, or on platforms that cannot cancel
+  /// connects.
+  Future<bool> cancelConnect(String address) =>
+      _instance.cancelConnect(address);
+
+  /// Returns the counters of the cache of the channels devices were last
+  /// reached on, which [connect] tries before looking one up; null on
+  /// platforms without one.
+  Future<ChannelCacheStats?> get channelCacheStats =>
+      _instance.channelCacheStats();
 
   /// Requests to turns the bluetooth adapter on.
   void requestEnable() => _instance.requestEnable();
@@ -62,3 +155,29 @@ enum BluetoothAdapterState { unknown, turningOn, on, turningOff, off }
 
 /// Bonding state on a device
 enum BluetoothBondState { none, bonding, bonded }
+
+/// What a connection does when its receive buffer is full.
+enum ReceiveOverflowPolicy {
+  /// Stop reading, so RFCOMM flow control throttles the remote device.
+  backpressure,
+
+  /// Discard the oldest buffered bytes.
+  dropOldest,
+
+  /// Discard the bytes that do not fit.
+  dropNewest,
+
+  /// Close the connection; the input stream receives an error first.
+  disconnect,
+}
+
+/// Class of a write on a connection.
+enum WritePriority {
+  /// Sent in the order the writes were added.
+  normal,
+
+  /// Sent ahead of every normal write that has not started yet, such as a
+  /// control command behind a bulk upload. A write that started is always
+  /// finished first, so writes never interleave.
+  high,
+}
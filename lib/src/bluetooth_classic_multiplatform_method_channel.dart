@@ -1,4 +1,6 @@
+import 'dart:async';
 import 'dart:io';
+import 'dart:math';
 
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
@@ -7,6 +9,13 @@ import 'bluetooth_classic_multiplatform.dart';
 import 'bluetooth_classic_multiplatform_platform_interface.dart';
 import 'model/bluetooth_connection.dart';
 import 'model/bluetooth_device.dart';
+import 'model/channel_cache_stats.dart';
+import 'model/connect_result.dart';
+import 'model/connect_timeout_exception.dart';
+import 'model/connection_stats.dart';
+import 'model/file_transfer_progress.dart';
+import 'model/link_state_event.dart';
+import 'model/write_timeout_exception.dart';
 
 /// An implementation of [BluetoothClassicMultiplatformPlatformInterface] that uses method channels.
 class BluetoothClassicMultiplatformMethodChannel
@@ -35,6 +44,25 @@ class BluetoothClassicMultiplatformMethodChannel
     "$namespace/scanResults",
   );
 
+  /// The event channel used to get the progress of file transfers
+  @visibleForTesting
+  final EventChannel fileTransferEventChannel = const EventChannel(
+    "$namespace/fileTransfers",
+  );
+
+  /// The event channel used to get the per-device results of connectMany
+  @visibleForTesting
+  final EventChannel connectResultEventChannel = const EventChannel(
+    "$namespace/connectResults",
+  );
+
+  /// The event channel used to get the link changes of connections made
+  /// with autoReconnect
+  @visibleForTesting
+  final EventChannel linkStateEventChannel = const EventChannel(
+    "$namespace/connectionState",
+  );
+
   @override
   Future<bool> isSupported() async =>
       await methodChannel.invokeMethod<bool>("isSupported") ?? false;
@@ -110,19 +138,258 @@ class BluetoothClassicMultiplatformMethodChannel
       : false;
 
   @override
-  Future<BluetoothConnection?> connect(String address, {String? uuid}) async {
-    int? id = await methodChannel.invokeMethod<int>("connect", {
-      "address": address,
-      "uuid": uuid,
-    });
+  Future<BluetoothConnection?> connect(
+    String address, {
+    String? uuid,
+    Duration? readCoalescingWindow,
+    int? receiveBufferSize,
+    ReceiveOverflowPolicy? overflowPolicy,
+    int? socketReceiveBufferSize,
+    int? socketSendBufferSize,
+    int? writeCoalescingBytes,
+    Duration? writeCoalescingWindow,
+    int? writeRateBytesPerSecond,
+    int? writeBurstBytes,
+    Duration? timeout,
+    bool? autoReconnect,
+    Duration? reconnectInitialDelay,
+    Duration? reconnectMaxDelay,
+    int? reconnectMaxAttempts,
+  }) async {
+    int? id;
+    try {
+      id = await methodChannel.invokeMethod<int>("connect", {
+        "address": address,
+        "uuid": uuid,
+        "readCoalescingWindowMicros": readCoalescingWindow?.inMicroseconds,
+        "receiveBufferSize": receiveBufferSize,
+        "overflowPolicy": overflowPolicy?.name,
+        "socketReceiveBufferSize": socketReceiveBufferSize,
+        "socketSendBufferSize": socketSendBufferSize,
+        "writeCoalescingBytes": writeCoalescingBytes,
+        "writeCoalescingWindowMicros": writeCoalescingWindow?.inMicroseconds,
+        "writeRateBytesPerSecond": writeRateBytesPerSecond,
+        "writeBurstBytes": writeBurstBytes,
+        "timeoutMicros": timeout?.inMicroseconds,
+        "autoReconnect": autoReconnect,
+        "reconnectInitialDelayMicros": reconnectInitialDelay?.inMicroseconds,
+        "reconnectMaxDelayMicros": reconnectMaxDelay?.inMicroseconds,
+        "reconnectMaxAttempts": reconnectMaxAttempts,
+      });
+    } on PlatformException catch (e) {
+      if (e.code == "connectTimeout" && timeout != null) {
+        throw ConnectTimeoutException(timeout);
+      }
+      if (e.code == "connectCancelled") return null;
+      rethrow;
+    }
     return id != null
         ? BluetoothConnection.fromConnectionId(id, address)
         : null;
   }
 
+  /// Windows connects on a pool of its own; elsewhere [maxParallel]
+  /// connect calls are kept going at a time.
+  @override
+  Stream<ConnectResult> connectMany(
+    List<String> addresses, {
+    int maxParallel = 4,
+    Duration? timeout,
+    String? uuid,
+  }) {
+    final controller = StreamController<ConnectResult>();
+    controller.onListen = () async {
+      try {
+        if (Platform.isWindows) {
+          final batchId = _nextConnectBatchId++;
+          final subscription = _connectResults
+              .where((event) => event["batchId"] == batchId)
+              .map(ConnectResult.fromMap)
+              .listen(controller.add);
+          try {
+            await methodChannel.invokeMethod<void>("connectMany", {
+              "addresses": addresses,
+              "batchId": batchId,
+              "maxParallel": maxParallel,
+              "timeoutMicros": timeout?.inMicroseconds,
+              "uuid": uuid,
+            });
+          } finally {
+            await subscription.cancel();
+          }
+        } else {
+          var next = 0;
+          Future<void> worker() async {
+            while (next < addresses.length) {
+              final address = addresses[next++];
+              controller.add(await _connectOne(address, timeout, uuid));
+            }
+          }
+
+          final workers = min(max(maxParallel, 1), addresses.length);
+          await Future.wait(List.generate(workers, (_) => worker()));
+        }
+      } catch (e, stackTrace) {
+        controller.addError(e, stackTrace);
+      } finally {
+        await controller.close();
+      }
+    };
+    return controller.stream;
+  }
+
+  Future<ConnectResult> _connectOne(
+    String address,
+    Duration? timeout,
+    String? uuid,
+  ) async {
+    try {
+      final connection = await connect(address, uuid: uuid, timeout: timeout);
+      return ConnectResult(
+        address,
+        connection: connection,
+        error: connection == null ? "connectCancelled" : null,
+      );
+    } on ConnectTimeoutException {
+      return ConnectResult(address, error: "connectTimeout");
+    } on PlatformException catch (e) {
+      return ConnectResult(address, error: e.code);
+    }
+  }
+
+  /// Shared by all calls, like [_fileTransferProgress].
+  late final Stream<Map> _connectResults = connectResultEventChannel
+      .receiveBroadcastStream()
+      .cast<Map>();
+
+  static int _nextConnectBatchId = 1;
+
+  /// Only Windows connects off the UI thread, where a connect can be
+  /// called off.
+  @override
+  Future<bool> cancelConnect(String address) async =>
+      Platform.isWindows &&
+      (await methodChannel.invokeMethod<bool>("cancelConnect", {
+            "address": address,
+          }) ??
+          false);
+
+  /// Windows queues writes per connection; Android sends each on a thread
+  /// of its own.
+  @override
+  bool get keepsWriteOrder => Platform.isWindows;
+
   @override
-  Future<void> write(int id, Uint8List data) {
-    return methodChannel.invokeMethod<void>("write", {"id": id, "bytes": data});
+  Future<void> write(
+    int id,
+    Uint8List data, {
+    WritePriority priority = WritePriority.normal,
+    Duration? timeout,
+  }) async {
+    try {
+      await methodChannel.invokeMethod<void>("write", {
+        "id": id,
+        "bytes": data,
+        "priority": priority.name,
+        "timeoutMicros": timeout?.inMicroseconds,
+      });
+    } on PlatformException catch (e) {
+      if (e.code == "writeTimeout" && timeout != null) {
+        throw WriteTimeoutException(timeout);
+      }
+      rethrow;
+    }
+  }
+
+  /// Elsewhere the batch is written one call at a time.
+  @override
+  Future<void> writeBatch(
+    List<int> ids,
+    List<Uint8List> buffers, {
+    WritePriority priority = WritePriority.normal,
+    Duration? timeout,
+  }) async {
+    if (ids.isEmpty || (ids.length != 1 && ids.length != buffers.length)) {
+      throw ArgumentError("Need one id, or one per buffer");
+    }
+    if (!Platform.isWindows) {
+      for (var i = 0; i < buffers.length; i++) {
+        await write(
+          ids.length == 1 ? ids.first : ids[i],
+          buffers[i],
+          priority: priority,
+          timeout: timeout,
+        );
+      }
+      return;
+    }
+    try {
+      await methodChannel.invokeMethod<void>("writeBatch", {
+        "ids": ids,
+        "buffers": buffers,
+        "priority": priority.name,
+        "timeoutMicros": timeout?.inMicroseconds,
+      });
+    } on PlatformException catch (e) {
+      if (e.code == "writeTimeout" && timeout != null) {
+        throw WriteTimeoutException(timeout);
+      }
+      rethrow;
+    }
+  }
+
+  @override
+  Future<void> sendFile(
+    int id,
+    String path, {
+    required int transferId,
+    int? chunkSize,
+  }) {
+    return methodChannel.invokeMethod<void>("sendFile", {
+      "id": id,
+      "path": path,
+      "transferId": transferId,
+      "chunkSize": chunkSize,
+    });
+  }
+
+  /// Shared by all transfers: every stream of its own would subscribe the
+  /// channel anew, and the first to cancel would end the others.
+  late final Stream<FileTransferProgress> _fileTransferProgress =
+      fileTransferEventChannel.receiveBroadcastStream().map(
+        (event) => FileTransferProgress.fromMap(event),
+      );
+
+  @override
+  Stream<FileTransferProgress> fileTransferProgress() => _fileTransferProgress;
+
+  /// Shared by all connections, like [_fileTransferProgress].
+  late final Stream<LinkStateEvent> _linkStates = linkStateEventChannel
+      .receiveBroadcastStream()
+      .map((event) => LinkStateEvent.fromMap(event));
+
+  /// Only Windows reconnects by itself.
+  @override
+  Stream<LinkStateEvent> linkStates() =>
+      Platform.isWindows ? _linkStates : const Stream.empty();
+
+  @override
+  Future<ConnectionStats> connectionStats(int id) async {
+    final stats = await methodChannel.invokeMapMethod<String, dynamic>(
+      "connectionStats",
+      {"id": id},
+    );
+    return ConnectionStats.fromMap(stats ?? const {});
+  }
+
+  /// Only Windows caches channels.
+  @override
+  Future<ChannelCacheStats?> channelCacheStats() async {
+    if (!Platform.isWindows) return null;
+    final stats = await methodChannel.invokeMapMethod<String, dynamic>(
+      "channelCacheStats",
+    );
+    return stats != null ? ChannelCacheStats.fromMap(stats) : null;
   }
 
   /* Adapter settings and general */
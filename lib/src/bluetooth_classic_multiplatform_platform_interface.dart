@@ -6,6 +6,13 @@ import 'bluetooth_classic_multiplatform.dart';
 import 'bluetooth_classic_multiplatform_method_channel.dart';
 import 'model/bluetooth_connection.dart';
 import 'model/bluetooth_device.dart';
+import 'model/channel_cache_stats.dart';
+import 'model/connect_result.dart';
+import 'model/connect_timeout_exception.dart';
+import 'model/connection_stats.dart';
+import 'model/file_transfer_progress.dart';
+import 'model/link_state_event.dart';
+import 'model/write_timeout_exception.dart';
 
 abstract class BluetoothClassicMultiplatformPlatformInterface
     extends PlatformInterface {
@@ -93,15 +100,134 @@ abstract class BluetoothClassicMultiplatformPlatformInterface
   /// You can also pass the service record uuid to lookup RFCOMM channel. If you do not provide one yourself, the
   /// well-known SPP UUID `00001101-0000-1000-8000-00805F9B34FB` will be used instead. Please make sure the uuid string
   /// is formated as described here: https://developer.android.com/reference/java/util/UUID#toString()
-  Future<BluetoothConnection?> connect(String address, {String? uuid}) {
+  ///
+  /// [readCoalescingWindow] lets the platform batch received bytes for up to
+  /// that long before pushing them to the connection's input stream.
+  /// [receiveBufferSize] bounds the bytes held for the connection and
+  /// [overflowPolicy] decides what happens once they do not fit.
+  /// [socketReceiveBufferSize] and [socketSendBufferSize] override the
+  /// socket's buffer sizes where the platform allows it.
+  /// [writeCoalescingBytes] and [writeCoalescingWindow] let the platform
+  /// merge small writes before sending them.
+  /// [writeRateBytesPerSecond] and [writeBurstBytes] configure a token
+  /// bucket the platform paces outgoing data with. A connect that has not
+  /// finished after [timeout] throws a [ConnectTimeoutException], and one
+  /// called off by [cancelConnect] completes with null. [autoReconnect]
+  /// has the platform bring a dropped link back under the same connection,
+  /// with backoff from [reconnectInitialDelay] up to [reconnectMaxDelay]
+  /// for at most [reconnectMaxAttempts] attempts.
+  Future<BluetoothConnection?> connect(
+    String address, {
+    String? uuid,
+    Duration? readCoalescingWindow,
+    int? receiveBufferSize,
+    ReceiveOverflowPolicy? overflowPolicy,
+    int? socketReceiveBufferSize,
+    int? socketSendBufferSize,
+    int? writeCoalescingBytes,
+    Duration? writeCoalescingWindow,
+    int? writeRateBytesPerSecond,
+    int? writeBurstBytes,
+    Duration? timeout,
+    bool? autoReconnect,
+    Duration? reconnectInitialDelay,
+    Duration? reconnectMaxDelay,
+    int? reconnectMaxAttempts,
+  }) {
     throw UnimplementedError('connect() has not been implemented.');
   }
 
+  /// Connects to each of [addresses], [maxParallel] at a time, each within
+  /// [timeout] from when it starts, and emits the results as they come.
+  Stream<ConnectResult> connectMany(
+    List<String> addresses, {
+    int maxParallel = 4,
+    Duration? timeout,
+    String? uuid,
+  }) {
+    throw UnimplementedError('connectMany() has not been implemented.');
+  }
+
+  /// Calls off the [connect] to [address] under way; false if there is
+  /// none.
+  Future<bool> cancelConnect(String address) {
+    throw UnimplementedError('cancelConnect() has not been implemented.');
+  }
+
+  /// Whether writes issued back to back reach the link in call order.
+  ///
+  /// Only then may a sink issue the next write before the previous one
+  /// completed, which platform side coalescing depends on.
+  bool get keepsWriteOrder => false;
+
   /// Writes [data] to a given connection [id]
-  Future<void> write(int id, Uint8List data) {
+  ///
+  /// Platforms that keep the write order send a [WritePriority.high] write
+  /// ahead of the queued normal ones; others ignore [priority]. Given a
+  /// [timeout], Windows fails the write with a [WriteTimeoutException] if
+  /// it was not handed to the transport by then.
+  Future<void> write(
+    int id,
+    Uint8List data, {
+    WritePriority priority = WritePriority.normal,
+    Duration? timeout,
+  }) {
     throw UnimplementedError('write() has not been implemented.');
   }
 
+  /// Writes each of [buffers] in order, to connection [ids] if it holds a
+  /// single id and to the id at the same index otherwise. Completes once
+  /// all of them were handed to the transport, or fails with the first
+  /// error any of them had.
+  ///
+  /// Windows queues the whole batch in one platform call; [priority] and
+  /// [timeout] apply to every buffer as in [write].
+  Future<void> writeBatch(
+    List<int> ids,
+    List<Uint8List> buffers, {
+    WritePriority priority = WritePriority.normal,
+    Duration? timeout,
+  }) {
+    throw UnimplementedError('writeBatch() has not been implemented.');
+  }
+
+  /// Sends the file at [path] to connection [id] in chunks of [chunkSize]
+  /// bytes, read and queued by the platform itself. Completes once every
+  /// byte was handed to the transport.
+  ///
+  /// Progress is reported on [fileTransferProgress], tagged [transferId].
+  Future<void> sendFile(
+    int id,
+    String path, {
+    required int transferId,
+    int? chunkSize,
+  }) {
+    throw UnimplementedError('sendFile() has not been implemented.');
+  }
+
+  /// Returns an event stream with the progress of every [sendFile] call.
+  Stream<FileTransferProgress> fileTransferProgress() {
+    throw UnimplementedError(
+      'fileTransferProgress() has not been implemented.',
+    );
+  }
+
+  /// Returns an event stream with the link changes of every connection made
+  /// with autoReconnect.
+  Stream<LinkStateEvent> linkStates() {
+    throw UnimplementedError('linkStates() has not been implemented.');
+  }
+
+  /// Returns the counters kept for connection [id].
+  Future<ConnectionStats> connectionStats(int id) {
+    throw UnimplementedError('connectionStats() has not been implemented.');
+  }
+
+  /// Returns the counters of the channel cache; null where there is none.
+  Future<ChannelCacheStats?> channelCacheStats() {
+    throw UnimplementedError('channelCacheStats() has not been implemented.');
+  }
+
   void requestEnable() {
     throw UnimplementedError('requestEnable() has not been implemented.');
   }
@@ -4,8 +4,13 @@ import 'dart:convert';
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
+import '../bluetooth_classic_multiplatform.dart';
 import '../bluetooth_classic_multiplatform_method_channel.dart';
 import '../bluetooth_classic_multiplatform_platform_interface.dart';
+import 'connection_stats.dart';
+import 'file_transfer_progress.dart';
+import 'link_state_event.dart';
+import 'write_timeout_exception.dart';
 
 /// Represents an ongoing Bluetooth connection to a remote device.
 class BluetoothConnection {
@@ -58,6 +63,78 @@ class BluetoothConnection {
   /// Specifies whether the connection is currently open.
   bool get isConnected => output.isConnected;
 
+  /// Returns the counters the platform keeps for this connection.
+  Future<ConnectionStats> stats() =>
+      BluetoothClassicMultiplatformPlatformInterface.instance.connectionStats(
+        _id,
+      );
+
+  /// Drops and recoveries of the link, for a connection made with
+  /// `autoReconnect`; the connection and its [input] stay open meanwhile.
+  Stream<LinkStateEvent> get linkStates =>
+      BluetoothClassicMultiplatformPlatformInterface.instance
+          .linkStates()
+          .where((event) => event.connectionId == _id);
+
+  /// Sends the file at [path] without passing its bytes through Dart: the
+  /// platform maps the file and streams it in chunks of [chunkSize] bytes
+  /// (64 KiB by default), keeping a few queued so the link stays busy.
+  ///
+  /// [onProgress] is called as the chunks go out. Completes once the whole
+  /// file was handed to the transport. Only supported on Windows.
+  Future<void> sendFile(
+    String path, {
+    int? chunkSize,
+    void Function(FileTransferProgress progress)? onProgress,
+  }) async {
+    final platform = BluetoothClassicMultiplatformPlatformInterface.instance;
+    final transferId = _nextTransferId++;
+    final subscription = onProgress != null
+        ? platform
+              .fileTransferProgress()
+              .where((progress) => progress.transferId == transferId)
+              .listen(onProgress)
+        : null;
+    try {
+      await platform.sendFile(
+        _id,
+        path,
+        transferId: transferId,
+        chunkSize: chunkSize,
+      );
+    } finally {
+      await subscription?.cancel();
+    }
+  }
+
+  static int _nextTransferId = 1;
+
+  /// Writes each buffer to its connection in one platform call, instead of
+  /// one call per buffer; worth it for many small frames, possibly spread
+  /// over several links. Buffers for the same connection go out in list
+  /// order.
+  ///
+  /// Completes once every buffer was handed to the transport, or fails with
+  /// the first error, e.g. a [WriteTimeoutException] if [timeout] passed
+  /// first. Unlike [BluetoothStreamSink.add], a failure does not close the
+  /// connections.
+  static Future<void> writeBatch(
+    List<(BluetoothConnection, Uint8List)> writes, {
+    Duration? timeout,
+  }) {
+    if (writes.isEmpty) return Future.value();
+    for (final (connection, _) in writes) {
+      if (!connection.isConnected) {
+        throw StateError("Not connected!");
+      }
+    }
+    return BluetoothClassicMultiplatformPlatformInterface.instance.writeBatch(
+      [for (final (connection, _) in writes) connection._id],
+      [for (final (_, data) in writes) data],
+      timeout: timeout,
+    );
+  }
+
   /// Should be called to make sure the connection is closed and resources are freed (sockets/channels).
   void dispose() => finish();
 
@@ -94,6 +171,22 @@ class BluetoothStreamSink
   /// Chain of features, the variable represents last of the futures.
   Future<void> _chainedFutures = Future.value();
 
+  /// Bytes added but not yet handed to the socket by the platform.
+  ///
+  /// Writes complete as soon as the platform queued them to the transport,
+  /// so this stays small on a fast link and grows while a slow one drains.
+  int get pendingBytes => _pendingBytes;
+  int _pendingBytes = 0;
+
+  /// [addStream] stops reading its stream while [pendingBytes] is above this.
+  int highWaterMark = 256 * 1024;
+
+  /// Time each write added from now on may take to reach the transport;
+  /// unlimited while null, and on platforms other than Windows. A write
+  /// that times out fails with a [WriteTimeoutException], which closes this
+  /// sink like any write error.
+  Duration? writeTimeout;
+
   BluetoothStreamSink(this._id);
 
   /// Adds raw bytes to the output sink.
@@ -111,19 +204,87 @@ class BluetoothStreamSink
       throw StateError("Not connected!");
     }
 
+    _pendingBytes += data.length;
+    // Where the platform keeps the order, the write is issued right away so
+    // it can queue (and coalesce) behind those still in flight; only its
+    // completion is chained.
+    final timeout = writeTimeout;
+    final Future<void>? issued = _instance.keepsWriteOrder
+        ? (_instance.write(_id, data, timeout: timeout)..ignore())
+        : null;
+    _chainedFutures = _chainedFutures
+        .then((_) async {
+          if (issued != null) {
+            await issued;
+            return;
+          }
+          if (!isConnected) {
+            throw StateError("Not connected!");
+          }
+          await _instance.write(_id, data, timeout: timeout);
+        })
+        .whenComplete(() => _pendingBytes -= data.length)
+        .catchError((e) {
+          if (kDebugMode) print(e);
+          close();
+        });
+  }
+
+  /// Adds all of [buffers] at once, as if each was passed to [add], but
+  /// with one platform call for the lot; cheaper than [add] for many small
+  /// frames.
+  ///
+  /// Might throw `StateError("Not connected!")` if not connected.
+  void addBatch(List<Uint8List> buffers) {
+    if (!isConnected) {
+      throw StateError("Not connected!");
+    }
+    if (buffers.isEmpty) return;
+
+    final bytes = buffers.fold<int>(0, (sum, data) => sum + data.length);
+    _pendingBytes += bytes;
+    final timeout = writeTimeout;
+    final Future<void>? issued = _instance.keepsWriteOrder
+        ? (_instance.writeBatch([_id], buffers, timeout: timeout)..ignore())
+        : null;
     _chainedFutures = _chainedFutures
         .then((_) async {
+          if (issued != null) {
+            await issued;
+            return;
+          }
           if (!isConnected) {
             throw StateError("Not connected!");
           }
-          await _instance.write(_id, data);
+          await _instance.writeBatch([_id], buffers, timeout: timeout);
         })
+        .whenComplete(() => _pendingBytes -= bytes)
         .catchError((e) {
           if (kDebugMode) print(e);
           close();
         });
   }
 
+  /// Sends [data] ahead of the added writes the platform has not started
+  /// yet, e.g. a control command while a bulk upload is queued.
+  ///
+  /// Completes once the platform handed [data] to the transport, or fails
+  /// with a [WriteTimeoutException] if that took longer than [timeout].
+  /// Only Windows reorders writes; elsewhere this is an ordinary write.
+  ///
+  /// Might throw `StateError("Not connected!")` if not connected.
+  Future<void> addUrgent(Uint8List data, {Duration? timeout}) {
+    if (!isConnected) {
+      throw StateError("Not connected!");
+    }
+    return _instance.write(
+      _id,
+      data,
+      priority: WritePriority.high,
+      timeout: timeout,
+    );
+  }
+
   /// Unsupported - this output sink cannot pass errors to platform code.
   @override
   void addError(Object error, [StackTrace? stackTrace]) {
@@ -134,9 +295,11 @@ class BluetoothStreamSink
 
   @override
   Future addStream(Stream<Uint8List> stream) => Future(() async {
-    final completer = Completer();
-    stream.listen(add).onDone(completer.complete);
-    await completer.future;
+    await for (final data in stream) {
+      add(data);
+      // Backpressure: let the queued writes drain before reading on.
+      if (_pendingBytes > highWaterMark) await _chainedFutures;
+    }
     await _chainedFutures;
   });
 
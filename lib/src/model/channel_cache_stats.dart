@@ -0,0 +1,30 @@
+/// Counters of the cache that remembers where each device's service was
+/// last reached, so a reconnect can skip finding it anew.
+///
+/// Only kept on Windows.
+class ChannelCacheStats {
+  /// Connects that found a cached channel for the device and service.
+  final int hits;
+
+  /// Connects that had to look the channel up.
+  final int misses;
+
+  /// Cached channels dropped because connecting on them failed.
+  final int invalidations;
+
+  /// Devices and services cached now.
+  final int entries;
+
+  ChannelCacheStats._({
+    required this.hits,
+    required this.misses,
+    required this.invalidations,
+    required this.entries,
+  });
+  factory ChannelCacheStats.fromMap(Map map) => ChannelCacheStats._(
+    hits: map["hits"] ?? 0,
+    misses: map["misses"] ?? 0,
+    invalidations: map["invalidations"] ?? 0,
+    entries: map["entries"] ?? 0,
+  );
+}
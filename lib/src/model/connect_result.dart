@@ -0,0 +1,30 @@
+import 'bluetooth_connection.dart';
+
+/// Outcome of connecting to one device of a `connectMany` call.
+class ConnectResult {
+  /// The device connected to.
+  final String address;
+
+  /// The open connection; null if connecting failed.
+  final BluetoothConnection? connection;
+
+  /// Why connecting failed, such as "couldNotConnect", "connectTimeout",
+  /// "connectCancelled" or "connectInProgress"; null on success.
+  final String? error;
+
+  bool get isConnected => connection != null;
+
+  const ConnectResult(this.address, {this.connection, this.error});
+
+  factory ConnectResult.fromMap(Map map) {
+    final String address = map["address"] ?? "";
+    final int? id = map["id"];
+    return ConnectResult(
+      address,
+      connection: id != null
+          ? BluetoothConnection.fromConnectionId(id, address)
+          : null,
+      error: map["error"],
+    );
+  }
+}
@@ -0,0 +1,14 @@
+/// Thrown by a connect that did not reach the device within its timeout.
+///
+/// Whatever the platform had opened by then is closed again; the device
+/// can be connected to anew right away.
+class ConnectTimeoutException implements Exception {
+  /// The timeout the connect was given.
+  final Duration timeout;
+
+  const ConnectTimeoutException(this.timeout);
+
+  @override
+  String toString() =>
+      "ConnectTimeoutException: connect did not complete within $timeout";
+}
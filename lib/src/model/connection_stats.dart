@@ -0,0 +1,263 @@
+import '../bluetooth_classic_multiplatform.dart';
+
+/// Counters a platform keeps for one `BluetoothConnection`.
+///
+/// Only reported on Windows.
+class ConnectionStats {
+  /// Byte budget of the receive buffer.
+  final int receiveBufferSize;
+
+  /// Bytes received but not yet delivered to the input stream.
+  final int bufferedBytes;
+
+  /// How often received data did not fit into the receive buffer. With
+  /// `ReceiveOverflowPolicy.backpressure` this counts read pauses.
+  final int overflowCount;
+
+  /// Bytes discarded because of the overflow policy.
+  final int droppedBytes;
+
+  /// Size of the next socket read. Grows towards 64 KiB while data streams
+  /// in and shrinks back to 1 KiB when the link quiets down.
+  final int? readSize;
+
+  /// Socket reads so far; `bytesRead / reads` is the average read size.
+  final int? reads;
+
+  /// Bytes read from the socket so far.
+  final int? bytesRead;
+
+  /// Effective SO_RCVBUF of the socket.
+  final int? socketReceiveBufferSize;
+
+  /// Effective SO_SNDBUF of the socket.
+  final int? socketSendBufferSize;
+
+  /// Bytes of accepted writes not yet handed to the socket.
+  final int? queuedWriteBytes;
+
+  /// Accepted writes not yet handed to the socket in full.
+  final int? queuedWrites;
+
+  /// Bytes handed to the socket so far.
+  final int? bytesWritten;
+
+  /// Part of [bytesWritten] sent straight from the write call, without
+  /// being queued.
+  final int? bytesWrittenDirect;
+
+  /// Writes handed to the socket so far.
+  final int? writesCompleted;
+
+  /// Socket send calls so far. Queued writes are gathered, so one call may
+  /// carry several of them.
+  final int? sends;
+
+  /// Writes that went out merged into the buffer of an earlier one.
+  final int? writesMerged;
+
+  /// Times write coalescing held sends back to wait for more writes.
+  final int? writeHolds;
+
+  /// Total latency those holds added, measured at the oldest held write.
+  final Duration? writeHoldTime;
+
+  /// Longest latency a single hold added.
+  final Duration? maxWriteHoldTime;
+
+  /// Configured pace of outgoing data in bytes per second, 0 if unpaced.
+  final int? writeRateLimit;
+
+  /// Configured burst of the pace, 0 if unpaced.
+  final int? writeBurst;
+
+  /// Bytes per second the socket actually took, over the last second of
+  /// sending (or the last burst of writes, if shorter).
+  final int? achievedWriteRate;
+
+  /// Times sending waited for the pace.
+  final int? writeThrottles;
+
+  /// Total time sending waited for the pace.
+  final Duration? writeThrottleTime;
+
+  /// Writes that failed with a `WriteTimeoutException`.
+  final int? writeTimeouts;
+
+  /// Time `connect` took, from looking up the channel to the connected
+  /// socket.
+  final Duration? connectTime;
+
+  /// Part of [connectTime] spent asking the device's SDP server for the
+  /// channel of the service.
+  final Duration? sdpLookupTime;
+
+  /// RFCOMM channel the connection is on.
+  final int? rfcommChannel;
+
+  /// Whether [rfcommChannel] is the one cached from an earlier connect.
+  final bool? channelFromCache;
+
+  /// Whether [rfcommChannel] came from SDP rather than from probing.
+  final bool? channelFromSdp;
+
+  /// Channels `connect` tried before one accepted; several are tried at
+  /// once when SDP has no answer.
+  final int? channelsTried;
+
+  /// Times the link was brought back after it dropped, for a connection
+  /// made with `autoReconnect`.
+  final int? reconnects;
+
+  /// Time from each write call until the platform handed the write to the
+  /// socket, by [WritePriority].
+  final Map<WritePriority, WriteLatencyHistogram>? writeLatency;
+
+  /// Writes per socket send; above 1 once coalescing merges writes.
+  double? get writeMergeRatio {
+    final completed = writesCompleted, merged = writesMerged;
+    if (completed == null || merged == null || completed == merged) {
+      return null;
+    }
+    return completed / (completed - merged);
+  }
+
+  /// Average latency a hold added.
+  Duration? get averageWriteHoldTime {
+    final holds = writeHolds, total = writeHoldTime;
+    if (holds == null || total == null || holds == 0) return null;
+    return total ~/ holds;
+  }
+
+  ConnectionStats._({
+    required this.receiveBufferSize,
+    required this.bufferedBytes,
+    required this.overflowCount,
+    required this.droppedBytes,
+    this.readSize,
+    this.reads,
+    this.bytesRead,
+    this.socketReceiveBufferSize,
+    this.socketSendBufferSize,
+    this.queuedWriteBytes,
+    this.queuedWrites,
+    this.bytesWritten,
+    this.bytesWrittenDirect,
+    this.writesCompleted,
+    this.sends,
+    this.writesMerged,
+    this.writeHolds,
+    this.writeHoldTime,
+    this.maxWriteHoldTime,
+    this.writeRateLimit,
+    this.writeBurst,
+    this.achievedWriteRate,
+    this.writeThrottles,
+    this.writeThrottleTime,
+    this.writeTimeouts,
+    this.connectTime,
+    this.sdpLookupTime,
+    this.rfcommChannel,
+    this.channelFromCache,
+    this.channelFromSdp,
+    this.channelsTried,
+    this.reconnects,
+    this.writeLatency,
+  });
+  factory ConnectionStats.fromMap(Map map) => ConnectionStats._(
+    receiveBufferSize: map["receiveBufferSize"] ?? 0,
+    bufferedBytes: map["bufferedBytes"] ?? 0,
+    overflowCount: map["overflowCount"] ?? 0,
+    droppedBytes: map["droppedBytes"] ?? 0,
+    readSize: map["readSize"],
+    reads: map["reads"],
+    bytesRead: map["bytesRead"],
+    socketReceiveBufferSize: map["socketReceiveBufferSize"],
+    socketSendBufferSize: map["socketSendBufferSize"],
+    queuedWriteBytes: map["queuedWriteBytes"],
+    queuedWrites: map["queuedWrites"],
+    bytesWritten: map["bytesWritten"],
+    bytesWrittenDirect: map["bytesWrittenDirect"],
+    writesCompleted: map["writesCompleted"],
+    sends: map["sends"],
+    writesMerged: map["writesMerged"],
+    writeHolds: map["writeHolds"],
+    writeHoldTime: _micros(map["writeHoldMicros"]),
+    maxWriteHoldTime: _micros(map["maxWriteHoldMicros"]),
+    writeRateLimit: map["writeRateLimit"],
+    writeBurst: map["writeBurst"],
+    achievedWriteRate: map["achievedWriteRate"],
+    writeThrottles: map["writeThrottles"],
+    writeThrottleTime: _micros(map["writeThrottleMicros"]),
+    writeTimeouts: map["writeTimeouts"],
+    connectTime: _micros(map["connectMicros"]),
+    sdpLookupTime: _micros(map["sdpLookupMicros"]),
+    rfcommChannel: map["rfcommChannel"],
+    channelFromCache: map["channelFromCache"],
+    channelFromSdp: map["channelFromSdp"],
+    channelsTried: map["channelsTried"],
+    reconnects: map["reconnects"],
+    writeLatency: _latency(map["writeLatency"]),
+  );
+
+  static Duration? _micros(int? value) =>
+      value != null ? Duration(microseconds: value) : null;
+
+  static Map<WritePriority, WriteLatencyHistogram>? _latency(Map? map) {
+    if (map == null) return null;
+    return {
+      for (final priority in WritePriority.values)
+        if (map[priority.name] is Map)
+          priority: WriteLatencyHistogram.fromMap(map[priority.name]),
+    };
+  }
+}
+
+/// Write latencies in power-of-two buckets: bucket 0 counts latencies below
+/// 1 µs, bucket `i` those from 2^(i-1) µs up to 2^i µs, and the last one
+/// everything longer.
+class WriteLatencyHistogram {
+  /// Writes measured.
+  final int count;
+
+  /// Sum of their latencies.
+  final Duration total;
+
+  /// Longest latency measured.
+  final Duration max;
+
+  /// Writes per bucket.
+  final List<int> buckets;
+
+  /// Average latency, if any write was measured.
+  Duration? get average => count > 0 ? total ~/ count : null;
+
+  /// Upper bound of the bucket that holds the [fraction] percentile, e.g.
+  /// 0.99 for p99; capped at [max].
+  Duration? percentile(double fraction) {
+    if (count == 0) return null;
+    final rank = (count * fraction).ceil().clamp(1, count);
+    var seen = 0;
+    for (var i = 0; i < buckets.length; i++) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        final bound = Duration(microseconds: 1 << i);
+        return bound < max ? bound : max;
+      }
+    }
+    return max;
+  }
+
+  WriteLatencyHistogram._({
+    required this.count,
+    required this.total,
+    required this.max,
+    required this.buckets,
+  });
+  factory WriteLatencyHistogram.fromMap(Map map) => WriteLatencyHistogram._(
+    count: map["count"] ?? 0,
+    total: Duration(microseconds: map["totalMicros"] ?? 0),
+    max: Duration(microseconds: map["maxMicros"] ?? 0),
+    buckets: List<int>.from(map["buckets"] ?? const []),
+  );
+}
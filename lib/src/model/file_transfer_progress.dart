@@ -0,0 +1,25 @@
+/// Progress of one `BluetoothConnection.sendFile` call.
+class FileTransferProgress {
+  /// Identifies the transfer among those running at the same time.
+  final int transferId;
+
+  /// Bytes of the file handed to the socket so far.
+  final int bytesSent;
+
+  /// Size of the file.
+  final int totalBytes;
+
+  /// Share of the file sent, from 0 to 1.
+  double get fraction => totalBytes > 0 ? bytesSent / totalBytes : 1;
+
+  FileTransferProgress._({
+    required this.transferId,
+    required this.bytesSent,
+    required this.totalBytes,
+  });
+  factory FileTransferProgress.fromMap(Map map) => FileTransferProgress._(
+    transferId: map["transferId"] ?? 0,
+    bytesSent: map["bytesSent"] ?? 0,
+    totalBytes: map["totalBytes"] ?? 0,
+  );
+}
@@ -0,0 +1,60 @@
+/// Where a connection made with `autoReconnect` stands after its link
+/// dropped.
+enum LinkState {
+  /// The link dropped; an attempt to bring it back is about to start.
+  reconnecting,
+
+  /// The link is back, under the same connection.
+  connected,
+
+  /// The attempts ran out and the connection is closed.
+  disconnected,
+}
+
+/// A change of the link of a connection made with `autoReconnect`.
+class LinkStateEvent {
+  /// Id of the connection, which the link keeps across reconnects.
+  final int connectionId;
+
+  /// The device the connection is to.
+  final String address;
+
+  final LinkState state;
+
+  /// The attempt about to start while [LinkState.reconnecting], else the
+  /// attempts it took.
+  final int attempts;
+
+  /// Wait before the attempt starts; set while [LinkState.reconnecting].
+  final Duration? delay;
+
+  /// Time from the drop until the link was back; set once
+  /// [LinkState.connected].
+  final Duration? downtime;
+
+  /// Socket error the link dropped with, 0 if the device closed it; not set
+  /// once [LinkState.connected].
+  final int? error;
+
+  LinkStateEvent._({
+    required this.connectionId,
+    required this.address,
+    required this.state,
+    required this.attempts,
+    this.delay,
+    this.downtime,
+    this.error,
+  });
+  factory LinkStateEvent.fromMap(Map map) => LinkStateEvent._(
+    connectionId: map["id"] ?? 0,
+    address: map["address"] ?? "",
+    state: LinkState.values.byName(map["state"]),
+    attempts: map["attempt"] ?? map["attempts"] ?? 0,
+    delay: _micros(map["delayMicros"]),
+    downtime: _micros(map["downtimeMicros"]),
+    error: map["error"],
+  );
+
+  static Duration? _micros(int? value) =>
+      value != null ? Duration(microseconds: value) : null;
+}
@@ -0,0 +1,17 @@
+/// Thrown by a write that was not handed to the transport within its
+/// timeout.
+///
+/// A write that had not started by then was dropped, and the connection
+/// carries on. One that had started means the remote device stopped
+/// reading mid-write; the platform then closes the connection, and every
+/// later write fails too.
+class WriteTimeoutException implements Exception {
+  /// The timeout the write was given.
+  final Duration timeout;
+
+  const WriteTimeoutException(this.timeout);
+
+  @override
+  String toString() =>
+      "WriteTimeoutException: write did not complete within $timeout";
+}
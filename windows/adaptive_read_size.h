@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+namespace bluetooth_classic_multiplatform {
+
+// Picks how many bytes to ask for in the next read of one connection. A read
+// that fills the whole request means more was queued, so the size doubles;
+// a run of reads that come back mostly empty halves it again. Bulk transfers
+// thereby settle on few large reads while an idle or chatty link keeps small
+// buffers.
+class AdaptiveReadSize {
+   public:
+    static constexpr size_t kMinSize = 1024;
+    static constexpr size_t kMaxSize = 64 * 1024;
+
+    // Consecutive small reads before the size is halved.
+    static constexpr int kShrinkAfter = 8;
+
+    size_t current() const { return current_; }
+
+    // Reports that a read of |requested| bytes returned |received|.
+    // Requests capped below current() by the caller only count as growth
+    // hints when they were filled.
+    void OnRead(size_t requested, size_t received) {
+        if (received >= requested) {
+            small_reads_ = 0;
+            if (requested == current_ && current_ < kMaxSize) current_ *= 2;
+            return;
+        }
+        if (requested == current_ && received < current_ / 4) {
+            if (++small_reads_ >= kShrinkAfter && current_ > kMinSize) {
+                current_ /= 2;
+                small_reads_ = 0;
+            }
+            return;
+        }
+        small_reads_ = 0;
+    }
+
+   private:
+    size_t current_ = kMinSize;
+    int small_reads_ = 0;
+};
+
+}  // namespace bluetooth_classic_multiplatform
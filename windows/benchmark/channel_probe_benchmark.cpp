@@ -0,0 +1,137 @@
+// Time connect() needs to find a device's service by probing RFCOMM
+// channels, one at a time (the old ConnectToDevice) against several at
+// once, for services on channels 1 to 30. Each channel before the service
+// stalls until the attempt timeout, as a channel does that the device does
+// not answer on; a stall stands for that timeout, scaled down to
+// kStall so the benchmark runs in seconds.
+//
+// Channels are loopback TCP stand-ins: the service listens on a port, a
+// stalled channel is a socket that never becomes writable.
+//
+// Not part of the plugin build. From the windows/ directory:
+//   g++ -std=c++17 -O2 -I. -Itest benchmark/channel_probe_benchmark.cpp
+//       channel_prober.cpp
+//   cl /std:c++17 /O2 /EHsc /I. /Itest benchmark\channel_probe_benchmark.cpp
+//       channel_prober.cpp ws2_32.lib
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "channel_prober.h"
+#include "socket_pair.h"
+
+namespace {
+
+using bluetooth_classic_multiplatform::CloseNativeSocket;
+using bluetooth_classic_multiplatform::kInvalidNativeSocket;
+using bluetooth_classic_multiplatform::NativeSocket;
+using bluetooth_classic_multiplatform::ProbeChannels;
+using bluetooth_classic_multiplatform::ProbeResult;
+using bluetooth_classic_multiplatform::StartNonBlockingConnect;
+using bluetooth_classic_multiplatform::test::CloseSocket;
+using bluetooth_classic_multiplatform::test::MakeSocketPair;
+using bluetooth_classic_multiplatform::test::SocketPair;
+
+constexpr std::chrono::milliseconds kStall(20);
+
+sockaddr_in Loopback(uint16_t port) {
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    return address;
+}
+
+// A socket whose send buffer is full and whose peer never reads.
+NativeSocket Stalled(std::vector<SocketPair>* pairs) {
+    SocketPair pair;
+    if (!MakeSocketPair(&pair)) {
+        fprintf(stderr, "socket pair failed\n");
+        exit(1);
+    }
+    pairs->push_back(pair);
+#ifdef _WIN32
+    u_long non_blocking = 1;
+    ioctlsocket(pair.plugin_side, FIONBIO, &non_blocking);
+#else
+    fcntl(pair.plugin_side, F_SETFL,
+          fcntl(pair.plugin_side, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    std::vector<char> chunk(64 * 1024, 'x');
+    while (send(pair.plugin_side, chunk.data(),
+                static_cast<int>(chunk.size()), 0) > 0) {
+    }
+    return pair.plugin_side;
+}
+
+// Milliseconds until the service on |service_channel| connected.
+double Run(int service_channel, size_t parallelism) {
+    NativeSocket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address = Loopback(0);
+    socklen_t size = sizeof(address);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), size) != 0 ||
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address),
+                    &size) != 0 ||
+        listen(listener, 4) != 0) {
+        fprintf(stderr, "listen failed\n");
+        exit(1);
+    }
+
+    std::vector<SocketPair> stalled;
+    auto start_connect = [&](int channel, int* error) {
+        if (channel != service_channel) return Stalled(&stalled);
+        NativeSocket connecting = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (!StartNonBlockingConnect(connecting, &address, sizeof(address),
+                                     error)) {
+            CloseNativeSocket(connecting);
+            return kInvalidNativeSocket;
+        }
+        return connecting;
+    };
+    std::vector<int> channels;
+    for (int channel = 1; channel <= 30; ++channel) {
+        channels.push_back(channel);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ProbeResult result =
+        ProbeChannels(channels, parallelism, kStall, start_connect);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (result.channel != service_channel) {
+        fprintf(stderr, "found channel %d\n", result.channel);
+        exit(1);
+    }
+
+    CloseNativeSocket(result.socket);
+    CloseNativeSocket(listener);
+    for (const auto& pair : stalled) {
+        CloseSocket(pair.plugin_side);
+        CloseSocket(pair.peer_side);
+    }
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+}  // namespace
+
+int main() {
+    printf("%lld ms per stalled channel\n",
+           static_cast<long long>(kStall.count()));
+    printf("%-8s %14s %14s %14s\n", "channel", "1 at a time ms",
+           "4 at a time ms", "8 at a time ms");
+    for (int channel : {1, 2, 5, 10, 20, 30}) {
+        printf("%-8d %14.1f %14.1f %14.1f\n", channel, Run(channel, 1),
+               Run(channel, 4), Run(channel, 8));
+    }
+    return 0;
+}
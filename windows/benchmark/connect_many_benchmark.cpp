@@ -0,0 +1,171 @@
+// Time to bring up a fleet of devices with connectMany(): one connect after
+// the other, as Dart issuing connect() calls in turn did, against workers
+// taking the next device off a shared index as RunConnectJob() does.
+//
+// A device is a loopback TCP listener behind a few stalled channels; each
+// stall stands for a page the device does not answer in time, scaled down
+// to kStall so the benchmark runs in seconds. Loopback has no radio to
+// share, so the gain from more workers is the upper bound of what a real
+// adapter gives; it pages fewer devices at once well.
+//
+// Not part of the plugin build. From the windows/ directory:
+//   g++ -std=c++17 -O2 -I. -Itest benchmark/connect_many_benchmark.cpp
+//       channel_prober.cpp -lpthread
+//   cl /std:c++17 /O2 /EHsc /I. /Itest benchmark\connect_many_benchmark.cpp
+//       channel_prober.cpp ws2_32.lib
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "channel_prober.h"
+#include "socket_pair.h"
+
+namespace {
+
+using bluetooth_classic_multiplatform::CloseNativeSocket;
+using bluetooth_classic_multiplatform::kInvalidNativeSocket;
+using bluetooth_classic_multiplatform::NativeSocket;
+using bluetooth_classic_multiplatform::ProbeChannels;
+using bluetooth_classic_multiplatform::ProbeResult;
+using bluetooth_classic_multiplatform::StartNonBlockingConnect;
+using bluetooth_classic_multiplatform::test::CloseSocket;
+using bluetooth_classic_multiplatform::test::MakeSocketPair;
+using bluetooth_classic_multiplatform::test::SocketPair;
+
+constexpr std::chrono::milliseconds kStall(20);
+constexpr int kDevices = 40;
+// Channels that stall before a device's service answers.
+constexpr int kStallsPerDevice = 3;
+
+struct Device {
+    NativeSocket listener = kInvalidNativeSocket;
+    sockaddr_in address = {};
+};
+
+Device Listen() {
+    Device device;
+    device.listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    device.address.sin_family = AF_INET;
+    device.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size = sizeof(device.address);
+    if (bind(device.listener, reinterpret_cast<sockaddr*>(&device.address),
+             size) != 0 ||
+        getsockname(device.listener,
+                    reinterpret_cast<sockaddr*>(&device.address),
+                    &size) != 0 ||
+        listen(device.listener, 4) != 0) {
+        fprintf(stderr, "listen failed\n");
+        exit(1);
+    }
+    return device;
+}
+
+// Guards the stalled sockets, which every worker adds to.
+std::mutex stalled_mutex;
+std::vector<SocketPair> stalled;
+
+// A socket whose send buffer is full and whose peer never reads.
+NativeSocket Stalled() {
+    SocketPair pair;
+    if (!MakeSocketPair(&pair)) {
+        fprintf(stderr, "socket pair failed\n");
+        exit(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(stalled_mutex);
+        stalled.push_back(pair);
+    }
+#ifdef _WIN32
+    u_long non_blocking = 1;
+    ioctlsocket(pair.plugin_side, FIONBIO, &non_blocking);
+#else
+    fcntl(pair.plugin_side, F_SETFL,
+          fcntl(pair.plugin_side, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    std::vector<char> chunk(64 * 1024, 'x');
+    while (send(pair.plugin_side, chunk.data(),
+                static_cast<int>(chunk.size()), 0) > 0) {
+    }
+    return pair.plugin_side;
+}
+
+// One device's connect: the stalled channels, then its service.
+NativeSocket Connect(const Device& device) {
+    auto start_connect = [&device](int channel, int* error) {
+        if (channel <= kStallsPerDevice) return Stalled();
+        NativeSocket connecting = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (!StartNonBlockingConnect(connecting, &device.address,
+                                     sizeof(device.address), error)) {
+            CloseNativeSocket(connecting);
+            return kInvalidNativeSocket;
+        }
+        return connecting;
+    };
+    std::vector<int> channels;
+    for (int channel = 1; channel <= kStallsPerDevice + 1; ++channel) {
+        channels.push_back(channel);
+    }
+    return ProbeChannels(channels, 1, kStall, start_connect).socket;
+}
+
+// Milliseconds until every device connected with |workers| connecting.
+double Run(const std::vector<Device>& devices, size_t workers) {
+    std::vector<NativeSocket> connected(devices.size(), kInvalidNativeSocket);
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (;;) {
+            size_t index = next++;
+            if (index >= devices.size()) return;
+            connected[index] = Connect(devices[index]);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers; ++i) threads.emplace_back(work);
+    for (auto& thread : threads) thread.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    for (NativeSocket socket : connected) {
+        if (socket == kInvalidNativeSocket) {
+            fprintf(stderr, "a device did not connect\n");
+            exit(1);
+        }
+        CloseNativeSocket(socket);
+    }
+    for (const auto& pair : stalled) {
+        CloseSocket(pair.plugin_side);
+        CloseSocket(pair.peer_side);
+    }
+    stalled.clear();
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+}  // namespace
+
+int main() {
+    std::vector<Device> devices;
+    for (int i = 0; i < kDevices; ++i) devices.push_back(Listen());
+    printf("%d devices, %d stalls of %lld ms each\n", kDevices,
+           kStallsPerDevice, static_cast<long long>(kStall.count()));
+    printf("%-8s %12s\n", "workers", "bring-up ms");
+    for (size_t workers : {1, 2, 4, 8, 16}) {
+        printf("%-8zu %12.1f\n", workers, Run(devices, workers));
+    }
+    for (const auto& device : devices) CloseNativeSocket(device.listener);
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Receive-path scaling from 1 to 256 connections: the IoReactor worker pool
+// against one blocking reader thread per connection, which is what the
+// plugin started before the reactor. A fixed set of writer threads plays the
+// remote devices and pushes the same total volume through every run, spread
+// evenly over the connections.
+//
+// Not part of the plugin build. From the windows/ directory:
+//   g++ -std=c++17 -O2 -I. -Itest benchmark/io_reactor_benchmark.cpp
+//       io_reactor_epoll.cpp -lpthread
+//   cl /std:c++17 /O2 /EHsc /I. /Itest benchmark\io_reactor_benchmark.cpp
+//       io_reactor_windows.cpp ws2_32.lib
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "io_reactor.h"
+#include "socket_pair.h"
+
+namespace {
+
+using bluetooth_classic_multiplatform::IoHandler;
+using bluetooth_classic_multiplatform::IoReactor;
+using bluetooth_classic_multiplatform::test::CloseSocket;
+using bluetooth_classic_multiplatform::test::MakeSocketPair;
+using bluetooth_classic_multiplatform::test::SendAll;
+using bluetooth_classic_multiplatform::test::SocketPair;
+
+constexpr size_t kChunkSize = 1024;
+constexpr size_t kTotalBytes = 128 * 1024 * 1024;
+constexpr int kWriterThreads = 4;
+
+struct Result {
+    double megabytes_per_second;
+    size_t receive_threads;
+};
+
+std::vector<SocketPair> MakePairs(int connections) {
+    std::vector<SocketPair> pairs(connections);
+    for (auto& pair : pairs) {
+        if (!MakeSocketPair(&pair)) {
+            fprintf(stderr, "socket pair failed\n");
+            exit(1);
+        }
+    }
+    return pairs;
+}
+
+void ClosePairs(const std::vector<SocketPair>& pairs) {
+    for (const auto& pair : pairs) {
+        CloseSocket(pair.plugin_side);
+        CloseSocket(pair.peer_side);
+    }
+}
+
+// Each writer serves every kWriterThreads-th connection, one chunk at a
+// time in turn, so all connections stay busy for the whole run.
+std::vector<std::thread> StartWriters(const std::vector<SocketPair>& pairs,
+                                      size_t bytes_per_connection) {
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriterThreads; ++w) {
+        writers.emplace_back([&pairs, bytes_per_connection, w]() {
+            const std::vector<char> chunk(kChunkSize, 'x');
+            for (size_t sent = 0; sent < bytes_per_connection;
+                 sent += kChunkSize) {
+                for (size_t i = w; i < pairs.size(); i += kWriterThreads) {
+                    SendAll(pairs[i].peer_side, chunk.data(), kChunkSize);
+                }
+            }
+        });
+    }
+    return writers;
+}
+
+double MegabytesPerSecond(size_t bytes,
+                          std::chrono::steady_clock::duration elapsed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    return bytes / seconds / (1024 * 1024);
+}
+
+Result RunReactor(int connections) {
+    auto pairs = MakePairs(connections);
+    size_t bytes_per_connection = kTotalBytes / connections;
+    std::atomic<size_t> received{0};
+
+    auto reactor = IoReactor::Create();
+    for (const auto& pair : pairs) {
+        IoHandler handler;
+        handler.on_data = [&received](const uint8_t*, size_t size) {
+            received.fetch_add(size, std::memory_order_relaxed);
+        };
+        reactor->Add(pair.plugin_side, std::move(handler));
+    }
+
+    size_t total = bytes_per_connection * connections;
+    auto start = std::chrono::steady_clock::now();
+    auto writers = StartWriters(pairs, bytes_per_connection);
+    while (received.load() < total) std::this_thread::yield();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    for (auto& writer : writers) writer.join();
+
+    Result result{MegabytesPerSecond(total, elapsed),
+                  reactor->worker_count()};
+    for (const auto& pair : pairs) reactor->Remove(pair.plugin_side);
+    reactor.reset();
+    ClosePairs(pairs);
+    return result;
+}
+
+// Baseline: a blocking recv() loop per connection.
+Result RunThreadPerConnection(int connections) {
+    auto pairs = MakePairs(connections);
+    size_t bytes_per_connection = kTotalBytes / connections;
+
+    size_t total = bytes_per_connection * connections;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> readers;
+    for (const auto& pair : pairs) {
+        readers.emplace_back([socket = pair.plugin_side,
+                              bytes_per_connection]() {
+            std::vector<char> buffer(kChunkSize);
+            size_t received = 0;
+            while (received < bytes_per_connection) {
+                int read = static_cast<int>(recv(
+                    socket, buffer.data(), static_cast<int>(kChunkSize), 0));
+                if (read <= 0) break;
+                received += static_cast<size_t>(read);
+            }
+        });
+    }
+    auto writers = StartWriters(pairs, bytes_per_connection);
+    for (auto& reader : readers) reader.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    for (auto& writer : writers) writer.join();
+
+    ClosePairs(pairs);
+    return Result{MegabytesPerSecond(total, elapsed),
+                  static_cast<size_t>(connections)};
+}
+
+}  // namespace
+
+int main() {
+    printf("%-12s %14s %10s %18s %10s\n", "connections", "reactor MB/s",
+           "threads", "thread/conn MB/s", "threads");
+    for (int connections = 1; connections <= 256; connections *= 2) {
+        Result reactor = RunReactor(connections);
+        Result threads = RunThreadPerConnection(connections);
+        printf("%-12d %14.0f %10zu %18.0f %10zu\n", connections,
+               reactor.megabytes_per_second, reactor.receive_threads,
+               threads.megabytes_per_second, threads.receive_threads);
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Receive-path throughput: the old shared map<address, string> behind one
+// mutex against one SpscByteRing per connection. One producer thread per
+// connection stands in for the I/O thread, a single consumer thread stands in
+// for the platform thread draining every connection.
+//
+// Not part of the plugin build. From the windows/ directory:
+//   g++ -std=c++17 -O2 -I. benchmark/receive_buffer_benchmark.cpp -lpthread
+//   cl /std:c++17 /O2 /EHsc /I. benchmark\receive_buffer_benchmark.cpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_byte_ring.h"
+
+namespace {
+
+using bluetooth_classic_multiplatform::SpscByteRing;
+
+constexpr size_t kChunkSize = 1024;
+constexpr size_t kBytesPerConnection = 64 * 1024 * 1024;
+constexpr size_t kRingCapacity = 1 << 20;
+
+std::string AddressFor(int connection) {
+    char address[24];
+    snprintf(address, sizeof(address), "00:11:22:33:44:%02X", connection);
+    return address;
+}
+
+// Baseline: the layout the plugin used before the ring buffers.
+double RunLockedMap(int connections) {
+    std::map<std::string, std::string> received;
+    std::mutex mutex;
+    std::vector<std::string> addresses;
+    for (int i = 0; i < connections; ++i) {
+        addresses.push_back(AddressFor(i));
+        received[addresses.back()];
+    }
+
+    std::atomic<int> running{connections};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (int i = 0; i < connections; ++i) {
+        producers.emplace_back([&, i]() {
+            const std::string chunk(kChunkSize, static_cast<char>(i));
+            for (size_t sent = 0; sent < kBytesPerConnection;
+                 sent += kChunkSize) {
+                std::lock_guard<std::mutex> lock(mutex);
+                received[addresses[i]].append(chunk);
+            }
+            --running;
+        });
+    }
+
+    size_t consumed = 0;
+    const size_t total = kBytesPerConnection * connections;
+    while (consumed < total) {
+        bool idle = true;
+        for (const auto& address : addresses) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::string& data = received[address];
+            if (data.empty()) continue;
+            std::string drained = data;
+            data.clear();
+            consumed += drained.size();
+            idle = false;
+        }
+        if (idle && running > 0) std::this_thread::yield();
+    }
+    for (auto& producer : producers) producer.join();
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return total / elapsed.count() / (1024 * 1024);
+}
+
+double RunSpscRings(int connections) {
+    std::vector<std::unique_ptr<SpscByteRing>> rings;
+    for (int i = 0; i < connections; ++i) {
+        rings.push_back(std::make_unique<SpscByteRing>(kRingCapacity));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (int i = 0; i < connections; ++i) {
+        producers.emplace_back([&, i]() {
+            const std::vector<uint8_t> chunk(kChunkSize,
+                                             static_cast<uint8_t>(i));
+            for (size_t sent = 0; sent < kBytesPerConnection;) {
+                size_t offset = sent % kChunkSize;
+                size_t written = rings[i]->Write(chunk.data() + offset,
+                                                 kChunkSize - offset);
+                // A full ring only happens here because the benchmark
+                // produces faster than a Bluetooth link ever could.
+                if (written == 0) std::this_thread::yield();
+                sent += written;
+            }
+        });
+    }
+
+    size_t consumed = 0;
+    const size_t total = kBytesPerConnection * connections;
+    std::vector<uint8_t> drained;
+    while (consumed < total) {
+        bool idle = true;
+        for (auto& ring : rings) {
+            drained.clear();
+            size_t read = ring->ReadAll(&drained);
+            consumed += read;
+            idle &= read == 0;
+        }
+        if (idle) std::this_thread::yield();
+    }
+    for (auto& producer : producers) producer.join();
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return total / elapsed.count() / (1024 * 1024);
+}
+
+}  // namespace
+
+int main() {
+    printf("%-12s %16s %16s\n", "connections", "map+mutex MB/s",
+           "spsc ring MB/s");
+    for (int connections : {1, 2, 4, 8, 16}) {
+        double locked = RunLockedMap(connections);
+        double rings = RunSpscRings(connections);
+        printf("%-12d %16.0f %16.0f\n", connections, locked, rings);
+    }
+    return 0;
+}
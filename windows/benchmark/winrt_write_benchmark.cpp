@@ -0,0 +1,137 @@
+// Per-write overhead of the WinRT send path for 16 B to 4 KiB payloads,
+// over a loopback StreamSocket. Three ways to hand one write to the
+// socket's output stream:
+//   writer per write - the old WriteData: a DataWriter created, filled,
+//                      stored and detached for every write,
+//   kept writer      - one DataWriter for the whole run, WriteBytes() and
+//                      StoreAsync() per write,
+//   pooled buffer    - what SendLoop does now: the bytes copied into a
+//                      Buffer allocated once, sent with WriteAsync().
+// Reports microseconds per write; the peer reads on its own thread.
+//
+// Not part of the plugin build. From the windows/ directory:
+//   cl /std:c++17 /await /EHsc /O2 /I. benchmark\winrt_write_benchmark.cpp
+//       windowsapp.lib
+
+#include <windows.h>
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Networking.Sockets.h>
+#include <winrt/Windows.Networking.h>
+#include <winrt/Windows.Storage.Streams.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using winrt::Windows::Networking::HostName;
+using winrt::Windows::Networking::Sockets::StreamSocket;
+using winrt::Windows::Networking::Sockets::StreamSocketListener;
+using winrt::Windows::Storage::Streams::Buffer;
+using winrt::Windows::Storage::Streams::DataWriter;
+using winrt::Windows::Storage::Streams::InputStreamOptions;
+
+constexpr size_t kTotalBytes = 16 * 1024 * 1024;
+constexpr size_t kMaxWrites = 200000;
+
+enum class Method { kWriterPerWrite, kKeptWriter, kPooledBuffer };
+
+struct Loopback {
+    StreamSocketListener listener;
+    StreamSocket client;
+    StreamSocket server{nullptr};
+};
+
+void Connect(Loopback& loopback) {
+    winrt::handle accepted(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+    loopback.listener.ConnectionReceived(
+        [&](const StreamSocketListener&, const auto& args) {
+            loopback.server = args.Socket();
+            SetEvent(accepted.get());
+        });
+    // An empty service name picks a free port.
+    loopback.listener.BindServiceNameAsync(L"").get();
+    loopback.client
+        .ConnectAsync(HostName(L"127.0.0.1"),
+                      loopback.listener.Information().LocalPort())
+        .get();
+    WaitForSingleObject(accepted.get(), INFINITE);
+}
+
+double Run(Method method, size_t payload_size) {
+    Loopback loopback;
+    Connect(loopback);
+
+    size_t writes = std::min(kTotalBytes / payload_size, kMaxWrites);
+    size_t total = writes * payload_size;
+    std::thread reader([&]() {
+        winrt::init_apartment();
+        auto input = loopback.server.InputStream();
+        Buffer buffer(64 * 1024);
+        size_t received = 0;
+        while (received < total) {
+            auto read = input
+                            .ReadAsync(buffer, buffer.Capacity(),
+                                       InputStreamOptions::Partial)
+                            .get();
+            if (read.Length() == 0) break;
+            received += read.Length();
+        }
+    });
+
+    std::vector<uint8_t> payload(payload_size, 'x');
+    winrt::array_view<const uint8_t> bytes(
+        payload.data(), static_cast<uint32_t>(payload.size()));
+    auto output = loopback.client.OutputStream();
+    DataWriter kept_writer(output);
+    Buffer buffer(64 * 1024);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < writes; ++i) {
+        if (method == Method::kWriterPerWrite) {
+            DataWriter writer(output);
+            writer.WriteBytes(bytes);
+            writer.StoreAsync().get();
+            writer.DetachStream();
+        } else if (method == Method::kKeptWriter) {
+            kept_writer.WriteBytes(bytes);
+            kept_writer.StoreAsync().get();
+        } else {
+            memcpy(buffer.data(), payload.data(), payload.size());
+            buffer.Length(static_cast<uint32_t>(payload.size()));
+            output.WriteAsync(buffer).get();
+        }
+    }
+    reader.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    kept_writer.DetachStream();
+    loopback.client.Close();
+    loopback.server.Close();
+    loopback.listener.Close();
+
+    double micros =
+        std::chrono::duration<double, std::micro>(elapsed).count();
+    return micros / writes;
+}
+
+}  // namespace
+
+int main() {
+    winrt::init_apartment();
+    printf("%-10s %18s %16s %18s\n", "payload", "writer/write us",
+           "kept writer us", "pooled buffer us");
+    for (size_t size = 16; size <= 4096; size *= 4) {
+        double per_write = Run(Method::kWriterPerWrite, size);
+        double kept = Run(Method::kKeptWriter, size);
+        double pooled = Run(Method::kPooledBuffer, size);
+        printf("%-10zu %18.2f %16.2f %18.2f\n", size, per_write, kept,
+               pooled);
+    }
+    return 0;
+}
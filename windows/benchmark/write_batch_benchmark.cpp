@@ -0,0 +1,235 @@
+// Cost per frame of N small writes issued as N "write" calls against one
+// "writeBatch" call carrying all N, from the caller's thread to the peer
+// socket. Each call takes the method channel's path: encoded on the Dart
+// thread, handed to the platform thread, decoded and queued there, and its
+// reply encoded and handed back once the transport took the bytes. The
+// engine's codec and thread hop are stood in for by a byte-stream encoding
+// of the same shape and a mailbox per thread.
+//
+// Not part of the plugin build. From the windows/ directory:
+//   g++ -std=c++17 -O2 -I. -Itest benchmark/write_batch_benchmark.cpp
+//       io_reactor_epoll.cpp write_queue.cpp -lpthread
+//   cl /std:c++17 /O2 /EHsc /I. /Itest benchmark\write_batch_benchmark.cpp
+//       io_reactor_windows.cpp write_queue.cpp ws2_32.lib
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "io_reactor.h"
+#include "socket_pair.h"
+#include "write_queue.h"
+
+namespace {
+
+using bluetooth_classic_multiplatform::IoReactor;
+using bluetooth_classic_multiplatform::WriteQueue;
+using bluetooth_classic_multiplatform::test::CloseSocket;
+using bluetooth_classic_multiplatform::test::MakeSocketPair;
+using bluetooth_classic_multiplatform::test::SocketPair;
+
+constexpr size_t kFrameSize = 32;
+constexpr size_t kFrames = 256 * 1024;
+
+// Stand-in for flutter::EncodableValue, as in write_path_benchmark.
+using Boxed = std::variant<std::monostate, bool, int32_t, int64_t, double,
+                           std::string, std::vector<uint8_t>>;
+
+// Tasks posted to a thread, run in order by that thread.
+class Mailbox {
+   public:
+    void Post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        ready_.notify_one();
+    }
+
+    // Runs the next task; false once Stop() was posted.
+    bool RunOne() {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this]() { return !tasks_.empty(); });
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        if (!task) return false;
+        task();
+        return true;
+    }
+
+    void Stop() { Post(nullptr); }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::function<void()>> tasks_;
+};
+
+// A call as the codec puts it on the wire: the method name, the connection
+// id, then each buffer with its length.
+std::vector<uint8_t> EncodeCall(const std::string& method, int64_t id,
+                                const std::vector<const uint8_t*>& frames) {
+    std::vector<uint8_t> message;
+    auto put = [&message](const void* data, size_t size) {
+        auto bytes = static_cast<const uint8_t*>(data);
+        message.insert(message.end(), bytes, bytes + size);
+    };
+    uint32_t size = static_cast<uint32_t>(method.size());
+    put(&size, sizeof(size));
+    put(method.data(), method.size());
+    put(&id, sizeof(id));
+    uint32_t count = static_cast<uint32_t>(frames.size());
+    put(&count, sizeof(count));
+    for (const uint8_t* frame : frames) {
+        size = kFrameSize;
+        put(&size, sizeof(size));
+        put(frame, kFrameSize);
+    }
+    return message;
+}
+
+// Decodes into boxed values, as the codec does: the name, the id, then one
+// value per buffer.
+std::vector<Boxed> DecodeCall(const std::vector<uint8_t>& message) {
+    std::vector<Boxed> values;
+    size_t offset = 0;
+    auto get = [&](void* data, size_t size) {
+        memcpy(data, message.data() + offset, size);
+        offset += size;
+    };
+    uint32_t size = 0;
+    get(&size, sizeof(size));
+    values.emplace_back(std::string(
+        reinterpret_cast<const char*>(message.data() + offset), size));
+    offset += size;
+    int64_t id = 0;
+    get(&id, sizeof(id));
+    values.emplace_back(id);
+    uint32_t count = 0;
+    get(&count, sizeof(count));
+    for (uint32_t i = 0; i < count; ++i) {
+        get(&size, sizeof(size));
+        values.emplace_back(std::vector<uint8_t>(
+            message.begin() + offset, message.begin() + offset + size));
+        offset += size;
+    }
+    return values;
+}
+
+// The reply envelope of a successful call; decoding it is a check of its
+// first byte.
+std::vector<uint8_t> EncodeReply() { return std::vector<uint8_t>{0, 0}; }
+
+// Returns microseconds per frame for |kFrames| frames sent |batch| at a
+// time, as one call per frame or one call per batch.
+double Run(size_t batch, bool batched) {
+    SocketPair pair;
+    if (!MakeSocketPair(&pair)) {
+        fprintf(stderr, "socket pair failed\n");
+        exit(1);
+    }
+    auto reactor = IoReactor::Create();
+    auto queue = std::make_shared<WriteQueue>();
+    reactor->AddWriter(pair.plugin_side, queue);
+
+    size_t total = kFrames / batch * batch * kFrameSize;
+    std::thread reader([&]() {
+        std::vector<char> buffer(64 * 1024);
+        size_t received = 0;
+        while (received < total) {
+            auto read = recv(pair.peer_side, buffer.data(),
+                             static_cast<int>(buffer.size()), 0);
+            if (read <= 0) break;
+            received += static_cast<size_t>(read);
+        }
+    });
+
+    Mailbox platform_thread;
+    Mailbox dart_thread;
+    std::thread platform([&platform_thread]() {
+        while (platform_thread.RunOne()) {
+        }
+    });
+
+    // The plugin side of a call: queue every buffer it carries, and reply
+    // once the last of them was sent.
+    auto handle_call = [&](const std::vector<uint8_t>& message) {
+        std::vector<Boxed> values = DecodeCall(message);
+        size_t buffers = values.size() - 2;
+        auto left = std::make_shared<std::atomic<size_t>>(buffers);
+        bool flush = false;
+        for (size_t i = 2; i < values.size(); ++i) {
+            const auto& bytes = std::get<std::vector<uint8_t>>(values[i]);
+            std::vector<uint8_t> copy = queue->TakeBuffer();
+            copy.assign(bytes.begin(), bytes.end());
+            flush |= queue->Push(std::move(copy), [&, left](int) {
+                if (--*left != 0) return;
+                platform_thread.Post([&dart_thread]() {
+                    auto reply = EncodeReply();
+                    dart_thread.Post([reply]() {
+                        if (reply[0] != 0) abort();
+                    });
+                });
+            });
+        }
+        if (flush) reactor->Flush(pair.plugin_side);
+    };
+
+    std::vector<uint8_t> frame(kFrameSize, 'x');
+    auto start = std::chrono::steady_clock::now();
+    for (size_t sent = 0; sent + batch <= kFrames; sent += batch) {
+        // Like BluetoothStreamSink, calls are issued back to back and their
+        // replies awaited after.
+        size_t calls = batched ? 1 : batch;
+        for (size_t i = 0; i < calls; ++i) {
+            std::vector<const uint8_t*> frames(batched ? batch : 1,
+                                               frame.data());
+            auto message = std::make_shared<std::vector<uint8_t>>(
+                EncodeCall(batched ? "writeBatch" : "write", 1, frames));
+            platform_thread.Post([&, message]() { handle_call(*message); });
+        }
+        for (size_t i = 0; i < calls; ++i) dart_thread.RunOne();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    reader.join();
+
+    platform_thread.Stop();
+    platform.join();
+    reactor->Remove(pair.plugin_side);
+    reactor.reset();
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+
+    double micros = std::chrono::duration<double, std::micro>(elapsed).count();
+    return micros / (total / kFrameSize);
+}
+
+}  // namespace
+
+int main() {
+    printf("%zu B frames\n", kFrameSize);
+    printf("%-8s %18s %18s %8s\n", "N", "N writes us/frame",
+           "1 batch us/frame", "speedup");
+    for (size_t batch = 1; batch <= 1024; batch *= 4) {
+        double single = Run(batch, false);
+        double batched = Run(batch, true);
+        printf("%-8zu %18.3f %18.3f %7.1fx\n", batch, single, batched,
+               single / batched);
+    }
+    return 0;
+}
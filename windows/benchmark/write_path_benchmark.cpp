@@ -0,0 +1,142 @@
+// Write-path throughput for 64 B to 64 KiB payloads, from the caller's
+// thread to the peer socket. Three ways for a payload to reach the write
+// queue:
+//   boxed list - the old WriteData: an EncodableList of boxed ints decoded
+//                one element at a time into a fresh vector,
+//   copy       - the Uint8List bytes copied into the queue,
+//   direct     - the bytes sent straight from the caller's buffer while the
+//                queue is idle, only the part the socket did not take is
+//                copied.
+// Like BluetoothStreamSink, the caller keeps at most 256 KiB in flight.
+//
+// Not part of the plugin build. From the windows/ directory:
+//   g++ -std=c++17 -O2 -I. -Itest benchmark/write_path_benchmark.cpp
+//       io_reactor_epoll.cpp write_queue.cpp -lpthread
+//   cl /std:c++17 /O2 /EHsc /I. /Itest benchmark\write_path_benchmark.cpp
+//       io_reactor_windows.cpp write_queue.cpp ws2_32.lib
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "io_reactor.h"
+#include "socket_pair.h"
+#include "write_queue.h"
+
+namespace {
+
+using bluetooth_classic_multiplatform::IoReactor;
+using bluetooth_classic_multiplatform::NativeSocket;
+using bluetooth_classic_multiplatform::WriteQueue;
+using bluetooth_classic_multiplatform::test::CloseSocket;
+using bluetooth_classic_multiplatform::test::MakeSocketPair;
+using bluetooth_classic_multiplatform::test::SocketPair;
+
+constexpr size_t kTotalBytes = 64 * 1024 * 1024;
+constexpr size_t kMaxInFlight = 256 * 1024;
+
+// Stand-in for flutter::EncodableValue: a variant the size of the real one,
+// so a boxed list costs what it does behind the codec.
+using Boxed = std::variant<std::monostate, bool, int32_t, int64_t, double,
+                           std::string, std::vector<uint8_t>>;
+
+enum class Path { kBoxedList, kCopy, kDirect };
+
+size_t SendAvailable(NativeSocket socket, const uint8_t* data, size_t size) {
+    auto sent = send(socket, reinterpret_cast<const char*>(data),
+                     static_cast<int>(size), 0);
+    return sent > 0 ? static_cast<size_t>(sent) : 0;
+}
+
+double Run(Path path, size_t payload_size) {
+    SocketPair pair;
+    if (!MakeSocketPair(&pair)) {
+        fprintf(stderr, "socket pair failed\n");
+        exit(1);
+    }
+    auto reactor = IoReactor::Create();
+    auto queue = std::make_shared<WriteQueue>();
+    reactor->AddWriter(pair.plugin_side, queue);
+
+    std::vector<uint8_t> payload(payload_size, 'x');
+    std::vector<Boxed> boxed(payload_size, Boxed(int32_t{'x'}));
+
+    size_t writes = kTotalBytes / payload_size;
+    size_t total = writes * payload_size;
+    std::thread reader([&]() {
+        std::vector<char> buffer(64 * 1024);
+        size_t received = 0;
+        while (received < total) {
+            auto read = recv(pair.peer_side, buffer.data(),
+                             static_cast<int>(buffer.size()), 0);
+            if (read <= 0) break;
+            received += static_cast<size_t>(read);
+        }
+    });
+
+    std::atomic<size_t> in_flight{0};
+    auto on_sent = [&in_flight, payload_size](int) {
+        in_flight.fetch_sub(payload_size, std::memory_order_relaxed);
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < writes; ++i) {
+        while (in_flight.load(std::memory_order_relaxed) >= kMaxInFlight) {
+            std::this_thread::yield();
+        }
+        in_flight.fetch_add(payload_size, std::memory_order_relaxed);
+
+        bool flush = false;
+        if (path == Path::kBoxedList) {
+            std::vector<uint8_t> data;
+            data.reserve(boxed.size());
+            for (const auto& value : boxed) {
+                if (const auto* byte = std::get_if<int32_t>(&value)) {
+                    data.push_back(static_cast<uint8_t>(*byte));
+                }
+            }
+            flush = queue->Push(std::move(data), on_sent);
+        } else if (path == Path::kDirect &&
+                   queue->BeginDirectSend(payload_size)) {
+            const uint8_t* data = payload.data();
+            size_t sent = SendAvailable(pair.plugin_side, data, payload_size);
+            flush = queue->EndDirectSend(
+                sent,
+                std::vector<uint8_t>(data + sent, data + payload_size),
+                on_sent);
+        } else {
+            flush = queue->Push(payload, on_sent);
+        }
+        if (flush) reactor->Flush(pair.plugin_side);
+    }
+    reader.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    reactor->Remove(pair.plugin_side);
+    reactor.reset();
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    return total / seconds / (1024 * 1024);
+}
+
+}  // namespace
+
+int main() {
+    printf("%-10s %16s %10s %12s\n", "payload", "boxed list MB/s",
+           "copy MB/s", "direct MB/s");
+    for (size_t size = 64; size <= 64 * 1024; size *= 4) {
+        double boxed = Run(Path::kBoxedList, size);
+        double copy = Run(Path::kCopy, size);
+        double direct = Run(Path::kDirect, size);
+        printf("%-10zu %16.0f %10.0f %12.0f\n", size, boxed, copy, direct);
+    }
+    return 0;
+}
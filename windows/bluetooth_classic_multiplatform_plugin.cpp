@@ -3,6 +3,7 @@
 // This must be included before many other Windows headers.
 #include <bluetoothapis.h>
 #include <flutter/event_channel.h>
+#include <flutter/event_stream_handler_functions.h>
 #include <flutter/method_channel.h>
 #include <flutter/plugin_registrar_windows.h>
 #include <flutter/standard_method_codec.h>
@@ -10,8 +11,17 @@
 #include <windows.h>
 #include <ws2bth.h>
 
+#include <algorithm>
+#include <climits>
+#include <filesystem>
 #include <memory>
 #include <sstream>
+#include <utility>
+
+#include "channel_cache.h"
+#include "channel_prober.h"
+#include "file_transfer.h"
+#include "mapped_file.h"
 
 namespace bluetooth_classic_multiplatform {
 
@@ -19,6 +29,293 @@ using namespace flutter;
 
 const std::string TAG = "bluetooth_classic_multiplatform";
 
+// Receive buffer budget per connection unless connect() asks otherwise.
+constexpr size_t kDefaultReceiveBufferSize = 1 << 20;
+constexpr size_t kMinReceiveBufferSize = 4 * 1024;
+constexpr size_t kMaxReceiveBufferSize = 64 * 1024 * 1024;
+
+// Chunk size of sendFile() unless the call names one, and the most it may.
+constexpr size_t kDefaultFileChunkSize = 64 * 1024;
+constexpr size_t kMaxFileChunkSize = 16 * 1024 * 1024;
+
+// Service looked up unless connect() names one: the Serial Port Profile.
+constexpr char kSerialPortServiceUuid[] =
+    "00001101-0000-1000-8000-00805F9B34FB";
+// RFCOMM channels probed when SDP has no answer, and how many at a time;
+// the stack pages the device once for all of them.
+constexpr int kMaxRfcommChannel = 30;
+constexpr size_t kProbeParallelism = 4;
+// A connect that has not finished by then counts as refused; about twice
+// the default page timeout.
+constexpr std::chrono::milliseconds kConnectAttemptTimeout(10000);
+
+namespace {
+
+// The codec decodes Dart ints as either 32 or 64 bit depending on their
+// value.
+bool GetInt(const flutter::EncodableValue& encoded, int64_t* value) {
+    if (const auto* value32 = std::get_if<int32_t>(&encoded)) {
+        *value = *value32;
+        return true;
+    }
+    if (const auto* value64 = std::get_if<int64_t>(&encoded)) {
+        *value = *value64;
+        return true;
+    }
+    return false;
+}
+
+// Reads an optional integer argument.
+bool GetIntArgument(const flutter::EncodableValue* arguments, const char* key,
+                    int64_t* value) {
+    const auto* args = std::get_if<flutter::EncodableMap>(arguments);
+    if (!args) return false;
+    auto it = args->find(flutter::EncodableValue(key));
+    if (it == args->end()) return false;
+    return GetInt(it->second, value);
+}
+
+// Reads an optional bool argument.
+bool GetBoolArgument(const flutter::EncodableValue* arguments, const char* key,
+                     bool* value) {
+    const auto* args = std::get_if<flutter::EncodableMap>(arguments);
+    if (!args) return false;
+    auto it = args->find(flutter::EncodableValue(key));
+    if (it == args->end()) return false;
+    const auto* flag = std::get_if<bool>(&it->second);
+    if (!flag) return false;
+    *value = *flag;
+    return true;
+}
+
+const std::string* GetStringArgument(const flutter::EncodableValue* arguments,
+                                     const char* key) {
+    const auto* args = std::get_if<flutter::EncodableMap>(arguments);
+    if (!args) return nullptr;
+    auto it = args->find(flutter::EncodableValue(key));
+    if (it == args->end()) return nullptr;
+    return std::get_if<std::string>(&it->second);
+}
+
+void SetSocketBufferSize(SOCKET sock, int option, int size) {
+    if (size <= 0) return;
+    if (setsockopt(sock, SOL_SOCKET, option,
+                   reinterpret_cast<const char*>(&size), sizeof(size)) != 0) {
+        char error_msg[256];
+        sprintf_s(error_msg,
+                  "ConnectToDevice: Setting socket buffer size failed with "
+                  "error %d\n",
+                  WSAGetLastError());
+        fprintf(stderr, "%s", error_msg);
+    }
+}
+
+// |file_name| in the plugin's folder under %LOCALAPPDATA%, or in the
+// working directory if that is not set.
+std::filesystem::path GetChannelCachePath(const wchar_t* file_name) {
+    wchar_t local_app_data[MAX_PATH];
+    DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", local_app_data,
+                                           MAX_PATH);
+    if (length == 0 || length >= MAX_PATH) return file_name;
+    return std::filesystem::path(local_app_data) /
+           L"bluetooth_classic_multiplatform" / file_name;
+}
+
+// Parses a UUID in the form 00001101-0000-1000-8000-00805F9B34FB.
+bool ParseUuid(const std::string& text, GUID* guid) {
+    unsigned int parts[11];
+    if (text.size() != 36 ||
+        sscanf_s(text.c_str(), "%8x-%4x-%4x-%2x%2x-%2x%2x%2x%2x%2x%2x",
+                 &parts[0], &parts[1], &parts[2], &parts[3], &parts[4],
+                 &parts[5], &parts[6], &parts[7], &parts[8], &parts[9],
+                 &parts[10]) != 11) {
+        return false;
+    }
+    guid->Data1 = parts[0];
+    guid->Data2 = static_cast<unsigned short>(parts[1]);
+    guid->Data3 = static_cast<unsigned short>(parts[2]);
+    for (int i = 0; i < 8; ++i) {
+        guid->Data4[i] = static_cast<unsigned char>(parts[3 + i]);
+    }
+    return true;
+}
+
+// Asks the SDP server of the device at |address| for the RFCOMM channel of
+// |service|. Returns false with |error| set if it has none or cannot be
+// reached.
+bool LookupRfcommChannel(BTH_ADDR address, const GUID& service, int* channel,
+                         int* error) {
+    SOCKADDR_BTH device = {0};
+    device.addressFamily = AF_BTH;
+    device.btAddr = address;
+    wchar_t context[64];
+    DWORD context_size = ARRAYSIZE(context);
+    if (WSAAddressToStringW(reinterpret_cast<SOCKADDR*>(&device),
+                            sizeof(device), nullptr, context,
+                            &context_size) != 0) {
+        *error = WSAGetLastError();
+        return false;
+    }
+
+    WSAQUERYSETW query = {0};
+    query.dwSize = sizeof(query);
+    query.lpServiceClassId = const_cast<GUID*>(&service);
+    query.dwNameSpace = NS_BTH;
+    query.lpszContext = context;
+    HANDLE lookup = nullptr;
+    // LUP_FLUSHCACHE queries the device instead of the stack's cache of
+    // earlier lookups.
+    if (WSALookupServiceBeginW(&query, LUP_FLUSHCACHE | LUP_RETURN_ADDR,
+                               &lookup) != 0) {
+        *error = WSAGetLastError();
+        return false;
+    }
+    // Backing store for the result set, aligned like WSAQUERYSETW.
+    std::vector<uint64_t> storage(512);
+    auto* results = reinterpret_cast<WSAQUERYSETW*>(storage.data());
+    DWORD size = static_cast<DWORD>(storage.size() * sizeof(uint64_t));
+    bool found = false;
+    if (WSALookupServiceNextW(lookup, LUP_RETURN_ADDR, &size, results) != 0) {
+        *error = WSAGetLastError();
+    } else if (results->dwNumberOfCsAddrs > 0) {
+        const auto* remote = reinterpret_cast<const SOCKADDR_BTH*>(
+            results->lpcsaBuffer[0].RemoteAddr.lpSockaddr);
+        *channel = static_cast<int>(remote->port);
+        found = *channel > 0 && *channel <= kMaxRfcommChannel;
+        if (!found) *error = WSASERVICE_NOT_FOUND;
+    } else {
+        *error = WSASERVICE_NOT_FOUND;
+    }
+    WSALookupServiceEnd(lookup);
+    return found;
+}
+
+int GetSocketBufferSize(SOCKET sock, int option) {
+    int size = 0;
+    int length = sizeof(size);
+    if (getsockopt(sock, SOL_SOCKET, option, reinterpret_cast<char*>(&size),
+                   &length) != 0) {
+        return 0;
+    }
+    return size;
+}
+
+// As Dart's WriteLatencyHistogram.fromMap() reads it.
+flutter::EncodableMap EncodeLatencyHistogram(
+    const WriteLatencyHistogram& histogram) {
+    flutter::EncodableList buckets;
+    for (uint64_t count : histogram.buckets) {
+        buckets.push_back(flutter::EncodableValue(static_cast<int64_t>(count)));
+    }
+    return flutter::EncodableMap{
+        {flutter::EncodableValue("count"),
+         flutter::EncodableValue(static_cast<int64_t>(histogram.count))},
+        {flutter::EncodableValue("totalMicros"),
+         flutter::EncodableValue(
+             static_cast<int64_t>(histogram.total.count()))},
+        {flutter::EncodableValue("maxMicros"),
+         flutter::EncodableValue(static_cast<int64_t>(histogram.max.count()))},
+        {flutter::EncodableValue("buckets"),
+         flutter::EncodableValue(std::move(buckets))},
+    };
+}
+
+const std::string* GetAddressArgument(
+    const flutter::EncodableValue* arguments) {
+    return GetStringArgument(arguments, "address");
+}
+
+// Uint8List arguments arrive as std::vector<uint8_t>.
+const std::vector<uint8_t>* GetBytesArgument(
+    const flutter::EncodableValue* arguments, const char* key) {
+    const auto* args = std::get_if<flutter::EncodableMap>(arguments);
+    if (!args) return nullptr;
+    auto it = args->find(flutter::EncodableValue(key));
+    if (it == args->end()) return nullptr;
+    return std::get_if<std::vector<uint8_t>>(&it->second);
+}
+
+const flutter::EncodableList* GetListArgument(
+    const flutter::EncodableValue* arguments, const char* key) {
+    const auto* args = std::get_if<flutter::EncodableMap>(arguments);
+    if (!args) return nullptr;
+    auto it = args->find(flutter::EncodableValue(key));
+    if (it == args->end()) return nullptr;
+    return std::get_if<flutter::EncodableList>(&it->second);
+}
+
+// Reads the optional "priority" and "timeoutMicros" of "write" and
+// "writeBatch". Returns the message to fail the call with if one is
+// invalid, nullptr otherwise.
+const char* GetWriteOptions(const flutter::EncodableValue* arguments,
+                            WritePriority* priority,
+                            std::chrono::microseconds* timeout) {
+    const auto* priority_name = GetStringArgument(arguments, "priority");
+    if (priority_name && !ParseWritePriority(*priority_name, priority)) {
+        return "Unknown priority";
+    }
+    int64_t timeout_micros = 0;
+    GetIntArgument(arguments, "timeoutMicros", &timeout_micros);
+    if (timeout_micros < 0) return "timeout must not be negative";
+    *timeout = std::chrono::microseconds(timeout_micros);
+    return nullptr;
+}
+
+// Completes a "write" or "writeBatch" call with the error of its writes.
+void CompleteWrite(flutter::MethodResult<flutter::EncodableValue>& result,
+                   int error) {
+    if (error == 0) {
+        result.Success();
+    } else if (error == kWriteTimedOut) {
+        result.Error("writeTimeout",
+                     "Write did not complete within its timeout.",
+                     flutter::EncodableValue(error));
+    } else {
+        result.Error("writeFailed",
+                     "Error during write occurred. "
+                     "Connection might have closed.",
+                     flutter::EncodableValue(error));
+    }
+}
+
+// Stands in for the error of a connect that failed for lack of any channel
+// accepting, rather than being cut short.
+constexpr int kConnectFailed = -1;
+
+// The code Dart gets for a connect that failed with |error|.
+const char* ConnectErrorCode(int error) {
+    if (error == kConnectCancelled) return "connectCancelled";
+    if (error == kConnectTimedOut) return "connectTimeout";
+    if (error == kConnectInProgress) return "connectInProgress";
+    return "couldNotConnect";
+}
+
+// Completes a "connect" call with the id of the new connection, or with
+// |error| if there is none.
+void CompleteConnect(flutter::MethodResult<flutter::EncodableValue>& result,
+                     int id, int error) {
+    if (error == 0) {
+        result.Success(flutter::EncodableValue(id));
+    } else if (error == kConnectCancelled) {
+        result.Error(ConnectErrorCode(error), "The connect was cancelled");
+    } else if (error == kConnectTimedOut) {
+        result.Error(ConnectErrorCode(error),
+                     "The device did not connect in time");
+    } else {
+        result.Error(ConnectErrorCode(error), "Failed to connect to device");
+    }
+}
+
+// Sends what the non-blocking |socket| takes right now. Returns 0 if it is
+// full or failed; the queued send then picks the error up.
+size_t SendAvailable(SOCKET socket, const uint8_t* data, size_t size) {
+    int length = static_cast<int>(std::min<size_t>(size, INT_MAX));
+    int sent = send(socket, reinterpret_cast<const char*>(data), length, 0);
+    return sent > 0 ? static_cast<size_t>(sent) : 0;
+}
+
+}  // namespace
+
 // static
 void BluetoothClassicMultiplatformPlugin::RegisterWithRegistrar(
     flutter::PluginRegistrarWindows* registrar) {
@@ -35,6 +332,7 @@ void BluetoothClassicMultiplatformPlugin::RegisterWithRegistrar(
 
     auto plugin = std::make_unique<BluetoothClassicMultiplatformPlugin>();
     plugin->registrar = registrar;
+    plugin->task_runner_ = std::make_unique<PlatformTaskRunner>();
 
     channel->SetMethodCallHandler(
         [plugin_pointer = plugin.get()](const auto& call, auto result) {
@@ -50,6 +348,37 @@ void BluetoothClassicMultiplatformPlugin::RegisterWithRegistrar(
     plugin->discovery_handler_ptr = discovery_handler.get();
     discovery_channel->SetStreamHandler(std::move(discovery_handler));
 
+    // Progress of sendFile() calls, keyed by the caller's transfer id.
+    auto file_transfer_channel =
+        std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+            messenger, TAG + "/fileTransfers", codec);
+
+    auto file_transfer_handler = std::make_unique<SinkStreamHandler>();
+    plugin->file_transfer_handler_ptr = file_transfer_handler.get();
+    file_transfer_channel->SetStreamHandler(std::move(file_transfer_handler));
+
+    // Per-device outcomes of connectMany() calls, keyed by the caller's
+    // batch id.
+    auto connect_results_channel =
+        std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+            messenger, TAG + "/connectResults", codec);
+
+    auto connect_results_handler = std::make_unique<SinkStreamHandler>();
+    plugin->connect_results_handler_ptr = connect_results_handler.get();
+    connect_results_channel->SetStreamHandler(
+        std::move(connect_results_handler));
+
+    // Drops and recoveries of connections made with autoReconnect, keyed by
+    // connection id.
+    auto connection_state_channel =
+        std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+            messenger, TAG + "/connectionState", codec);
+
+    auto connection_state_handler = std::make_unique<SinkStreamHandler>();
+    plugin->connection_state_handler_ptr = connection_state_handler.get();
+    connection_state_channel->SetStreamHandler(
+        std::move(connection_state_handler));
+
     data_channel->SetMethodCallHandler(
         [plugin_pointer = plugin.get()](const auto& call, auto result) {
             plugin_pointer->HandleMethodCall(call, std::move(result));
@@ -58,9 +387,44 @@ void BluetoothClassicMultiplatformPlugin::RegisterWithRegistrar(
     registrar->AddPlugin(std::move(plugin));
 }
 
-BluetoothClassicMultiplatformPlugin::BluetoothClassicMultiplatformPlugin() {}
+BluetoothClassicMultiplatformPlugin::BluetoothClassicMultiplatformPlugin()
+    : channel_cache_(std::make_unique<ChannelCache>(
+          GetChannelCachePath(L"rfcomm_channels.txt"))),
+      io_reactor_(IoReactor::Create()) {
+    // Once for the plugin's lifetime, not per connect: every SDP lookup and
+    // socket below relies on it.
+    WSADATA wsa_data;
+    winsock_started_ = WSAStartup(MAKEWORD(2, 2), &wsa_data) == 0;
+    if (!winsock_started_) fprintf(stderr, "WSAStartup failed\n");
+}
 
-BluetoothClassicMultiplatformPlugin::~BluetoothClassicMultiplatformPlugin() {}
+BluetoothClassicMultiplatformPlugin::~BluetoothClassicMultiplatformPlugin() {
+    // Each close first removes the socket from the reactor, which waits out a
+    // callback already running for it, so no reader outlives this and
+    // shutdown costs one closesocket() per connection. Channels are left
+    // alone; the engine is going away with them.
+    DisconnectDevice(nullptr);
+    // Connects under way give up; their results are never posted back. A
+    // cancelled connect returns within kCancellationPollInterval, as it
+    // leaves the SDP lookup running on a thread of its own, so the joins
+    // are bounded.
+    for (auto& pending : pending_connects_) {
+        pending.second->Cancel();
+    }
+    for (auto& job : connect_jobs_) job.second->batch.Cancel();
+    for (auto& job : connect_jobs_) {
+        for (auto& worker : job.second->workers) worker.join();
+    }
+    // So do reconnects, also those of connections closed already; their
+    // workers wait out the backoff in slices of kCancellationPollInterval.
+    for (auto& reconnect : reconnects_) {
+        reconnect.second->cancellation.Cancel();
+        reconnect.second->worker.join();
+    }
+    // No socket is left; the reactor goes before Winsock does.
+    io_reactor_.reset();
+    if (winsock_started_) WSACleanup();
+}
 
 void BluetoothClassicMultiplatformPlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue>& method_call,
@@ -87,8 +451,7 @@ void BluetoothClassicMultiplatformPlugin::HandleMethodCall(
 
                         // Always start data listening if device is connected
                         // (like Android)
-                        if (connected_sockets_.find(*device_str) !=
-                            connected_sockets_.end()) {
+                        if (FindConnection(*device_str)) {
                             StartDataListening(*device_str);
                             fprintf(stderr,
                                     "Data listening started for device\n");
@@ -145,42 +508,296 @@ void BluetoothClassicMultiplatformPlugin::HandleMethodCall(
         result->Success(true);
     } else if (method == "connect") {
         fprintf(stderr, "HandleMethodCall: Connect method called\n");
-        bool success = ConnectToDevice(method_call.arguments());
-        if (success) {
-            fprintf(stderr,
-                    "HandleMethodCall: Connection successful, notifying state "
-                    "change\n");
-            NotifyConnectionStateChange(method_call.arguments(), true);
-
-            // Don't auto-start data listening here - let Flutter app call
-            // listen when ready
-            fprintf(stderr,
-                    "Connection established, waiting for data channel listen "
-                    "request\n");
-        } else {
-            fprintf(stderr, "HandleMethodCall: Connection failed\n");
+        ConnectionOptions options;
+        if (!ParseConnectionOptions(method_call.arguments(), &options)) {
+            result->Error("argumentInvalid", "Unknown overflowPolicy");
+            return;
         }
-        result->Success(flutter::EncodableValue(success));
+        const auto* address = GetAddressArgument(method_call.arguments());
+        if (auto existing = address ? FindConnection(*address) : nullptr) {
+            fprintf(stderr, "ConnectToDevice: Device already connected\n");
+            result->Success(flutter::EncodableValue(existing->id));
+            return;
+        }
+        if (!address) {
+            result->Error("couldNotConnect", "No address provided");
+            return;
+        }
+        if (pending_connects_.count(*address)) {
+            result->Error("connectInProgress",
+                          "A connect to this device is under way");
+            return;
+        }
+        int64_t timeout_micros = 0;
+        GetIntArgument(method_call.arguments(), "timeoutMicros",
+                       &timeout_micros);
+        std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            pending = std::move(result);
+        const auto& arguments =
+            std::get<flutter::EncodableMap>(*method_call.arguments());
+        StartConnectJob(
+            {*address}, arguments, options, 1,
+            std::chrono::microseconds(std::max<int64_t>(timeout_micros, 0)),
+            [pending](const std::string&, int id, int error) {
+                CompleteConnect(*pending, id, error);
+            },
+            nullptr);
+    } else if (method == "connectMany") {
+        // Connects to every device in "addresses", "maxParallel" at a time,
+        // and reports each on the connectResults channel, tagged "batchId",
+        // as it finishes. Completes after the last.
+        const auto* addresses =
+            GetListArgument(method_call.arguments(), "addresses");
+        if (!addresses) {
+            result->Error("argumentMissing",
+                          "Not all required arguments were specified");
+            return;
+        }
+        ConnectionOptions options;
+        if (!ParseConnectionOptions(method_call.arguments(), &options)) {
+            result->Error("argumentInvalid", "Unknown overflowPolicy");
+            return;
+        }
+        int64_t batch_id = 0;
+        GetIntArgument(method_call.arguments(), "batchId", &batch_id);
+        int64_t parallelism = kDefaultConnectParallelism;
+        GetIntArgument(method_call.arguments(), "maxParallel", &parallelism);
+        int64_t timeout_micros = 0;
+        GetIntArgument(method_call.arguments(), "timeoutMicros",
+                       &timeout_micros);
+
+        auto report = [this, batch_id](const std::string& address, int id,
+                                       int error) {
+            auto* handler = connect_results_handler_ptr;
+            if (!handler || !handler->sink) return;
+            flutter::EncodableMap event{
+                {flutter::EncodableValue("batchId"),
+                 flutter::EncodableValue(batch_id)},
+                {flutter::EncodableValue("address"),
+                 flutter::EncodableValue(address)},
+            };
+            if (error == 0) {
+                event[flutter::EncodableValue("id")] =
+                    flutter::EncodableValue(id);
+            } else {
+                event[flutter::EncodableValue("error")] =
+                    flutter::EncodableValue(ConnectErrorCode(error));
+            }
+            handler->sink->Success(flutter::EncodableValue(event));
+        };
+        // Devices connected already are reported right away, and those
+        // being connected, or named twice, are left to that connect.
+        std::vector<std::string> named;
+        for (const auto& value : *addresses) {
+            const auto* address = std::get_if<std::string>(&value);
+            if (address) named.push_back(*address);
+        }
+        std::vector<std::string> queued = PlanConnectBatch(
+            named,
+            [this](const std::string& address) {
+                auto existing = FindConnection(address);
+                return existing ? existing->id : 0;
+            },
+            [this](const std::string& address) {
+                return pending_connects_.count(address) > 0;
+            },
+            report);
+        std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            pending = std::move(result);
+        StartConnectJob(
+            queued, std::get<flutter::EncodableMap>(*method_call.arguments()),
+            options, ClampConnectParallelism(parallelism),
+            std::chrono::microseconds(std::max<int64_t>(timeout_micros, 0)),
+            report, [pending]() { pending->Success(); });
+    } else if (method == "cancelConnect") {
+        result->Success(
+            flutter::EncodableValue(CancelConnect(method_call.arguments())));
     } else if (method == "disconnect") {
         bool success = DisconnectDevice(method_call.arguments());
         // Send disconnection state change event and cleanup data channels
         if (success) {
             NotifyConnectionStateChange(method_call.arguments(), false);
             CleanupDataChannels(method_call.arguments());
+            const auto* address = GetAddressArgument(method_call.arguments());
+            if (address) {
+                UnregisterConnection(*address);
+            } else if (!method_call.arguments()) {
+                for (const auto& connection : connections_.Snapshot()) {
+                    UnregisterConnection(connection->address);
+                }
+            }
         }
         result->Success(flutter::EncodableValue(success));
     } else if (method == "isConnected") {
         bool connected = IsDeviceConnected(method_call.arguments());
         result->Success(flutter::EncodableValue(connected));
+    } else if (method == "channelCacheStats") {
+        ChannelCacheStats stats = channel_cache_->GetStats();
+        result->Success(flutter::EncodableValue(flutter::EncodableMap{
+            {flutter::EncodableValue("hits"),
+             flutter::EncodableValue(static_cast<int64_t>(stats.hits))},
+            {flutter::EncodableValue("misses"),
+             flutter::EncodableValue(static_cast<int64_t>(stats.misses))},
+            {flutter::EncodableValue("invalidations"),
+             flutter::EncodableValue(
+                 static_cast<int64_t>(stats.invalidations))},
+            {flutter::EncodableValue("entries"),
+             flutter::EncodableValue(static_cast<int64_t>(stats.entries))},
+        }));
+    } else if (method == "connectionStats") {
+        int64_t id = 0;
+        std::shared_ptr<Connection> connection;
+        if (GetIntArgument(method_call.arguments(), "id", &id)) {
+            connection = FindConnection(id);
+        }
+        if (!connection) {
+            result->Error("connectionInvalid", "Unknown connection id");
+            return;
+        }
+        result->Success(
+            flutter::EncodableValue(GetConnectionStats(*connection)));
     }
 
     // Data channel methods
-    else if (method == "writeData") {
-        bool success = WriteData(method_call.arguments());
-        result->Success(flutter::EncodableValue(success));
+    else if (method == "write") {
+        int64_t id = 0;
+        std::shared_ptr<Connection> connection;
+        if (GetIntArgument(method_call.arguments(), "id", &id)) {
+            connection = FindConnection(id);
+        }
+        const auto* bytes =
+            GetBytesArgument(method_call.arguments(), "bytes");
+        WritePriority priority = WritePriority::kNormal;
+        std::chrono::microseconds timeout(0);
+        const char* invalid =
+            GetWriteOptions(method_call.arguments(), &priority, &timeout);
+        if (!connection) {
+            result->Error("connectionInvalid", "Unknown connection id");
+            return;
+        }
+        if (!bytes) {
+            result->Error("argumentMissing",
+                          "Not all required arguments were specified");
+            return;
+        }
+        if (invalid) {
+            result->Error("argumentInvalid", invalid);
+            return;
+        }
+        // Completes once the transport took the bytes, so awaiting it in
+        // Dart paces the producer to the link.
+        std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            pending = std::move(result);
+        QueueWrite(connection, bytes->data(), bytes->size(), priority, timeout,
+                   [pending](int error) { CompleteWrite(*pending, error); });
+    } else if (method == "writeBatch") {
+        // "buffers" go to the connections in "ids": one id for all of
+        // them, or one per buffer.
+        const auto* ids = GetListArgument(method_call.arguments(), "ids");
+        const auto* buffers =
+            GetListArgument(method_call.arguments(), "buffers");
+        if (!ids || !buffers || ids->empty()) {
+            result->Error("argumentMissing",
+                          "Not all required arguments were specified");
+            return;
+        }
+        if (ids->size() != 1 && ids->size() != buffers->size()) {
+            result->Error("argumentInvalid",
+                          "Need one id, or one per buffer");
+            return;
+        }
+        WritePriority priority = WritePriority::kNormal;
+        std::chrono::microseconds timeout(0);
+        if (const char* invalid = GetWriteOptions(method_call.arguments(),
+                                                  &priority, &timeout)) {
+            result->Error("argumentInvalid", invalid);
+            return;
+        }
+        std::vector<BatchWrite> writes;
+        writes.reserve(buffers->size());
+        std::shared_ptr<Connection> connection;
+        for (size_t i = 0; i < buffers->size(); ++i) {
+            if (i < ids->size()) {
+                int64_t id = 0;
+                connection = GetInt((*ids)[i], &id) ? FindConnection(id)
+                                                    : nullptr;
+                if (!connection) {
+                    result->Error("connectionInvalid",
+                                  "Unknown connection id");
+                    return;
+                }
+            }
+            const auto* bytes =
+                std::get_if<std::vector<uint8_t>>(&(*buffers)[i]);
+            if (!bytes) {
+                result->Error("argumentInvalid", "Buffers must be Uint8List");
+                return;
+            }
+            writes.push_back(BatchWrite{connection, bytes});
+        }
+        // One completion for the whole batch.
+        std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            pending = std::move(result);
+        QueueWriteBatch(
+            writes, priority, timeout,
+            [pending](int error) { CompleteWrite(*pending, error); });
+    } else if (method == "sendFile") {
+        int64_t id = 0;
+        std::shared_ptr<Connection> connection;
+        if (GetIntArgument(method_call.arguments(), "id", &id)) {
+            connection = FindConnection(id);
+        }
+        const auto* path = GetStringArgument(method_call.arguments(), "path");
+        int64_t chunk_size = kDefaultFileChunkSize;
+        GetIntArgument(method_call.arguments(), "chunkSize", &chunk_size);
+        int64_t transfer_id = 0;
+        GetIntArgument(method_call.arguments(), "transferId", &transfer_id);
+        if (!connection) {
+            result->Error("connectionInvalid", "Unknown connection id");
+            return;
+        }
+        if (!path) {
+            result->Error("argumentMissing",
+                          "Not all required arguments were specified");
+            return;
+        }
+        if (chunk_size <= 0 ||
+            chunk_size > static_cast<int64_t>(kMaxFileChunkSize)) {
+            result->Error("argumentInvalid", "chunkSize out of range");
+            return;
+        }
+        int error = 0;
+        auto file = MappedFile::Open(*path, &error);
+        if (!file) {
+            result->Error("fileError", "Cannot open " + *path,
+                          flutter::EncodableValue(error));
+            return;
+        }
+        // Completes once the transport took the whole file.
+        std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            pending = std::move(result);
+        SendFile(connection, std::move(file),
+                 static_cast<size_t>(chunk_size), transfer_id,
+                 [pending](int error) {
+                     if (error == 0) {
+                         pending->Success();
+                     } else {
+                         pending->Error("writeFailed",
+                                        "Error during write occurred. "
+                                        "Connection might have closed.",
+                                        flutter::EncodableValue(error));
+                     }
+                 });
+    } else if (method == "writeData") {
+        std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            pending = std::move(result);
+        WriteData(method_call.arguments(), [pending](bool success) {
+            pending->Success(flutter::EncodableValue(success));
+        });
     } else if (method == "readData") {
-        std::string data = ReadData(method_call.arguments());
-        result->Success(flutter::EncodableValue(data));
+        std::vector<uint8_t> data = ReadData(method_call.arguments());
+        // Arrives in Dart as a Uint8List.
+        result->Success(flutter::EncodableValue(std::move(data)));
     } else if (method == "available") {
         int available = GetAvailableBytes(method_call.arguments());
         result->Success(flutter::EncodableValue(available));
@@ -355,10 +972,11 @@ flutter::EncodableList
 BluetoothClassicMultiplatformPlugin::GetConnectedDevices() {
     flutter::EncodableList devices;
 
-    for (const auto& pair : connected_sockets_) {
+    for (const auto& connection : connections_.Snapshot()) {
+        if (connection->state == ConnectionState::kClosed) continue;
         flutter::EncodableMap device;
         device[flutter::EncodableValue("address")] =
-            flutter::EncodableValue(pair.first);
+            flutter::EncodableValue(connection->address);
         device[flutter::EncodableValue("name")] =
             flutter::EncodableValue("Connected Device");
         device[flutter::EncodableValue("type")] =
@@ -373,7 +991,10 @@ BluetoothClassicMultiplatformPlugin::GetConnectedDevices() {
 }
 
 bool BluetoothClassicMultiplatformPlugin::ConnectToDevice(
-    const flutter::EncodableValue* arguments) {
+    const flutter::EncodableValue* arguments, const ConnectionOptions& options,
+    const ConnectCancellation& cancellation, SOCKET* connected_socket,
+    ConnectTiming* timing, int* error) {
+    *error = 0;
     if (!arguments) {
         fprintf(stderr, "ConnectToDevice: No arguments provided\n");
         return false;
@@ -401,17 +1022,8 @@ bool BluetoothClassicMultiplatformPlugin::ConnectToDevice(
         "ConnectToDevice: Attempting to connect to " + *address_str + "\n";
     fprintf(stderr, debug_msg.c_str());
 
-    // Check if already connected
-    if (connected_sockets_.find(*address_str) != connected_sockets_.end()) {
-        fprintf(stderr, "ConnectToDevice: Device already connected\n");
-        return true;
-    }
-
-    // Initialize Winsock
-    WSADATA wsaData;
-    int wsaResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (wsaResult != 0) {
-        fprintf(stderr, "ConnectToDevice: WSAStartup failed\n");
+    if (!winsock_started_) {
+        fprintf(stderr, "ConnectToDevice: Winsock is not initialized\n");
         return false;
     }
 
@@ -449,82 +1061,280 @@ bool BluetoothClassicMultiplatformPlugin::ConnectToDevice(
 
     fprintf(stderr, "ConnectToDevice: MAC address parsed successfully\n");
 
-    // Create socket
-    SOCKET sock = socket(AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM);
-    if (sock == INVALID_SOCKET) {
-        int error = WSAGetLastError();
-        char error_msg[256];
-        sprintf_s(error_msg,
-                  "ConnectToDevice: Socket creation failed with error %d\n",
-                  error);
-        fprintf(stderr, error_msg);
-        WSACleanup();
+    GUID service;
+    const auto* uuid = GetStringArgument(arguments, "uuid");
+    const std::string service_uuid = uuid ? *uuid : kSerialPortServiceUuid;
+    if (!ParseUuid(service_uuid, &service)) {
+        fprintf(stderr, "ConnectToDevice: Invalid service UUID\n");
         return false;
     }
 
-    fprintf(stderr, "ConnectToDevice: Socket created successfully\n");
-
-    // Set up connection address
-    SOCKADDR_BTH sockAddr = {0};
-    sockAddr.addressFamily = AF_BTH;
-    sockAddr.btAddr = btAddr;
-    sockAddr.port = BT_PORT_ANY;  // Try common RFCOMM port
-
-    // Try connecting to different RFCOMM channels (1-30)
-    bool connected = false;
-    for (int channel = 1; channel <= 30 && !connected; ++channel) {
-        sockAddr.port = channel;
-
-        char channel_msg[256];
-        sprintf_s(channel_msg, "ConnectToDevice: Trying RFCOMM channel %d\n",
-                  channel);
-        fprintf(stderr, channel_msg);
-
-        int result = connect(sock, (SOCKADDR*)&sockAddr, sizeof(sockAddr));
-        if (result == 0) {
-            connected = true;
-            char success_msg[256];
-            sprintf_s(success_msg,
-                      "ConnectToDevice: Connected successfully on channel %d\n",
-                      channel);
-            fprintf(stderr, success_msg);
-            break;
+    // Every attempt gets a socket of its own, so several can be under way.
+    StartConnect start_connect = [&](int channel, int* error) {
+        SOCKET sock = socket(AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM);
+        if (sock == INVALID_SOCKET) {
+            *error = WSAGetLastError();
+            return kInvalidNativeSocket;
+        }
+        // Set before connecting so the stack can size the link accordingly.
+        SetSocketBufferSize(sock, SO_RCVBUF,
+                            options.socket_receive_buffer_size);
+        SetSocketBufferSize(sock, SO_SNDBUF, options.socket_send_buffer_size);
+        SOCKADDR_BTH sockAddr = {0};
+        sockAddr.addressFamily = AF_BTH;
+        sockAddr.btAddr = btAddr;
+        sockAddr.port = static_cast<ULONG>(channel);
+        if (!StartNonBlockingConnect(sock, &sockAddr, sizeof(sockAddr),
+                                     error)) {
+            closesocket(sock);
+            return kInvalidNativeSocket;
+        }
+        return static_cast<NativeSocket>(sock);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    *timing = ConnectTiming();
+    ProbeResult result;
+    size_t attempts = 0;
+
+    // The channel that worked last time goes first; it is forgotten once
+    // it refuses.
+    std::string cached;
+    if (channel_cache_->Lookup(btAddr, service_uuid, &cached)) {
+        int cached_channel = atoi(cached.c_str());
+        fprintf(stderr, "ConnectToDevice: Trying cached RFCOMM channel %d\n",
+                cached_channel);
+        result = ProbeChannels({cached_channel}, 1, kConnectAttemptTimeout,
+                               start_connect, &cancellation);
+        attempts += result.attempts;
+        if (result.socket != kInvalidNativeSocket) {
+            timing->from_cache = true;
+        } else if (cancellation.Check() == 0) {
+            // Cut short, the attempt says nothing about the channel.
+            channel_cache_->Invalidate(btAddr, service_uuid);
+        }
+    }
+
+    if (result.socket == kInvalidNativeSocket && cancellation.Check() == 0) {
+        auto sdp_start = std::chrono::steady_clock::now();
+        // The SDP lookup cannot be interrupted, so a cancel or the deadline
+        // leaves it to finish on a thread of its own. That thread owns
+        // |lookup| from then on, and holds Winsock open for itself, since
+        // the plugin may be destroyed meanwhile.
+        struct SdpLookup {
+            int channel = 0;
+            int error = 0;
+            bool found = false;
+        };
+        auto lookup = std::make_shared<SdpLookup>();
+        int sdp_channel = 0;
+        int sdp_error = 0;
+        bool sdp_found = false;
+        if (RunCancellable(
+                [lookup, btAddr, service]() {
+                    WSADATA wsa_data;
+                    lookup->error = WSAStartup(MAKEWORD(2, 2), &wsa_data);
+                    if (lookup->error != 0) return;
+                    lookup->found = LookupRfcommChannel(
+                        btAddr, service, &lookup->channel, &lookup->error);
+                    WSACleanup();
+                },
+                cancellation)) {
+            sdp_channel = lookup->channel;
+            sdp_error = lookup->error;
+            sdp_found = lookup->found;
         } else {
-            int error = WSAGetLastError();
-            if (error != WSAECONNREFUSED && error != WSAETIMEDOUT) {
-                // Only log non-connection errors
-                char error_msg[256];
-                sprintf_s(error_msg,
-                          "ConnectToDevice: Channel %d failed with error %d\n",
-                          channel, error);
-                fprintf(stderr, error_msg);
+            sdp_error = cancellation.Check();
+        }
+        timing->sdp_lookup =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - sdp_start);
+        if (sdp_found) {
+            fprintf(stderr, "ConnectToDevice: SDP found RFCOMM channel %d\n",
+                    sdp_channel);
+            result = ProbeChannels({sdp_channel}, 1, kConnectAttemptTimeout,
+                                   start_connect, &cancellation);
+            attempts += result.attempts;
+            timing->from_sdp = result.socket != kInvalidNativeSocket;
+        } else {
+            fprintf(stderr,
+                    "ConnectToDevice: SDP lookup failed with error %d\n",
+                    sdp_error);
+        }
+
+        // Without an answer from SDP, or if its channel refused: try the
+        // rest, a few at a time.
+        if (result.socket == kInvalidNativeSocket) {
+            std::vector<int> channels;
+            for (int channel = 1; channel <= kMaxRfcommChannel; ++channel) {
+                if (channel != sdp_channel) channels.push_back(channel);
             }
+            result = ProbeChannels(channels, kProbeParallelism,
+                                   kConnectAttemptTimeout, start_connect,
+                                   &cancellation);
+            attempts += result.attempts;
+        }
+        if (result.socket != kInvalidNativeSocket) {
+            channel_cache_->Store(btAddr, service_uuid,
+                                  std::to_string(result.channel));
         }
     }
+    timing->channels_tried = attempts;
+    timing->total = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
 
-    if (!connected) {
+    if (result.socket == kInvalidNativeSocket) {
+        *error = cancellation.Check();
         fprintf(stderr,
-                "ConnectToDevice: Failed to connect on any RFCOMM channel\n");
-        closesocket(sock);
-        WSACleanup();
+                "ConnectToDevice: Failed to connect on any RFCOMM channel, "
+                "last error %d\n",
+                *error != 0 ? *error : result.error);
         return false;
     }
 
-    // Store successful connection
-    connected_sockets_[*address_str] = sock;
+    timing->channel = result.channel;
+    fprintf(stderr,
+            "ConnectToDevice: Connected on %schannel %d in %lld ms (SDP "
+            "%lld ms, %zu channels tried)\n",
+            timing->from_cache ? "cached " : "", result.channel,
+            static_cast<long long>(timing->total.count() / 1000),
+            static_cast<long long>(timing->sdp_lookup.count() / 1000),
+            timing->channels_tried);
+    *connected_socket = static_cast<SOCKET>(result.socket);
     fprintf(stderr, "ConnectToDevice: Connection stored successfully\n");
 
     return true;
 }
 
+void BluetoothClassicMultiplatformPlugin::StartConnectJob(
+    const std::vector<std::string>& addresses,
+    const flutter::EncodableMap& arguments, const ConnectionOptions& options,
+    size_t parallelism, std::chrono::microseconds timeout,
+    ConnectResultCallback on_result, std::function<void()> on_done) {
+    auto job = std::make_shared<ConnectJob>(addresses, timeout);
+    job->id = next_connect_job_id_++;
+    job->options = options;
+    job->on_result = std::move(on_result);
+    job->on_done = std::move(on_done);
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        flutter::EncodableMap device_arguments = arguments;
+        device_arguments[flutter::EncodableValue("address")] =
+            flutter::EncodableValue(addresses[i]);
+        pending_connects_[addresses[i]] = job->batch.cancellation(i);
+        job->arguments.emplace_back(std::move(device_arguments));
+    }
+    if (job->batch.size() == 0) {
+        if (job->on_done) job->on_done();
+        return;
+    }
+    connect_jobs_[job->id] = job;
+    if (!task_runner_) {
+        // Nothing to post the outcomes with; connect right here.
+        RunConnectJob(job);
+        return;
+    }
+    // The workers only touch the channel cache and the task runner, both
+    // of which the destructor keeps alive until it joined them.
+    parallelism = std::clamp<size_t>(parallelism, 1, job->batch.size());
+    for (size_t i = 0; i < parallelism; ++i) {
+        job->workers.emplace_back([this, job]() { RunConnectJob(job); });
+    }
+}
+
+void BluetoothClassicMultiplatformPlugin::RunConnectJob(
+    const std::shared_ptr<ConnectJob>& job) {
+    size_t index = 0;
+    while (job->batch.Take(&index)) {
+        ConnectCancellation& cancellation = *job->batch.cancellation(index);
+        SOCKET sock = INVALID_SOCKET;
+        ConnectTiming timing;
+        // Cancelled while it waited its turn: not even started.
+        int error = cancellation.Check();
+        if (error == 0 &&
+            ConnectToDevice(&job->arguments[index], job->options,
+                            cancellation, &sock, &timing, &error) &&
+            cancellation.cancelled()) {
+            closesocket(sock);
+            sock = INVALID_SOCKET;
+            error = kConnectCancelled;
+        }
+        if (!task_runner_) {
+            FinishJobConnect(job, index, sock, timing, error);
+            continue;
+        }
+        task_runner_->PostTask([this, job, index, sock, timing, error]() {
+            FinishJobConnect(job, index, sock, timing, error);
+        });
+    }
+}
+
+void BluetoothClassicMultiplatformPlugin::FinishJobConnect(
+    const std::shared_ptr<ConnectJob>& job, size_t index, SOCKET socket,
+    const ConnectTiming& timing, int error) {
+    const std::string& address = job->batch.address(index);
+    const auto& cancellation = job->batch.cancellation(index);
+    auto pending = pending_connects_.find(address);
+    if (pending != pending_connects_.end() && pending->second == cancellation) {
+        pending_connects_.erase(pending);
+    }
+    // Cancelled after the worker looked for the last time.
+    if (socket != INVALID_SOCKET && cancellation->cancelled()) {
+        closesocket(socket);
+        socket = INVALID_SOCKET;
+        error = kConnectCancelled;
+    }
+
+    int id = 0;
+    if (socket == INVALID_SOCKET) {
+        fprintf(stderr, "HandleMethodCall: Connection failed\n");
+        // ConnectToDevice() leaves it 0 on plain failures.
+        if (error == 0) error = kConnectFailed;
+    } else {
+        fprintf(stderr,
+                "HandleMethodCall: Connection successful, notifying state "
+                "change\n");
+        NotifyConnectionStateChange(&job->arguments[index], true);
+
+        id = RegisterConnection(address, socket, job->arguments[index],
+                                job->options, timing);
+
+        // Data listening starts once Dart listens on the connection
+        // stream (or calls listen on the data channel)
+        fprintf(stderr,
+                "Connection established, waiting for data channel listen "
+                "request\n");
+        error = 0;
+    }
+    job->on_result(address, id, error);
+
+    if (!job->batch.Finish()) return;
+    // The worker that posted this is about to find nothing left, and the
+    // others found that already.
+    for (auto& worker : job->workers) worker.join();
+    connect_jobs_.erase(job->id);
+    if (job->on_done) job->on_done();
+}
+
+bool BluetoothClassicMultiplatformPlugin::CancelConnect(
+    const flutter::EncodableValue* arguments) {
+    const auto* address = GetAddressArgument(arguments);
+    if (!address) return false;
+    auto it = pending_connects_.find(*address);
+    if (it == pending_connects_.end()) return false;
+    // The worker notices within ProbeChannels()' poll interval, or once an
+    // SDP lookup in progress returned; one that had not started yet skips
+    // the device. Either way connect() still gets its answer.
+    it->second->Cancel();
+    return true;
+}
+
 bool BluetoothClassicMultiplatformPlugin::DisconnectDevice(
     const flutter::EncodableValue* arguments) {
     if (!arguments) {
         // Disconnect all devices
-        for (auto& pair : connected_sockets_) {
-            closesocket(pair.second);
+        for (const auto& connection : connections_.Snapshot()) {
+            CloseConnectionSocket(*connection);
         }
-        connected_sockets_.clear();
         return true;
     }
 
@@ -537,12 +1347,8 @@ bool BluetoothClassicMultiplatformPlugin::DisconnectDevice(
     const auto* address_str = std::get_if<std::string>(&address_it->second);
     if (!address_str) return false;
 
-    auto sock_it = connected_sockets_.find(*address_str);
-    if (sock_it != connected_sockets_.end()) {
-        closesocket(sock_it->second);
-        connected_sockets_.erase(sock_it);
-        return true;
-    }
+    auto connection = FindConnection(*address_str);
+    if (connection) CloseConnectionSocket(*connection);
 
     return true;  // Return true even if not found (already disconnected)
 }
@@ -560,7 +1366,8 @@ bool BluetoothClassicMultiplatformPlugin::IsDeviceConnected(
     const auto* address_str = std::get_if<std::string>(&address_it->second);
     if (!address_str) return false;
 
-    return connected_sockets_.find(*address_str) != connected_sockets_.end();
+    auto connection = FindConnection(*address_str);
+    return connection && connection->state != ConnectionState::kClosed;
 }
 
 void BluetoothClassicMultiplatformPlugin::NotifyConnectionStateChange(
@@ -577,147 +1384,687 @@ void BluetoothClassicMultiplatformPlugin::StartDataListening(
         "StartDataListening called for: " + device_address + "\n";
     fprintf(stderr, debug_msg.c_str());
 
+    std::shared_ptr<Connection> connection = FindConnection(device_address);
+    if (!connection || connection->state == ConnectionState::kClosed) {
+        fprintf(stderr, "Cannot start data listening - device not connected\n");
+        return;
+    }
+
     // Check if already listening for this device
-    if (listening_devices_.find(device_address) != listening_devices_.end()) {
+    ConnectionState expected = ConnectionState::kConnected;
+    if (!connection->state.compare_exchange_strong(expected,
+                                                   ConnectionState::kReading)) {
         fprintf(stderr, "Data listening already active for device\n");
         return;
     }
 
-    auto sock_it = connected_sockets_.find(device_address);
-    if (sock_it == connected_sockets_.end()) {
-        fprintf(stderr, "Cannot start data listening - device not connected\n");
+    // Clear any existing data buffer for fresh start
+    connection->received->Clear();
+
+    if (!ReadConnection(connection)) {
+        fprintf(stderr,
+                "Cannot start data listening - socket registration failed\n");
+        expected = ConnectionState::kReading;
+        connection->state.compare_exchange_strong(
+            expected, ConnectionState::kConnected);
         return;
     }
 
-    SOCKET sock = sock_it->second;
+    fprintf(stderr, "Data listening started for device\n");
+}
 
-    // Set socket to non-blocking mode for polling
-    u_long mode = 1;
-    ioctlsocket(sock, FIONBIO, &mode);
+bool BluetoothClassicMultiplatformPlugin::ReadConnection(
+    const std::shared_ptr<Connection>& connection) {
+    // The reactor switches the socket to non-blocking mode and reads it as
+    // soon as data arrives; nothing runs while the link is idle.
+    IoHandler handler;
+    handler.read_budget = [connection]() {
+        return connection->received->ReadBudget();
+    };
+    handler.on_data = [this, connection](const uint8_t* data, size_t size) {
+        OnDataReceived(connection, data, size);
+    };
+    handler.on_closed = [this, connection](int error) {
+        if (error == 0) {
+            fprintf(stderr,
+                    "DataListening: Connection closed by remote device\n");
+        } else {
+            char error_msg[256];
+            sprintf_s(error_msg, "DataListening: Receive error: %d\n", error);
+            fprintf(stderr, "%s", error_msg);
+        }
+        ConnectionState reading = ConnectionState::kReading;
+        connection->state.compare_exchange_strong(
+            reading, ConnectionState::kConnected);
+        if (!task_runner_) return;
+        if (connection->options.auto_reconnect) {
+            task_runner_->PostTask([this, connection, error]() {
+                StartReconnect(connection, error);
+            });
+            return;
+        }
+        // The link is gone: end the stream and drop the connection, as
+        // disconnect() does.
+        task_runner_->PostTask([this, connection]() {
+            // The connection may already be gone.
+            if (FindConnection(connection->id) != connection) return;
+
+            // Hand over what arrived before the link dropped.
+            DeliverReceivedData(connection);
+            CloseConnection(connection->address);
+        });
+    };
 
-    // Store device for data monitoring
-    listening_devices_.insert(device_address);
+    std::lock_guard<std::mutex> lock(connection->socket_mutex);
+    return connection->socket != INVALID_SOCKET &&
+           io_reactor_->Add(connection->socket, std::move(handler));
+}
 
-    // Clear any existing data buffer for fresh start
-    {
-        std::lock_guard<std::mutex> lock(data_mutex_);
-        received_data_[device_address].clear();
-    }
+void BluetoothClassicMultiplatformPlugin::StopDataListening(
+    const std::string& device_address) {
+    std::shared_ptr<Connection> connection = FindConnection(device_address);
+    if (!connection) return;
 
-    // Start background thread for data monitoring
-    std::thread data_thread([this, device_address, sock]() {
-        this->DataListeningThread(device_address, sock);
-    });
-    data_thread.detach();
+    std::lock_guard<std::mutex> lock(connection->socket_mutex);
+    if (connection->socket != INVALID_SOCKET) {
+        io_reactor_->StopReading(connection->socket);
+    }
+    ConnectionState expected = ConnectionState::kReading;
+    connection->state.compare_exchange_strong(expected,
+                                              ConnectionState::kConnected);
+}
 
-    fprintf(stderr, "Data listening thread started for device\n");
+void BluetoothClassicMultiplatformPlugin::OnDataReceived(
+    const std::shared_ptr<Connection>& connection, const uint8_t* data,
+    size_t size) {
+    const std::string& device_address = connection->address;
+    // Store raw received data WITHOUT any modifications (like Android)
+    uint64_t dropped_before = connection->received->GetStats().dropped_bytes;
+    bool keep_open = connection->received->Store(data, size);
+    uint64_t dropped = connection->received->GetStats().dropped_bytes;
+    if (dropped != dropped_before) {
+        std::string drop_msg = "Receive buffer full, dropped " +
+                               std::to_string(dropped - dropped_before) +
+                               " bytes from " + device_address + "\n";
+        fprintf(stderr, "%s", drop_msg.c_str());
+    }
+    ScheduleDelivery(connection);
+
+    if (!keep_open && !connection->overflow_close_posted.exchange(true) &&
+        task_runner_) {
+        task_runner_->PostTask([this, connection]() {
+            // The connection may already be gone.
+            if (FindConnection(connection->id) != connection) return;
+
+            // Hand over what did fit before reporting the overflow.
+            DeliverReceivedData(connection);
+            if (connection->sink) {
+                size_t capacity = connection->received->GetStats().capacity;
+                connection->sink->Error("receiveBufferOverflow",
+                                        "Receive buffer of " +
+                                            std::to_string(capacity) +
+                                            " bytes overflowed");
+            }
+            CloseConnection(connection->address);
+        });
+    }
 }
 
-void BluetoothClassicMultiplatformPlugin::DataListeningThread(
-    const std::string& device_address, SOCKET sock) {
-    char buffer[1024];
+// static
+bool BluetoothClassicMultiplatformPlugin::ParseConnectionOptions(
+    const flutter::EncodableValue* arguments, ConnectionOptions* options) {
+    int64_t window_us = 0;
+    if (GetIntArgument(arguments, "readCoalescingWindowMicros", &window_us) &&
+        window_us > 0) {
+        options->read_coalescing_window = std::chrono::microseconds(window_us);
+    }
+
+    int64_t buffer_size = kDefaultReceiveBufferSize;
+    GetIntArgument(arguments, "receiveBufferSize", &buffer_size);
+    if (buffer_size < static_cast<int64_t>(kMinReceiveBufferSize)) {
+        buffer_size = kMinReceiveBufferSize;
+    } else if (buffer_size > static_cast<int64_t>(kMaxReceiveBufferSize)) {
+        buffer_size = kMaxReceiveBufferSize;
+    }
+    options->receive_buffer_size = static_cast<size_t>(buffer_size);
+
+    int64_t socket_buffer_size = 0;
+    if (GetIntArgument(arguments, "socketReceiveBufferSize",
+                       &socket_buffer_size) &&
+        socket_buffer_size > 0 && socket_buffer_size <= INT_MAX) {
+        options->socket_receive_buffer_size =
+            static_cast<int>(socket_buffer_size);
+    }
+    if (GetIntArgument(arguments, "socketSendBufferSize",
+                       &socket_buffer_size) &&
+        socket_buffer_size > 0 && socket_buffer_size <= INT_MAX) {
+        options->socket_send_buffer_size = static_cast<int>(socket_buffer_size);
+    }
+
+    int64_t coalescing_bytes = 0;
+    int64_t coalescing_us = 0;
+    if (GetIntArgument(arguments, "writeCoalescingBytes", &coalescing_bytes) &&
+        GetIntArgument(arguments, "writeCoalescingWindowMicros",
+                       &coalescing_us) &&
+        coalescing_bytes > 0 && coalescing_us > 0) {
+        options->write_coalescing.max_bytes =
+            static_cast<size_t>(coalescing_bytes);
+        options->write_coalescing.max_delay =
+            std::chrono::microseconds(coalescing_us);
+    }
 
-    std::string thread_debug_msg =
-        "DataListeningThread: Started for device: " + device_address + "\n";
-    fprintf(stderr, thread_debug_msg.c_str());
+    int64_t rate = 0;
+    if (GetIntArgument(arguments, "writeRateBytesPerSecond", &rate) &&
+        rate > 0) {
+        options->write_rate_limit.bytes_per_second =
+            static_cast<uint64_t>(rate);
+        // 10 ms worth unless given.
+        int64_t burst = std::max<int64_t>(rate / 100, 1);
+        GetIntArgument(arguments, "writeBurstBytes", &burst);
+        options->write_rate_limit.burst_bytes =
+            static_cast<size_t>(std::max<int64_t>(burst, 1));
+    }
 
-    while (
-        listening_devices_.find(device_address) != listening_devices_.end() &&
-        connected_sockets_.find(device_address) != connected_sockets_.end()) {
-        int bytes_received = recv(sock, buffer, sizeof(buffer), 0);
+    GetBoolArgument(arguments, "autoReconnect", &options->auto_reconnect);
+    ReconnectPolicy& reconnect = options->reconnect_policy;
+    int64_t delay_us = 0;
+    if (GetIntArgument(arguments, "reconnectInitialDelayMicros", &delay_us) &&
+        delay_us >= 0) {
+        reconnect.initial_delay = std::chrono::microseconds(delay_us);
+    }
+    if (GetIntArgument(arguments, "reconnectMaxDelayMicros", &delay_us) &&
+        delay_us >= 0) {
+        reconnect.max_delay = std::chrono::microseconds(delay_us);
+    }
+    int64_t attempts = 0;
+    if (GetIntArgument(arguments, "reconnectMaxAttempts", &attempts) &&
+        attempts >= 0) {
+        reconnect.max_attempts =
+            static_cast<int>(std::min<int64_t>(attempts, INT_MAX));
+    }
 
-        if (bytes_received > 0) {
-            // Store raw received data WITHOUT any modifications (like
-            // Android)
-            {
-                std::lock_guard<std::mutex> lock(data_mutex_);
-                received_data_[device_address].append(buffer, bytes_received);
-            }
+    const auto* policy = GetStringArgument(arguments, "overflowPolicy");
+    return !policy || ParseOverflowPolicy(*policy, &options->overflow_policy);
+}
 
-            // Debug: Log received data in detail
-            std::string recv_debug_msg = "Received " +
-                                         std::to_string(bytes_received) +
-                                         " bytes from " + device_address + ": ";
-            int max_chars = bytes_received < 50 ? bytes_received : 50;
-            for (int j = 0; j < max_chars; j++) {
-                if (buffer[j] >= 32 && buffer[j] <= 126) {
-                    recv_debug_msg += buffer[j];
-                } else {
-                    recv_debug_msg +=
-                        "[" + std::to_string((unsigned char)buffer[j]) + "]";
+int BluetoothClassicMultiplatformPlugin::RegisterConnection(
+    const std::string& device_address, SOCKET socket,
+    const flutter::EncodableValue& arguments, const ConnectionOptions& options,
+    const ConnectTiming& timing) {
+    auto connection = std::make_shared<Connection>();
+    connection->id = connections_.NewId();
+    connection->address = device_address;
+    connection->socket = socket;
+    connection->connect_timing = timing;
+    connection->options = options;
+    connection->coalescing_window = options.read_coalescing_window;
+    connection->received = std::make_unique<ReceiveBuffer>(
+        options.receive_buffer_size, options.overflow_policy);
+    connection->outgoing->SetCoalescing(options.write_coalescing);
+    connection->outgoing->SetRateLimit(options.write_rate_limit);
+    if (!io_reactor_->AddWriter(socket, connection->outgoing)) {
+        int error = WSAGetLastError();
+        fprintf(stderr, "RegisterConnection: Cannot queue writes: %d\n",
+                error);
+        connection->outgoing->Close(error != 0 ? error : WSAENOTSOCK);
+    }
+    if (options.auto_reconnect) {
+        connection->connect_arguments = arguments;
+        connection->outgoing->SetResumable(true);
+    }
+
+    if (registrar) {
+        connection->channel =
+            std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+                registrar->messenger(),
+                TAG + "/connection/" + std::to_string(connection->id),
+                &flutter::StandardMethodCodec::GetInstance());
+
+        // The handler only holds a weak reference; the connection owns the
+        // channel and therefore the handler.
+        std::weak_ptr<Connection> weak_connection = connection;
+        auto handler = std::make_unique<
+            flutter::StreamHandlerFunctions<flutter::EncodableValue>>(
+            [this, weak_connection](
+                const flutter::EncodableValue* arguments,
+                std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>&&
+                    events)
+                -> std::unique_ptr<
+                    flutter::StreamHandlerError<flutter::EncodableValue>> {
+                auto connection = weak_connection.lock();
+                if (!connection) return nullptr;
+                connection->sink = std::move(events);
+                StartDataListening(connection->address);
+
+                // Anything that arrived before Dart subscribed goes out
+                // right away.
+                connection->listening = true;
+                if (connection->received->Available() > 0) {
+                    ScheduleDelivery(connection);
                 }
-            }
-            if (bytes_received > 50) recv_debug_msg += "...";
-            recv_debug_msg += "\n";
-            fprintf(stderr, recv_debug_msg.c_str());
+                return nullptr;
+            },
+            [this, weak_connection](const flutter::EncodableValue* arguments)
+                -> std::unique_ptr<
+                    flutter::StreamHandlerError<flutter::EncodableValue>> {
+                auto connection = weak_connection.lock();
+                if (!connection) return nullptr;
+                connection->listening = false;
+                connection->sink.reset();
+
+                // Like Android, cancelling the stream closes the connection.
+                // Deferred because it destroys this very handler.
+                if (task_runner_) {
+                    std::string address = connection->address;
+                    task_runner_->PostTask(
+                        [this, address]() { CloseConnection(address); });
+                }
+                return nullptr;
+            });
+        connection->channel->SetStreamHandler(std::move(handler));
+    }
 
-        } else if (bytes_received == 0) {
-            fprintf(stderr,
-                    "DataListeningThread: Connection closed by remote "
-                    "device\n");
-            break;
-        } else {
-            int error = WSAGetLastError();
-            if (error != WSAEWOULDBLOCK) {
-                char error_msg[256];
-                sprintf_s(error_msg,
-                          "DataListeningThread: Receive error: % d\n ", error);
-                fprintf(stderr, error_msg);
+    connections_.Insert(connection->id, connection);
+    connection_ids_[device_address] = connection->id;
+    // Read from the start, so a drop shows even on an idle link; what
+    // arrives is held for Dart as usual.
+    if (options.auto_reconnect) StartDataListening(device_address);
+    return connection->id;
+}
+
+void BluetoothClassicMultiplatformPlugin::UnregisterConnection(
+    const std::string& device_address) {
+    auto id_it = connection_ids_.find(device_address);
+    if (id_it == connection_ids_.end()) return;
+
+    auto connection = connections_.Remove(id_it->second);
+    connection_ids_.erase(id_it);
+    if (!connection) return;
+    CloseConnectionSocket(*connection);
+    connection->listening = false;
+    if (connection->sink) {
+        connection->sink->EndOfStream();
+        connection->sink.reset();
+    }
+    if (connection->channel) connection->channel->SetStreamHandler(nullptr);
+}
+
+void BluetoothClassicMultiplatformPlugin::ScheduleDelivery(
+    const std::shared_ptr<Connection>& connection) {
+    if (!task_runner_ || !connection->listening ||
+        connection->delivery_scheduled.exchange(true)) {
+        return;
+    }
+
+    auto deliver = [this, connection]() { DeliverReceivedData(connection); };
+    if (connection->coalescing_window.count() == 0) {
+        task_runner_->PostTask(std::move(deliver));
+    } else {
+        io_reactor_->RunAfter(connection->coalescing_window, [this, deliver]() {
+            task_runner_->PostTask(deliver);
+        });
+    }
+}
+
+void BluetoothClassicMultiplatformPlugin::DeliverReceivedData(
+    const std::shared_ptr<Connection>& connection) {
+    // Cleared before draining (and as a read-modify-write, which pairs with
+    // the producer's exchange) so bytes written after this point schedule
+    // another delivery instead of being stranded.
+    connection->delivery_scheduled.exchange(false);
+    if (!connection->listening) return;
+
+    std::vector<uint8_t> chunk;
+    size_t read = connection->received->ReadAll(&chunk);
+    ResumeReadingIfPaused(*connection);
+    if (read == 0) return;
+
+    // Arrives in Dart as a Uint8List.
+    if (connection->sink) {
+        connection->sink->Success(flutter::EncodableValue(std::move(chunk)));
+    }
+}
+
+std::shared_ptr<BluetoothClassicMultiplatformPlugin::Connection>
+BluetoothClassicMultiplatformPlugin::FindConnection(
+    const std::string& device_address) {
+    auto id_it = connection_ids_.find(device_address);
+    if (id_it == connection_ids_.end()) return nullptr;
+    return connections_.Find(id_it->second);
+}
+
+std::shared_ptr<BluetoothClassicMultiplatformPlugin::Connection>
+BluetoothClassicMultiplatformPlugin::FindConnection(int64_t id) {
+    if (id <= 0 || id > INT_MAX) return nullptr;
+    return connections_.Find(static_cast<int>(id));
+}
+
+void BluetoothClassicMultiplatformPlugin::CloseConnectionSocket(
+    Connection& connection) {
+    // A link being brought back stays down; FinishReconnect() closes what
+    // the attempt under way may still bring.
+    auto reconnect = reconnects_.find(connection.id);
+    if (reconnect != reconnects_.end()) {
+        reconnect->second->cancellation.Cancel();
+    }
+    std::lock_guard<std::mutex> lock(connection.socket_mutex);
+    if (connection.state == ConnectionState::kClosed) return;
+    // Writes held for a new link fail now, or with the Close() that
+    // Remove() makes.
+    connection.outgoing->SetResumable(false);
+    if (connection.socket != INVALID_SOCKET) {
+        io_reactor_->Remove(connection.socket);
+        closesocket(connection.socket);
+        connection.socket = INVALID_SOCKET;
+    }
+    connection.state = ConnectionState::kClosed;
+}
+
+void BluetoothClassicMultiplatformPlugin::ResumeReadingIfPaused(
+    Connection& connection) {
+    if (!connection.received->TakeResumeRequest()) return;
+    std::lock_guard<std::mutex> lock(connection.socket_mutex);
+    if (connection.socket != INVALID_SOCKET) {
+        io_reactor_->Resume(connection.socket);
+    }
+}
+
+void BluetoothClassicMultiplatformPlugin::CloseConnection(
+    const std::string& device_address) {
+    flutter::EncodableValue arguments(
+        flutter::EncodableMap{{flutter::EncodableValue("address"),
+                               flutter::EncodableValue(device_address)}});
+    if (DisconnectDevice(&arguments)) {
+        NotifyConnectionStateChange(&arguments, false);
+        CleanupDataChannels(&arguments);
+        UnregisterConnection(device_address);
+    }
+}
+
+void BluetoothClassicMultiplatformPlugin::StartReconnect(
+    const std::shared_ptr<Connection>& connection, int error) {
+    // Closed meanwhile, or brought back already.
+    if (FindConnection(connection->id) != connection ||
+        reconnects_.count(connection->id)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(connection->socket_mutex);
+        if (connection->socket == INVALID_SOCKET) return;
+        // The queue fails the writes that started on the dead link and
+        // holds the rest for the next.
+        io_reactor_->Remove(connection->socket);
+        closesocket(connection->socket);
+        connection->socket = INVALID_SOCKET;
+        connection->state = ConnectionState::kReconnecting;
+    }
+    std::string debug_msg = "Reconnect: Link to " + connection->address +
+                            " dropped (" + std::to_string(error) + ")\n";
+    fprintf(stderr, "%s", debug_msg.c_str());
+
+    auto reconnect =
+        std::make_shared<Reconnect>(connection->options.reconnect_policy);
+    reconnect->dropped_at = std::chrono::steady_clock::now();
+    reconnect->error = error;
+    reconnects_[connection->id] = reconnect;
+    // Only touches the channel cache and the task runner, which the
+    // destructor keeps alive until it joined the worker.
+    reconnect->worker = std::thread([this, connection, reconnect]() {
+        RunReconnect(connection, reconnect);
+    });
+}
+
+void BluetoothClassicMultiplatformPlugin::RunReconnect(
+    const std::shared_ptr<Connection>& connection,
+    const std::shared_ptr<Reconnect>& reconnect) {
+    const ConnectCancellation& cancellation = reconnect->cancellation;
+    std::chrono::microseconds delay;
+    while (!cancellation.cancelled() && reconnect->backoff.Next(&delay)) {
+        int attempt = reconnect->backoff.attempts();
+        int64_t delay_us = delay.count();
+        int error = reconnect->error;
+        task_runner_->PostTask([this, connection, attempt, delay_us, error]() {
+            SendConnectionState(*connection, "reconnecting",
+                                {{flutter::EncodableValue("attempt"),
+                                  flutter::EncodableValue(attempt)},
+                                 {flutter::EncodableValue("delayMicros"),
+                                  flutter::EncodableValue(delay_us)},
+                                 {flutter::EncodableValue("error"),
+                                  flutter::EncodableValue(error)}});
+        });
+        // In slices, so a disconnect does not wait out the backoff.
+        auto until = std::chrono::steady_clock::now() + delay;
+        for (auto now = std::chrono::steady_clock::now();
+             now < until && !cancellation.cancelled();
+             now = std::chrono::steady_clock::now()) {
+            std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(
+                until - now, kCancellationPollInterval));
+        }
+        if (cancellation.cancelled()) break;
+
+        SOCKET sock = INVALID_SOCKET;
+        ConnectTiming timing;
+        int connect_error = 0;
+        if (ConnectToDevice(&connection->connect_arguments,
+                            connection->options, cancellation, &sock, &timing,
+                            &connect_error)) {
+            // Connected just as it was cancelled, possibly by the
+            // destructor; nothing would take the socket then.
+            if (cancellation.cancelled()) {
+                closesocket(sock);
                 break;
             }
+            task_runner_->PostTask([this, connection, sock, timing]() {
+                FinishReconnect(connection, sock, timing);
+            });
+            return;
         }
+    }
+    task_runner_->PostTask([this, connection]() {
+        FinishReconnect(connection, INVALID_SOCKET, ConnectTiming());
+    });
+}
+
+void BluetoothClassicMultiplatformPlugin::FinishReconnect(
+    const std::shared_ptr<Connection>& connection, SOCKET socket,
+    const ConnectTiming& timing) {
+    // The worker that posted this is about to return.
+    auto it = reconnects_.find(connection->id);
+    std::shared_ptr<Reconnect> reconnect = std::move(it->second);
+    reconnects_.erase(it);
+    reconnect->worker.join();
+    // Disconnected meanwhile; that already failed the held writes.
+    if (reconnect->cancellation.cancelled() ||
+        FindConnection(connection->id) != connection) {
+        if (socket != INVALID_SOCKET) closesocket(socket);
+        return;
+    }
 
-        // Use same delay as Android (10ms)
-        Sleep(10);
+    int attempts = reconnect->backoff.attempts();
+    if (socket == INVALID_SOCKET) {
+        std::string debug_msg = "Reconnect: Giving up on " +
+                                connection->address + " after " +
+                                std::to_string(attempts) + " attempts\n";
+        fprintf(stderr, "%s", debug_msg.c_str());
+        SendConnectionState(*connection, "disconnected",
+                            {{flutter::EncodableValue("attempts"),
+                              flutter::EncodableValue(attempts)},
+                             {flutter::EncodableValue("error"),
+                              flutter::EncodableValue(reconnect->error)}});
+        CloseConnection(connection->address);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(connection->socket_mutex);
+        connection->socket = socket;
+        connection->connect_timing = timing;
+        connection->state = ConnectionState::kReading;
+        if (!io_reactor_->AddWriter(socket, connection->outgoing)) {
+            int error = WSAGetLastError();
+            fprintf(stderr, "Reconnect: Cannot queue writes: %d\n", error);
+            connection->outgoing->SetResumable(false);
+        }
+    }
+    ++connection->reconnects;
+    // Sends what waited for the link, then has the deadlines it passed
+    // meanwhile checked.
+    if (connection->outgoing->Resume()) FlushWrites(*connection);
+    {
+        std::lock_guard<std::mutex> lock(connection->socket_mutex);
+        io_reactor_->WatchDeadline(socket, WriteQueue::Clock::now());
     }
+    // Unlike StartDataListening(), keeps what Dart has not taken yet.
+    if (!ReadConnection(connection)) {
+        fprintf(stderr, "Reconnect: Cannot read the new link\n");
+        connection->state = ConnectionState::kConnected;
+    }
+
+    auto downtime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - reconnect->dropped_at);
+    SendConnectionState(*connection, "connected",
+                        {{flutter::EncodableValue("attempts"),
+                          flutter::EncodableValue(attempts)},
+                         {flutter::EncodableValue("downtimeMicros"),
+                          flutter::EncodableValue(
+                              static_cast<int64_t>(downtime.count()))}});
+}
 
-    fprintf(stderr, "DataListeningThread: Ending for device\n");
-    listening_devices_.erase(device_address);
+void BluetoothClassicMultiplatformPlugin::SendConnectionState(
+    const Connection& connection, const char* state,
+    flutter::EncodableMap event) {
+    auto* handler = connection_state_handler_ptr;
+    if (!handler || !handler->sink) return;
+    event[flutter::EncodableValue("id")] =
+        flutter::EncodableValue(connection.id);
+    event[flutter::EncodableValue("address")] =
+        flutter::EncodableValue(connection.address);
+    event[flutter::EncodableValue("state")] = flutter::EncodableValue(state);
+    handler->sink->Success(flutter::EncodableValue(std::move(event)));
 }
 
-std::string BluetoothClassicMultiplatformPlugin::ReadData(
+flutter::EncodableMap BluetoothClassicMultiplatformPlugin::GetConnectionStats(
+    Connection& connection) {
+    ReceiveBufferStats stats = connection.received->GetStats();
+    flutter::EncodableMap map{
+        {flutter::EncodableValue("receiveBufferSize"),
+         flutter::EncodableValue(static_cast<int64_t>(stats.capacity))},
+        {flutter::EncodableValue("bufferedBytes"),
+         flutter::EncodableValue(static_cast<int64_t>(stats.buffered_bytes))},
+        {flutter::EncodableValue("overflowCount"),
+         flutter::EncodableValue(static_cast<int64_t>(stats.overflow_count))},
+        {flutter::EncodableValue("droppedBytes"),
+         flutter::EncodableValue(static_cast<int64_t>(stats.dropped_bytes))},
+    };
+
+    WriteQueueStats writes = connection.outgoing->GetStats();
+    map[flutter::EncodableValue("queuedWriteBytes")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.queued_bytes));
+    map[flutter::EncodableValue("queuedWrites")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.queued_writes));
+    map[flutter::EncodableValue("bytesWritten")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.bytes_sent));
+    map[flutter::EncodableValue("bytesWrittenDirect")] =
+        flutter::EncodableValue(
+            static_cast<int64_t>(writes.bytes_sent_direct));
+    map[flutter::EncodableValue("writesCompleted")] = flutter::EncodableValue(
+        static_cast<int64_t>(writes.writes_completed));
+    map[flutter::EncodableValue("sends")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.sends));
+    map[flutter::EncodableValue("writesMerged")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.writes_merged));
+    map[flutter::EncodableValue("writeHolds")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.holds));
+    map[flutter::EncodableValue("writeHoldMicros")] = flutter::EncodableValue(
+        static_cast<int64_t>(writes.hold_time.count()));
+    map[flutter::EncodableValue("maxWriteHoldMicros")] =
+        flutter::EncodableValue(
+            static_cast<int64_t>(writes.max_hold_time.count()));
+    map[flutter::EncodableValue("writeRateLimit")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.rate_limit));
+    map[flutter::EncodableValue("writeBurst")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.rate_burst));
+    map[flutter::EncodableValue("achievedWriteRate")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.achieved_rate));
+    map[flutter::EncodableValue("writeThrottles")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.throttles));
+    map[flutter::EncodableValue("writeThrottleMicros")] =
+        flutter::EncodableValue(
+            static_cast<int64_t>(writes.throttle_time.count()));
+    map[flutter::EncodableValue("writeTimeouts")] =
+        flutter::EncodableValue(static_cast<int64_t>(writes.timeouts));
+    const ConnectTiming& timing = connection.connect_timing;
+    map[flutter::EncodableValue("connectMicros")] =
+        flutter::EncodableValue(static_cast<int64_t>(timing.total.count()));
+    map[flutter::EncodableValue("sdpLookupMicros")] = flutter::EncodableValue(
+        static_cast<int64_t>(timing.sdp_lookup.count()));
+    map[flutter::EncodableValue("rfcommChannel")] =
+        flutter::EncodableValue(timing.channel);
+    map[flutter::EncodableValue("channelFromCache")] =
+        flutter::EncodableValue(timing.from_cache);
+    map[flutter::EncodableValue("channelFromSdp")] =
+        flutter::EncodableValue(timing.from_sdp);
+    map[flutter::EncodableValue("channelsTried")] =
+        flutter::EncodableValue(static_cast<int64_t>(timing.channels_tried));
+    map[flutter::EncodableValue("reconnects")] =
+        flutter::EncodableValue(connection.reconnects);
+    map[flutter::EncodableValue("writeLatency")] =
+        flutter::EncodableValue(flutter::EncodableMap{
+            {flutter::EncodableValue("normal"),
+             flutter::EncodableValue(EncodeLatencyHistogram(
+                 writes.latency[static_cast<size_t>(
+                     WritePriority::kNormal)]))},
+            {flutter::EncodableValue("high"),
+             flutter::EncodableValue(EncodeLatencyHistogram(
+                 writes.latency[static_cast<size_t>(
+                     WritePriority::kHigh)]))},
+        });
+
+    std::lock_guard<std::mutex> lock(connection.socket_mutex);
+    if (connection.socket == INVALID_SOCKET) return map;
+    SOCKET sock = connection.socket;
+    map[flutter::EncodableValue("socketReceiveBufferSize")] =
+        flutter::EncodableValue(GetSocketBufferSize(sock, SO_RCVBUF));
+    map[flutter::EncodableValue("socketSendBufferSize")] =
+        flutter::EncodableValue(GetSocketBufferSize(sock, SO_SNDBUF));
+
+    // Only known while the reactor is reading the socket.
+    IoStats io_stats;
+    if (io_reactor_->GetStats(sock, &io_stats)) {
+        map[flutter::EncodableValue("readSize")] =
+            flutter::EncodableValue(static_cast<int64_t>(io_stats.read_size));
+        map[flutter::EncodableValue("reads")] =
+            flutter::EncodableValue(static_cast<int64_t>(io_stats.reads));
+        map[flutter::EncodableValue("bytesRead")] =
+            flutter::EncodableValue(static_cast<int64_t>(io_stats.bytes_read));
+    }
+    return map;
+}
+
+std::vector<uint8_t> BluetoothClassicMultiplatformPlugin::ReadData(
     const flutter::EncodableValue* arguments) {
-    if (!arguments) return "";
+    if (!arguments) return {};
 
     const auto* args = std::get_if<flutter::EncodableMap>(arguments);
-    if (!args) return "";
+    if (!args) return {};
 
     auto address_it = args->find(flutter::EncodableValue("address"));
-    if (address_it == args->end()) return "";
+    if (address_it == args->end()) return {};
 
     const auto* address_str = std::get_if<std::string>(&address_it->second);
-    if (!address_str) return "";
-
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    auto data_it = received_data_.find(*address_str);
-    if (data_it != received_data_.end()) {
-        std::string data = data_it->second;
-        if (!data.empty()) {
-            data_it->second.clear();  // Clear after reading
-
-            // Debug: Log what's being returned to Flutter
-            std::string read_debug_msg = "ReadData returning " +
-                                         std::to_string(data.length()) +
-                                         " bytes: ";
-            size_t max_chars = data.length() < 50 ? data.length() : 50;
-            for (size_t k = 0; k < max_chars; k++) {
-                if (data[k] >= 32 && data[k] <= 126) {
-                    read_debug_msg += data[k];
-                } else {
-                    read_debug_msg +=
-                        "[" + std::to_string((unsigned char)data[k]) + "]";
-                }
-            }
-            if (data.length() > 50) read_debug_msg += "...";
-            read_debug_msg += "\n";
-            fprintf(stderr, read_debug_msg.c_str());
+    if (!address_str) return {};
 
-            // Return raw data exactly as received - no processing
-            return data;
-        }
-    }
+    auto connection = FindConnection(*address_str);
+    if (!connection) return {};
 
-    return "";
+    // Drained straight into the buffer that is moved into the reply.
+    std::vector<uint8_t> data;
+    connection->received->ReadAll(&data);
+    ResumeReadingIfPaused(*connection);
+    if (data.empty()) return {};
+
+    // Return raw data exactly as received - no processing
+    return data;
 }
 
 int BluetoothClassicMultiplatformPlugin::GetAvailableBytes(
@@ -733,10 +2080,9 @@ int BluetoothClassicMultiplatformPlugin::GetAvailableBytes(
     const auto* address_str = std::get_if<std::string>(&address_it->second);
     if (!address_str) return 0;
 
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    auto data_it = received_data_.find(*address_str);
-    if (data_it != received_data_.end()) {
-        int available = (int)data_it->second.length();
+    auto connection = FindConnection(*address_str);
+    if (connection) {
+        int available = (int)connection->received->Available();
         if (available > 0) {
             std::string debug_msg =
                 "GetAvailableBytes: " + std::to_string(available) +
@@ -762,66 +2108,248 @@ bool BluetoothClassicMultiplatformPlugin::FlushData(
     const auto* address_str = std::get_if<std::string>(&address_it->second);
     if (!address_str) return false;
 
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    received_data_[*address_str].clear();
+    auto connection = FindConnection(*address_str);
+    if (connection) {
+        connection->received->Clear();
+        ResumeReadingIfPaused(*connection);
+    }
     return true;
 }
 
-bool BluetoothClassicMultiplatformPlugin::WriteData(
-    const flutter::EncodableValue* arguments) {
-    if (!arguments) return false;
-
+void BluetoothClassicMultiplatformPlugin::WriteData(
+    const flutter::EncodableValue* arguments,
+    std::function<void(bool success)> on_done) {
     const auto* args = std::get_if<flutter::EncodableMap>(arguments);
-    if (!args) return false;
+    if (!args) return on_done(false);
 
     auto address_it = args->find(flutter::EncodableValue("address"));
     auto data_it = args->find(flutter::EncodableValue("data"));
 
-    if (address_it == args->end() || data_it == args->end()) return false;
+    if (address_it == args->end() || data_it == args->end()) {
+        return on_done(false);
+    }
 
     const auto* address_str = std::get_if<std::string>(&address_it->second);
 
-    if (!address_str) return false;
+    if (!address_str) return on_done(false);
+
+    auto connection = FindConnection(*address_str);
+    if (!connection) return on_done(false);
+
+    // A Uint8List arrives as bytes, a String as UTF-8; both are sent from
+    // the codec's own storage.
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    if (const auto* bytes =
+            std::get_if<std::vector<uint8_t>>(&data_it->second)) {
+        data = bytes->data();
+        size = bytes->size();
+    } else if (const auto* text = std::get_if<std::string>(&data_it->second)) {
+        data = reinterpret_cast<const uint8_t*>(text->data());
+        size = text->size();
+    }
+
+    if (size == 0) return on_done(false);
+
+    std::string address = *address_str;
+    QueueWrite(connection, data, size, WritePriority::kNormal,
+               std::chrono::microseconds(0),
+               [on_done, size, address](int error) {
+                   if (error == 0) {
+                       std::string debug_msg =
+                           "WriteData: Sent " + std::to_string(size) +
+                           " bytes to " + address + "\n";
+                       fprintf(stderr, "%s", debug_msg.c_str());
+                   }
+                   on_done(error == 0);
+               });
+}
 
-    auto sock_it = connected_sockets_.find(*address_str);
-    if (sock_it == connected_sockets_.end()) return false;
-
-    // Handle both string and binary data
-    const char* data_ptr = nullptr;
-    size_t data_len = 0;
-
-    if (const auto* data_str = std::get_if<std::string>(&data_it->second)) {
-        data_ptr = data_str->c_str();
-        data_len = data_str->length();
-    } else if (const auto* data_list =
-                   std::get_if<flutter::EncodableList>(&data_it->second)) {
-        // Handle binary data as list of bytes
-        static std::vector<char> byte_buffer;
-        byte_buffer.clear();
-        byte_buffer.reserve(data_list->size());
-
-        for (const auto& byte_val : *data_list) {
-            if (const auto* byte_int = std::get_if<int>(&byte_val)) {
-                byte_buffer.push_back(static_cast<char>(*byte_int));
+void BluetoothClassicMultiplatformPlugin::QueueWrite(
+    const std::shared_ptr<Connection>& connection, const uint8_t* data,
+    size_t size, WritePriority priority, std::chrono::microseconds timeout,
+    std::function<void(int error)> on_done) {
+    // Completions come from the workers (or from a Remove() on any
+    // thread); results may only be sent from the platform thread.
+    std::weak_ptr<Connection> weak_connection = connection;
+    WriteCallback on_sent = [this, on_done, weak_connection](int error) {
+        if (!task_runner_) return on_done(error);
+        task_runner_->PostTask([this, on_done, error, weak_connection]() {
+            on_done(error);
+            if (error == kWriteTimedOut) CloseIfWritesTimedOut(weak_connection);
+        });
+    };
+
+    WriteQueue::Clock::time_point deadline;
+    if (timeout.count() > 0) deadline = WriteQueue::Clock::now() + timeout;
+    WriteQueue& queue = *connection->outgoing;
+    bool flush = false;
+    bool queued = true;
+    if (queue.BeginDirectSend(size, priority)) {
+        size_t sent = 0;
+        {
+            std::lock_guard<std::mutex> lock(connection->socket_mutex);
+            if (connection->socket != INVALID_SOCKET) {
+                sent = SendAvailable(connection->socket, data, size);
             }
         }
-
-        data_ptr = byte_buffer.data();
-        data_len = byte_buffer.size();
+        std::vector<uint8_t> rest;
+        if (sent < size) {
+            rest = queue.TakeBuffer();
+            rest.assign(data + sent, data + size);
+        }
+        // Completed here and now if the socket took everything.
+        queued = sent < size;
+        flush = queue.EndDirectSend(
+            sent, std::move(rest),
+            queued ? std::move(on_sent) : std::move(on_done), deadline);
+    } else {
+        std::vector<uint8_t> copy = queue.TakeBuffer();
+        copy.assign(data, data + size);
+        flush = queue.Push(std::move(copy), std::move(on_sent), priority,
+                           deadline);
     }
+    if (flush) FlushWrites(*connection);
+    if (queued && timeout.count() > 0) {
+        std::lock_guard<std::mutex> lock(connection->socket_mutex);
+        if (connection->socket != INVALID_SOCKET) {
+            io_reactor_->WatchDeadline(connection->socket, deadline);
+        }
+    }
+}
 
-    if (data_ptr && data_len > 0) {
-        int bytes_sent = send(sock_it->second, data_ptr, (int)data_len, 0);
-        if (bytes_sent > 0) {
-            std::string debug_msg = "WriteData: Sent " +
-                                    std::to_string(bytes_sent) + " bytes to " +
-                                    *address_str + "\n";
-            fprintf(stderr, debug_msg.c_str());
-            return true;
+void BluetoothClassicMultiplatformPlugin::QueueWriteBatch(
+    const std::vector<BatchWrite>& writes, WritePriority priority,
+    std::chrono::microseconds timeout, std::function<void(int error)> on_done) {
+    if (writes.empty()) return on_done(0);
+    // Shared by the writes; the last one to complete reports the first
+    // error any of them had.
+    auto batch = std::make_shared<WriteBatchCompletion>(writes.size(),
+                                                        std::move(on_done));
+
+    WriteQueue::Clock::time_point deadline;
+    if (timeout.count() > 0) deadline = WriteQueue::Clock::now() + timeout;
+    std::vector<Connection*> flush;
+    std::vector<Connection*> touched;
+    for (const auto& write : writes) {
+        Connection& connection = *write.connection;
+        std::weak_ptr<Connection> weak_connection = write.connection;
+        WriteCallback on_sent = [this, batch, weak_connection](int error) {
+            bool last = batch->Complete(error);
+            if (!last && error != kWriteTimedOut) return;
+            auto finish = [this, batch, error, last, weak_connection]() {
+                if (last) batch->Finish();
+                if (error == kWriteTimedOut) {
+                    CloseIfWritesTimedOut(weak_connection);
+                }
+            };
+            if (!task_runner_) return finish();
+            task_runner_->PostTask(std::move(finish));
+        };
+        // No direct send: that only pays off while the queue is idle, which
+        // lasts for the first buffer at most.
+        std::vector<uint8_t> copy = connection.outgoing->TakeBuffer();
+        copy.assign(write.bytes->begin(), write.bytes->end());
+        if (connection.outgoing->Push(std::move(copy), std::move(on_sent),
+                                      priority, deadline)) {
+            flush.push_back(&connection);
+        }
+        if (std::find(touched.begin(), touched.end(), &connection) ==
+            touched.end()) {
+            touched.push_back(&connection);
+        }
+    }
+    // One drainer and one deadline per connection, not per buffer.
+    for (Connection* connection : flush) FlushWrites(*connection);
+    if (timeout.count() == 0) return;
+    for (Connection* connection : touched) {
+        std::lock_guard<std::mutex> lock(connection->socket_mutex);
+        if (connection->socket != INVALID_SOCKET) {
+            io_reactor_->WatchDeadline(connection->socket, deadline);
         }
     }
+}
 
-    return false;
+void BluetoothClassicMultiplatformPlugin::CloseIfWritesTimedOut(
+    const std::weak_ptr<Connection>& weak_connection) {
+    auto connection = weak_connection.lock();
+    // A write that timed out before it started was just dropped. One that
+    // broke off left the stream with no way to carry on, and the link had
+    // stopped taking data: the connection is closed like a lost one.
+    if (!connection || !connection->outgoing->GetStats().timed_out ||
+        FindConnection(connection->id) != connection) {
+        return;
+    }
+    CloseConnection(connection->address);
+}
+
+void BluetoothClassicMultiplatformPlugin::FlushWrites(Connection& connection) {
+    std::lock_guard<std::mutex> lock(connection.socket_mutex);
+    // Without a socket the queue is closed and fails the write itself.
+    if (connection.socket != INVALID_SOCKET) {
+        io_reactor_->Flush(connection.socket);
+    }
+}
+
+void BluetoothClassicMultiplatformPlugin::SendFile(
+    const std::shared_ptr<Connection>& connection,
+    std::unique_ptr<MappedFile> file, size_t chunk_size, int64_t transfer_id,
+    std::function<void(int error)> on_done) {
+    // At most one progress event is posted at a time; it reports the count
+    // when it runs, so a burst of chunks yields one event.
+    struct Progress {
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<bool> posted{false};
+    };
+    auto progress = std::make_shared<Progress>();
+    int connection_id = connection->id;
+    uint64_t total = file->size();
+
+    FileTransfer::Callbacks callbacks;
+    std::weak_ptr<Connection> weak_connection = connection;
+    callbacks.flush = [this, weak_connection]() {
+        // Asked on a worker, which must not wait for socket_mutex: Remove()
+        // holds it while it waits for the workers.
+        if (!task_runner_) return;
+        task_runner_->PostTask([this, weak_connection]() {
+            if (auto connection = weak_connection.lock()) {
+                FlushWrites(*connection);
+            }
+        });
+    };
+    callbacks.on_progress = [this, progress, transfer_id, connection_id,
+                             total](uint64_t bytes_sent, uint64_t) {
+        progress->bytes_sent = bytes_sent;
+        if (!task_runner_ || progress->posted.exchange(true)) return;
+        task_runner_->PostTask(
+            [this, progress, transfer_id, connection_id, total]() {
+                progress->posted = false;
+                auto* handler = file_transfer_handler_ptr;
+                if (!handler || !handler->sink) return;
+                handler->sink->Success(flutter::EncodableValue(
+                    flutter::EncodableMap{
+                        {flutter::EncodableValue("transferId"),
+                         flutter::EncodableValue(transfer_id)},
+                        {flutter::EncodableValue("id"),
+                         flutter::EncodableValue(connection_id)},
+                        {flutter::EncodableValue("bytesSent"),
+                         flutter::EncodableValue(static_cast<int64_t>(
+                             progress->bytes_sent.load()))},
+                        {flutter::EncodableValue("totalBytes"),
+                         flutter::EncodableValue(static_cast<int64_t>(total))},
+                    }));
+            });
+    };
+    // Posted after the last progress event, so Dart sees that first.
+    callbacks.on_done = [this, on_done](int error) {
+        if (!task_runner_) return on_done(error);
+        task_runner_->PostTask([on_done, error]() { on_done(error); });
+    };
+
+    auto transfer = std::make_shared<FileTransfer>(
+        std::move(file), chunk_size, connection->outgoing,
+        std::move(callbacks));
+    if (transfer->Start()) FlushWrites(*connection);
 }
 
 void BluetoothClassicMultiplatformPlugin::CleanupDataChannels(
@@ -835,11 +2363,11 @@ void BluetoothClassicMultiplatformPlugin::CleanupDataChannels(
                     std::get_if<std::string>(&address_it->second);
                 if (address_str) {
                     // Stop data listening for this device
-                    listening_devices_.erase(*address_str);
+                    StopDataListening(*address_str);
 
                     // Clear buffered data
-                    std::lock_guard<std::mutex> lock(data_mutex_);
-                    received_data_.erase(*address_str);
+                    auto connection = FindConnection(*address_str);
+                    if (connection) connection->received->Clear();
 
                     fprintf(stderr,
                             "CleanupDataChannels: Cleaned up data channels\n");
@@ -848,9 +2376,10 @@ void BluetoothClassicMultiplatformPlugin::CleanupDataChannels(
         }
     } else {
         // Clean up all data channels if no specific device
-        listening_devices_.clear();
-        std::lock_guard<std::mutex> lock(data_mutex_);
-        received_data_.clear();
+        for (const auto& connection : connections_.Snapshot()) {
+            StopDataListening(connection->address);
+            connection->received->Clear();
+        }
         fprintf(stderr, "CleanupDataChannels: Cleaned up all data channels\n");
     }
 }
@@ -866,7 +2395,7 @@ void BluetoothClassicMultiplatformPlugin::CancelDataChannel(
                     std::get_if<std::string>(&address_it->second);
                 if (address_str) {
                     // Stop listening for this device
-                    listening_devices_.erase(*address_str);
+                    StopDataListening(*address_str);
                     fprintf(stderr,
                             "CancelDataChannel: Cancelled data channel\n");
                 }
@@ -886,10 +2415,10 @@ void BluetoothClassicMultiplatformPlugin::CloseDataChannel(
                     std::get_if<std::string>(&address_it->second);
                 if (address_str) {
                     // Stop listening and clear data
-                    listening_devices_.erase(*address_str);
+                    StopDataListening(*address_str);
 
-                    std::lock_guard<std::mutex> lock(data_mutex_);
-                    received_data_.erase(*address_str);
+                    auto connection = FindConnection(*address_str);
+                    if (connection) connection->received->Clear();
 
                     fprintf(stderr, "CloseDataChannel: Closed data channel\n");
                 }
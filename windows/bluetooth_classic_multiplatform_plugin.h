@@ -1,18 +1,32 @@
 #ifndef FLUTTER_PLUGIN_BLUETOOTH_CLASSIC_MULTIPLATFORM_PLUGIN_H_
 #define FLUTTER_PLUGIN_BLUETOOTH_CLASSIC_MULTIPLATFORM_PLUGIN_H_
 
+#include <flutter/event_channel.h>
 #include <flutter/method_channel.h>
 #include <flutter/plugin_registrar_windows.h>
 #include <flutter/standard_method_codec.h>
 
-#include <map>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <mutex>
-#include <set>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "channel_cache.h"
+#include "channel_prober.h"
+#include "connect_batch.h"
+#include "connection_table.h"
+#include "io_reactor.h"
+#include "mapped_file.h"
+#include "platform_task_runner.h"
 #include "sink_stream_handler.h"
+#include "receive_buffer.h"
+#include "reconnect_backoff.h"
+#include "write_queue.h"
 
 namespace bluetooth_classic_multiplatform {
 
@@ -37,22 +51,236 @@ class BluetoothClassicMultiplatformPlugin : public flutter::Plugin {
         std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
    private:
+    // Per-connection settings passed to connect().
+    struct ConnectionOptions {
+        std::chrono::microseconds read_coalescing_window{0};
+        size_t receive_buffer_size = 0;
+        OverflowPolicy overflow_policy = OverflowPolicy::kBackpressure;
+        // SO_RCVBUF / SO_SNDBUF; zero keeps the system default.
+        int socket_receive_buffer_size = 0;
+        int socket_send_buffer_size = 0;
+        // Off unless both writeCoalescing arguments are given.
+        WriteCoalescing write_coalescing;
+        // Off unless writeRateBytesPerSecond is given.
+        WriteRateLimit write_rate_limit;
+        // Set by autoReconnect: a dropped link is brought back under the
+        // same id, with the writes that had not started on it.
+        bool auto_reconnect = false;
+        ReconnectPolicy reconnect_policy;
+    };
+
+    // How connect() reached the device; reported with the connection stats.
+    struct ConnectTiming {
+        std::chrono::microseconds total{0};
+        std::chrono::microseconds sdp_lookup{0};
+        int channel = 0;
+        // The channel that worked last time accepted again.
+        bool from_cache = false;
+        // The channel SDP named accepted. With neither, it came from
+        // probing.
+        bool from_sdp = false;
+        // Connects started, including those given up once another won.
+        size_t channels_tried = 0;
+    };
+
+    enum class ConnectionState {
+        // Open, but the reactor is not reading it.
+        kConnected,
+        // Registered with the reactor.
+        kReading,
+        // The link dropped and is being brought back; writes wait for it.
+        kReconnecting,
+        // Socket closed; the entry only lingers for callers holding it.
+        kClosed,
+    };
+
+    // Brings a dropped link back: attempts spaced by |backoff| on a worker
+    // of its own until one connects, |cancellation| stops them or the
+    // policy gives up.
+    struct Reconnect {
+        explicit Reconnect(const ReconnectPolicy& policy) : backoff(policy) {}
+
+        ConnectCancellation cancellation;
+        ReconnectBackoff backoff;
+        std::thread worker;
+        std::chrono::steady_clock::time_point dropped_at;
+        // What the link dropped with; 0 if the device closed it.
+        int error = 0;
+    };
+
+    // One open RFCOMM connection: its socket, state and receive path kept
+    // together and reached by id. Received data is pushed to Dart over
+    // "<TAG>/connection/<id>" - the channel BluetoothConnection listens on.
+    struct Connection {
+        int id;
+        std::string address;
+        // Guards |socket| against being closed while it is in use.
+        std::mutex socket_mutex;
+        SOCKET socket = INVALID_SOCKET;
+        std::atomic<ConnectionState> state{ConnectionState::kConnected};
+        // Bytes are held back this long after the first one arrives so that
+        // bursts reach Dart as a single event. Zero pushes every read.
+        std::chrono::microseconds coalescing_window{0};
+        std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>>
+            channel;
+        // Only touched on the platform thread.
+        std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> sink;
+        // Written by the I/O thread, drained on the platform thread.
+        std::unique_ptr<ReceiveBuffer> received;
+        // Dart is subscribed to the event channel.
+        std::atomic<bool> listening{false};
+        std::atomic<bool> delivery_scheduled{false};
+        // Set once an overflow under OverflowPolicy::kDisconnect has
+        // queued the close.
+        std::atomic<bool> overflow_close_posted{false};
+        // Outbound bytes, sent from the reactor's workers.
+        std::shared_ptr<WriteQueue> outgoing = std::make_shared<WriteQueue>();
+        ConnectTiming connect_timing;
+        // What connect() was called with, to reconnect the same way.
+        flutter::EncodableValue connect_arguments;
+        ConnectionOptions options;
+        // Times the link was brought back. Platform thread only.
+        int64_t reconnects = 0;
+    };
+
     // Bluetooth helper methods
     bool IsBluetoothAvailable();
     bool IsBluetoothEnabled();
     void OpenBluetoothSettings();
     flutter::EncodableList GetPairedDevices();
     void StartDiscovery();
-    bool ConnectToDevice(const flutter::EncodableValue* arguments);
+    // Connects to the channel cached for the device and the "uuid" argument
+    // (SPP by default), else to the one SDP names for it, probing the other
+    // channels a few at a time if that fails too. Gives up once
+    // |cancellation| says so, with |error| set to kConnectCancelled or
+    // kConnectTimedOut; it is 0 after other failures. Blocks; any thread.
+    bool ConnectToDevice(const flutter::EncodableValue* arguments,
+                         const ConnectionOptions& options,
+                         const ConnectCancellation& cancellation,
+                         SOCKET* connected_socket, ConnectTiming* timing,
+                         int* error);
+    // Runs ConnectToDevice() for each of |addresses| on threads of their
+    // own, at most |parallelism| at a time, each given |timeout| from when
+    // it starts (none if zero). |on_result| runs on the platform thread as
+    // each finishes, with the new connection's id or the error, and
+    // |on_done| after the last.
+    using ConnectResultCallback =
+        std::function<void(const std::string& address, int id, int error)>;
+    void StartConnectJob(const std::vector<std::string>& addresses,
+                         const flutter::EncodableMap& arguments,
+                         const ConnectionOptions& options,
+                         size_t parallelism,
+                         std::chrono::microseconds timeout,
+                         ConnectResultCallback on_result,
+                         std::function<void()> on_done);
+    // Connects started together by StartConnectJob().
+    struct ConnectJob {
+        ConnectJob(std::vector<std::string> addresses,
+                   std::chrono::microseconds timeout)
+            : batch(std::move(addresses), timeout) {}
+
+        int id = 0;
+        // The devices, and per device the connect() arguments naming it.
+        ConnectBatch batch;
+        std::vector<flutter::EncodableValue> arguments;
+        ConnectionOptions options;
+        std::vector<std::thread> workers;
+        ConnectResultCallback on_result;
+        std::function<void()> on_done;
+    };
+    // A worker of |job|: connects to its devices until none is left.
+    void RunConnectJob(const std::shared_ptr<ConnectJob>& job);
+    // Registers the connection a worker made to device |index| of |job|,
+    // or passes on why there is none.
+    void FinishJobConnect(const std::shared_ptr<ConnectJob>& job,
+                          size_t index, SOCKET socket,
+                          const ConnectTiming& timing, int error);
+    // Cancels the connect under way to "address"; false if there is none.
+    bool CancelConnect(const flutter::EncodableValue* arguments);
     bool DisconnectDevice(const flutter::EncodableValue* arguments);
     bool IsDeviceConnected(const flutter::EncodableValue* arguments);
-    bool WriteData(const flutter::EncodableValue* arguments);
-    std::string ReadData(const flutter::EncodableValue* arguments);
+    void WriteData(const flutter::EncodableValue* arguments,
+                   std::function<void(bool success)> on_done);
+    std::vector<uint8_t> ReadData(const flutter::EncodableValue* arguments);
     flutter::EncodableList GetConnectedDevices();
 
     // Data streaming methods
     void StartDataListening(const std::string& device_address);
-    void DataListeningThread(const std::string& device_address, SOCKET sock);
+    void StopDataListening(const std::string& device_address);
+    // Registers the socket of |connection| with the reactor; false if it
+    // cannot be read.
+    bool ReadConnection(const std::shared_ptr<Connection>& connection);
+    void OnDataReceived(const std::shared_ptr<Connection>& connection,
+                        const uint8_t* data, size_t size);
+
+    // Connection table
+    static bool ParseConnectionOptions(const flutter::EncodableValue* arguments,
+                                       ConnectionOptions* options);
+    int RegisterConnection(const std::string& device_address, SOCKET socket,
+                           const flutter::EncodableValue& arguments,
+                           const ConnectionOptions& options,
+                           const ConnectTiming& timing);
+    void UnregisterConnection(const std::string& device_address);
+    void ScheduleDelivery(const std::shared_ptr<Connection>& connection);
+    void DeliverReceivedData(const std::shared_ptr<Connection>& connection);
+    std::shared_ptr<Connection> FindConnection(
+        const std::string& device_address);
+    std::shared_ptr<Connection> FindConnection(int64_t id);
+    void CloseConnectionSocket(Connection& connection);
+    void ResumeReadingIfPaused(Connection& connection);
+    void CloseConnection(const std::string& device_address);
+    // Supervision of connections made with autoReconnect. The link of
+    // |connection| dropped with |error|: its socket goes, and attempts to
+    // bring it back start; Dart hears of each on "<TAG>/connectionState".
+    void StartReconnect(const std::shared_ptr<Connection>& connection,
+                        int error);
+    // The worker of |reconnect|.
+    void RunReconnect(const std::shared_ptr<Connection>& connection,
+                      const std::shared_ptr<Reconnect>& reconnect);
+    // Puts the new link's |socket| in place of the old one, or closes the
+    // connection if there is none.
+    void FinishReconnect(const std::shared_ptr<Connection>& connection,
+                         SOCKET socket, const ConnectTiming& timing);
+    void SendConnectionState(const Connection& connection,
+                             const char* state, flutter::EncodableMap event);
+    // Writes |size| bytes at |data| to |connection| without blocking; must
+    // be called on the platform thread. If nothing is queued they go to the
+    // socket straight from |data|, and only what it does not take at once
+    // is copied into the queue; a |priority| write goes ahead of queued
+    // ones of a lower class. |on_done| runs on the platform thread once
+    // the transport took every byte (error 0) or the write failed; with a
+    // nonzero |timeout| it fails with kWriteTimedOut once that passed, and
+    // the connection is closed if the write had started by then.
+    void QueueWrite(const std::shared_ptr<Connection>& connection,
+                    const uint8_t* data, size_t size, WritePriority priority,
+                    std::chrono::microseconds timeout,
+                    std::function<void(int error)> on_done);
+    // One buffer of a "writeBatch" call, borrowed from its arguments.
+    struct BatchWrite {
+        std::shared_ptr<Connection> connection;
+        const std::vector<uint8_t>* bytes;
+    };
+    // Queues every buffer of |writes| on its connection, in order, and
+    // starts each connection's drainer once. |on_done| runs once on the
+    // platform thread after all of them completed, with the first error
+    // any of them had; |priority| and |timeout| apply as in QueueWrite().
+    void QueueWriteBatch(const std::vector<BatchWrite>& writes,
+                         WritePriority priority,
+                         std::chrono::microseconds timeout,
+                         std::function<void(int error)> on_done);
+    // Closes |connection| once a write timed out after it started.
+    void CloseIfWritesTimedOut(
+        const std::weak_ptr<Connection>& weak_connection);
+    // Starts a drainer for the writes queued on |connection|.
+    void FlushWrites(Connection& connection);
+    // Streams |file| to |connection| in |chunk_size| chunks without further
+    // calls from Dart, posting progress events tagged |transfer_id| on
+    // "<TAG>/fileTransfers". |on_done| runs on the platform thread once the
+    // transport took the whole file (error 0) or a chunk failed.
+    void SendFile(const std::shared_ptr<Connection>& connection,
+                  std::unique_ptr<MappedFile> file, size_t chunk_size,
+                  int64_t transfer_id, std::function<void(int error)> on_done);
+    flutter::EncodableMap GetConnectionStats(Connection& connection);
     int GetAvailableBytes(const flutter::EncodableValue* arguments);
     bool FlushData(const flutter::EncodableValue* arguments);
 
@@ -67,13 +295,44 @@ class BluetoothClassicMultiplatformPlugin : public flutter::Plugin {
 
     // Discovery channel
     SinkStreamHandler* discovery_handler_ptr;
+    // sendFile() progress channel
+    SinkStreamHandler* file_transfer_handler_ptr = nullptr;
+    // connectMany() results channel
+    SinkStreamHandler* connect_results_handler_ptr = nullptr;
+    // Reconnect progress of connections made with autoReconnect
+    SinkStreamHandler* connection_state_handler_ptr = nullptr;
 
-    // Store connected sockets and data
-    std::map<std::string, SOCKET> connected_sockets_;
-    std::set<std::string> listening_devices_;
-    std::map<std::string, std::string> received_data_;
-    std::mutex data_mutex_;
     flutter::PluginRegistrarWindows* registrar;
+
+    // Open connections by the id handed out to Dart.
+    ConnectionTable<Connection> connections_;
+    // Ids of the open connections by device address, for the method calls
+    // that name a device. Platform thread only.
+    std::unordered_map<std::string, int> connection_ids_;
+
+    // Connects under way by device address, for cancelConnect. Platform
+    // thread only.
+    std::unordered_map<std::string, std::shared_ptr<ConnectCancellation>>
+        pending_connects_;
+    // Jobs with devices left, by id. Platform thread only.
+    std::unordered_map<int, std::shared_ptr<ConnectJob>> connect_jobs_;
+    int next_connect_job_id_ = 1;
+    // Links being brought back, by connection id. Platform thread only.
+    std::unordered_map<int, std::shared_ptr<Reconnect>> reconnects_;
+
+    // Set once WSAStartup() succeeded; paired with WSACleanup() on
+    // destruction.
+    bool winsock_started_ = false;
+
+    // Last working RFCOMM channel by device and service.
+    std::unique_ptr<ChannelCache> channel_cache_;
+
+    // Null until registered, e.g. when constructed directly by tests.
+    std::unique_ptr<PlatformTaskRunner> task_runner_;
+
+    // Receives data for all listening sockets. Declared last so its workers are
+    // joined before the state its callbacks touch is destroyed.
+    std::unique_ptr<IoReactor> io_reactor_;
 };
 
 }  // namespace bluetooth_classic_multiplatform
@@ -9,16 +9,133 @@
 #include <winrt/Windows.Devices.Enumeration.h>
 #include <winrt/Windows.Foundation.h>
 #include <winrt/Windows.Networking.Sockets.h>
+#include <winrt/Windows.Networking.h>
 #include <winrt/Windows.Storage.Streams.h>
 #include <winrt/Windows.System.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <memory>
 #include <sstream>
+#include <utility>
+
+#include "adaptive_read_size.h"
 
 namespace bluetooth_classic_multiplatform {
 
 std::string TAG = "bluetooth_classic_multiplatform";
 
+// Reads an optional integer argument; the codec decodes Dart ints as either
+// 32 or 64 bit depending on their value.
+static bool GetIntArgument(const flutter::EncodableMap& args, const char* key,
+                           int64_t* value) {
+    auto it = args.find(flutter::EncodableValue(key));
+    if (it == args.end()) return false;
+    if (const auto* value32 = std::get_if<int32_t>(&it->second)) {
+        *value = *value32;
+        return true;
+    }
+    if (const auto* value64 = std::get_if<int64_t>(&it->second)) {
+        *value = *value64;
+        return true;
+    }
+    return false;
+}
+
+// Reads the optional "priority" and "timeoutMicros" of "writeData" and
+// "writeBatch". "high" goes ahead of the writes queued so far; a timeout of
+// 0 waits for as long as the write takes.
+static bool ParseWriteOptions(const flutter::EncodableMap& args,
+                              WritePriority* priority,
+                              std::chrono::microseconds* timeout) {
+    auto priority_it = args.find(flutter::EncodableValue("priority"));
+    if (priority_it != args.end()) {
+        const auto* name = std::get_if<std::string>(&priority_it->second);
+        if (name && !ParseWritePriority(*name, priority)) return false;
+    }
+    int64_t timeout_us = 0;
+    GetIntArgument(args, "timeoutMicros", &timeout_us);
+    if (timeout_us < 0) return false;
+    *timeout = std::chrono::microseconds(timeout_us);
+    return true;
+}
+
+// Completes a "writeData" or "writeBatch" call with the error of its writes.
+static void CompleteWrite(
+    flutter::MethodResult<flutter::EncodableValue>& result, int error) {
+    if (error == kWriteTimedOut) {
+        result.Error("writeTimeout",
+                     "Write did not complete within its timeout.",
+                     flutter::EncodableValue(error));
+    } else {
+        result.Success(flutter::EncodableValue(error == 0));
+    }
+}
+
+// Service cached unless connect() names one: the Serial Port Profile.
+constexpr char kSerialPortServiceUuid[] =
+    "00001101-0000-1000-8000-00805F9B34FB";
+
+// |file_name| in the plugin's folder under %LOCALAPPDATA%, or in the
+// working directory if that is not set.
+static std::filesystem::path GetChannelCachePath(const wchar_t* file_name) {
+    wchar_t local_app_data[MAX_PATH];
+    DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", local_app_data,
+                                           MAX_PATH);
+    if (length == 0 || length >= MAX_PATH) return file_name;
+    return std::filesystem::path(local_app_data) /
+           L"bluetooth_classic_multiplatform" / file_name;
+}
+
+// Queued writes gathered into one WriteAsync().
+constexpr size_t kMaxSendSpans = 16;
+
+// Reads the optional write coalescing settings of "connect".
+static WriteCoalescing ParseWriteCoalescing(const flutter::EncodableMap& args) {
+    WriteCoalescing coalescing;
+    int64_t max_bytes = 0;
+    int64_t window_us = 0;
+    if (GetIntArgument(args, "writeCoalescingBytes", &max_bytes) &&
+        GetIntArgument(args, "writeCoalescingWindowMicros", &window_us) &&
+        max_bytes > 0 && window_us > 0) {
+        coalescing.max_bytes = static_cast<size_t>(max_bytes);
+        coalescing.max_delay = std::chrono::microseconds(window_us);
+    }
+    return coalescing;
+}
+
+// Reads the optional write rate limit of "connect"; the burst defaults to
+// 10 ms worth.
+static WriteRateLimit ParseWriteRateLimit(const flutter::EncodableMap& args) {
+    WriteRateLimit limit;
+    int64_t rate = 0;
+    if (GetIntArgument(args, "writeRateBytesPerSecond", &rate) && rate > 0) {
+        limit.bytes_per_second = static_cast<uint64_t>(rate);
+        int64_t burst = std::max<int64_t>(rate / 100, 1);
+        GetIntArgument(args, "writeBurstBytes", &burst);
+        limit.burst_bytes = static_cast<size_t>(std::max<int64_t>(burst, 1));
+    }
+    return limit;
+}
+
+// Runs |task| in |context|; used to complete method results on the platform
+// thread from WinRT completions.
+static winrt::fire_and_forget RunOn(winrt::apartment_context context,
+                                    std::function<void()> task) {
+    co_await context;
+    task();
+}
+
+// Receive and send buffers kept for reuse once their loop is done.
+constexpr size_t kMaxPooledBuffers = 8;
+
+// Capacity of the empty buffer ReadData hands back to the reader thread, so
+// refilling it does not start with a string of small reallocations.
+constexpr size_t kReceiveBufferReserve = 4096;
+
 // static
 void BluetoothClassicMultiplatformPlugin::RegisterWithRegistrar(
     flutter::PluginRegistrarWindows* registrar) {
@@ -81,9 +198,22 @@ void BluetoothClassicMultiplatformPlugin::RegisterWithRegistrar(
     registrar->AddPlugin(std::move(plugin));
 }
 
-BluetoothClassicMultiplatformPlugin::BluetoothClassicMultiplatformPlugin() {}
-
-BluetoothClassicMultiplatformPlugin::~BluetoothClassicMultiplatformPlugin() {}
+BluetoothClassicMultiplatformPlugin::BluetoothClassicMultiplatformPlugin()
+    : channel_cache_(std::make_unique<ChannelCache>(
+          GetChannelCachePath(L"rfcomm_services.txt"))) {}
+
+BluetoothClassicMultiplatformPlugin::~BluetoothClassicMultiplatformPlugin() {
+    // Cancels the pending reads and closes the sockets; the receive and
+    // send loops then unwind on their completions, which must happen before
+    // the members they use go away. They resume on the thread pool, never on
+    // this thread, so waiting for them here cannot stall them.
+    DisconnectDevice(nullptr);
+    for (const auto& pending : pending_connects_) {
+        StopConnect(*pending.second, ConnectStop::kCancelled);
+    }
+    std::unique_lock<std::mutex> lock(loops_mutex_);
+    loops_done_.wait(lock, [this]() { return active_loops_ == 0; });
+}
 
 void BluetoothClassicMultiplatformPlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue>& method_call,
@@ -108,8 +238,7 @@ void BluetoothClassicMultiplatformPlugin::HandleMethodCall(
 
                         // Always start data listening if device is connected
                         // (like Android)
-                        if (connected_sockets_.find(*device_str) !=
-                            connected_sockets_.end()) {
+                        if (FindConnection(*device_str)) {
                             StartDataListening(*device_str);
                             OutputDebugStringA(
                                 "Data listening started for device\n");
@@ -167,22 +296,10 @@ void BluetoothClassicMultiplatformPlugin::HandleMethodCall(
         result->Success(flutter::EncodableValue(IsBluetoothEnabled()));
     } else if (method == "connect") {
         OutputDebugStringA("HandleMethodCall: Connect method called\n");
-        bool success = ConnectToDevice(method_call.arguments());
-        if (success) {
-            OutputDebugStringA(
-                "HandleMethodCall: Connection successful, notifying state "
-                "change\n");
-            NotifyConnectionStateChange(method_call.arguments(), true);
-
-            // Don't auto-start data listening here - let Flutter app call
-            // listen when ready
-            OutputDebugStringA(
-                "Connection established, waiting for data channel listen "
-                "request\n");
-        } else {
-            OutputDebugStringA("HandleMethodCall: Connection failed\n");
-        }
-        result->Success(flutter::EncodableValue(success));
+        ConnectToDevice(method_call.arguments(), std::move(result));
+    } else if (method == "cancelConnect") {
+        result->Success(
+            flutter::EncodableValue(CancelConnect(method_call.arguments())));
     } else if (method == "disconnect") {
         bool success = DisconnectDevice(method_call.arguments());
         // Send disconnection state change event and cleanup data channels
@@ -198,11 +315,34 @@ void BluetoothClassicMultiplatformPlugin::HandleMethodCall(
 
     // Data channel methods
     else if (method == "writeData") {
-        bool success = WriteData(method_call.arguments());
-        result->Success(flutter::EncodableValue(success));
+        std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            pending = std::move(result);
+        WriteData(method_call.arguments(), [pending](int error) {
+            CompleteWrite(*pending, error);
+        });
+    } else if (method == "writeBatch") {
+        std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            pending = std::move(result);
+        WriteBatch(method_call.arguments(), [pending](int error) {
+            CompleteWrite(*pending, error);
+        });
+    } else if (method == "channelCacheStats") {
+        ChannelCacheStats stats = channel_cache_->GetStats();
+        result->Success(flutter::EncodableValue(flutter::EncodableMap{
+            {flutter::EncodableValue("hits"),
+             flutter::EncodableValue(static_cast<int64_t>(stats.hits))},
+            {flutter::EncodableValue("misses"),
+             flutter::EncodableValue(static_cast<int64_t>(stats.misses))},
+            {flutter::EncodableValue("invalidations"),
+             flutter::EncodableValue(
+                 static_cast<int64_t>(stats.invalidations))},
+            {flutter::EncodableValue("entries"),
+             flutter::EncodableValue(static_cast<int64_t>(stats.entries))},
+        }));
     } else if (method == "readData") {
-        std::string data = ReadData(method_call.arguments());
-        result->Success(flutter::EncodableValue(data));
+        std::vector<uint8_t> data = ReadData(method_call.arguments());
+        // Arrives in Dart as a Uint8List.
+        result->Success(flutter::EncodableValue(std::move(data)));
     } else if (method == "available") {
         int available = GetAvailableBytes(method_call.arguments());
         result->Success(flutter::EncodableValue(available));
@@ -332,7 +472,7 @@ flutter::EncodableList BluetoothClassicMultiplatformPlugin::StartDiscovery() {
 
 winrt::Windows::Devices::Bluetooth::BluetoothDevice
 BluetoothClassicMultiplatformPlugin::GetBluetoothDevice(
-    const std::string& address) {
+    const std::string& address, PendingConnect& pending) {
     try {
         // Convert address format from XX:XX:XX:XX:XX:XX to raw format
         std::string clean_address = address;
@@ -345,14 +485,15 @@ BluetoothClassicMultiplatformPlugin::GetBluetoothDevice(
         // Get device by address
         auto selector = winrt::Windows::Devices::Bluetooth::BluetoothDevice::
             GetDeviceSelectorFromBluetoothAddress(bt_address);
-        auto deviceInfos = winrt::Windows::Devices::Enumeration::
-                               DeviceInformation::FindAllAsync(selector)
-                                   .get();
+        auto deviceInfos = AwaitConnectStep(
+            pending, winrt::Windows::Devices::Enumeration::DeviceInformation::
+                         FindAllAsync(selector));
 
         if (deviceInfos.Size() > 0) {
-            return winrt::Windows::Devices::Bluetooth::BluetoothDevice::
-                FromIdAsync(deviceInfos.GetAt(0).Id())
-                    .get();
+            return AwaitConnectStep(
+                pending,
+                winrt::Windows::Devices::Bluetooth::BluetoothDevice::
+                    FromIdAsync(deviceInfos.GetAt(0).Id()));
         }
     } catch (...) {
         // Return null device if not found
@@ -363,10 +504,12 @@ BluetoothClassicMultiplatformPlugin::GetBluetoothDevice(
 
 winrt::Windows::Devices::Bluetooth::Rfcomm::RfcommDeviceService
 BluetoothClassicMultiplatformPlugin::GetRfcommService(
-    const winrt::Windows::Devices::Bluetooth::BluetoothDevice& device) {
+    const winrt::Windows::Devices::Bluetooth::BluetoothDevice& device,
+    PendingConnect& pending) {
     try {
         // Get RFCOMM services
-        auto services = device.GetRfcommServicesAsync().get();
+        auto services =
+            AwaitConnectStep(pending, device.GetRfcommServicesAsync());
 
         if (services.Services().Size() > 0) {
             // Return the first available service
@@ -383,10 +526,10 @@ flutter::EncodableList
 BluetoothClassicMultiplatformPlugin::GetConnectedDevices() {
     flutter::EncodableList devices;
 
-    for (const auto& pair : connected_sockets_) {
+    for (const auto& connection : connections_.Snapshot()) {
         flutter::EncodableMap device;
         device[flutter::EncodableValue("address")] =
-            flutter::EncodableValue(pair.first);
+            flutter::EncodableValue(connection->address);
         device[flutter::EncodableValue("name")] =
             flutter::EncodableValue("Connected Device");
         device[flutter::EncodableValue("type")] =
@@ -400,29 +543,34 @@ BluetoothClassicMultiplatformPlugin::GetConnectedDevices() {
     return devices;
 }
 
-bool BluetoothClassicMultiplatformPlugin::ConnectToDevice(
-    const flutter::EncodableValue* arguments) {
+void BluetoothClassicMultiplatformPlugin::ConnectToDevice(
+    const flutter::EncodableValue* arguments,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
     if (!arguments) {
         OutputDebugStringA("ConnectToDevice: No arguments provided\n");
-        return false;
+        result->Error("couldNotConnect", "No arguments provided");
+        return;
     }
 
     const auto* args = std::get_if<flutter::EncodableMap>(arguments);
     if (!args) {
         OutputDebugStringA("ConnectToDevice: Invalid arguments format\n");
-        return false;
+        result->Error("couldNotConnect", "Invalid arguments format");
+        return;
     }
 
     auto address_it = args->find(flutter::EncodableValue("address"));
     if (address_it == args->end()) {
         OutputDebugStringA("ConnectToDevice: No address provided\n");
-        return false;
+        result->Error("couldNotConnect", "No address provided");
+        return;
     }
 
     const auto* address_str = std::get_if<std::string>(&address_it->second);
     if (!address_str) {
         OutputDebugStringA("ConnectToDevice: Invalid address format\n");
-        return false;
+        result->Error("couldNotConnect", "Invalid address format");
+        return;
     }
 
     std::string debug_msg =
@@ -430,64 +578,253 @@ bool BluetoothClassicMultiplatformPlugin::ConnectToDevice(
     OutputDebugStringA(debug_msg.c_str());
 
     // Check if already connected
-    if (connected_sockets_.find(*address_str) != connected_sockets_.end()) {
+    if (auto existing = FindConnection(*address_str)) {
         OutputDebugStringA("ConnectToDevice: Device already connected\n");
-        return true;
+        result->Success(flutter::EncodableValue(existing->id));
+        return;
+    }
+    if (pending_connects_.count(*address_str)) {
+        result->Error("connectInProgress",
+                      "A connect to this device is under way");
+        return;
     }
 
-    try {
-        // Get Bluetooth device
-        auto device = GetBluetoothDevice(*address_str);
-        if (device == nullptr) {
-            OutputDebugStringA("ConnectToDevice: Device not found\n");
-            return false;
-        }
+    auto pending = std::make_shared<PendingConnect>();
+    pending_connects_[*address_str] = pending;
+    int64_t timeout_us = 0;
+    if (GetIntArgument(*args, "timeoutMicros", &timeout_us) &&
+        timeout_us > 0) {
+        StopConnectAfter(
+            pending, std::chrono::ceil<winrt::Windows::Foundation::TimeSpan>(
+                         std::chrono::microseconds(timeout_us)));
+    }
+    {
+        std::lock_guard<std::mutex> lock(loops_mutex_);
+        ++active_loops_;
+    }
+    ConnectInBackground(*args, *address_str, pending, std::move(result));
+}
+
+winrt::fire_and_forget BluetoothClassicMultiplatformPlugin::ConnectInBackground(
+    flutter::EncodableMap args, std::string address,
+    std::shared_ptr<PendingConnect> pending,
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    winrt::apartment_context platform_thread;
+    std::weak_ptr<bool> alive = alive_;
+    co_await winrt::resume_background();
+    auto socket = OpenSocket(args, address, *pending);
+    {
+        // The destructor only waits for the blocking part; it stops
+        // |pending| first, so that returns soon. It cannot wait for the
+        // rest, which runs on the thread it blocks.
+        std::lock_guard<std::mutex> lock(loops_mutex_);
+        --active_loops_;
+        loops_done_.notify_all();
+    }
+    co_await platform_thread;
+    // The destructor runs on this thread too, so the plugin cannot go away
+    // between this check and the end of the coroutine.
+    if (alive.expired()) {
+        if (socket) socket.Close();
+        co_return;
+    }
 
-        // Get RFCOMM service
-        auto service = GetRfcommService(device);
-        if (service == nullptr) {
-            OutputDebugStringA("ConnectToDevice: No RFCOMM service found\n");
-            return false;
+    pending_connects_.erase(address);
+    ConnectStop stop;
+    {
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        stop = pending->stop;
+    }
+    // Stopped after the socket connected: it is not wanted any more.
+    if (socket && stop == ConnectStop::kCancelled) {
+        socket.Close();
+        socket = nullptr;
+    }
+    if (!socket) {
+        OutputDebugStringA("HandleMethodCall: Connection failed\n");
+        if (stop == ConnectStop::kCancelled) {
+            result->Error("connectCancelled", "The connect was cancelled");
+        } else if (stop == ConnectStop::kTimedOut) {
+            result->Error("connectTimeout",
+                          "The device did not connect in time");
+        } else {
+            result->Error("couldNotConnect", "Failed to connect to device");
         }
+        co_return;
+    }
+
+    auto connection = std::make_shared<Connection>();
+    connection->outgoing->SetCoalescing(ParseWriteCoalescing(args));
+    connection->outgoing->SetRateLimit(ParseWriteRateLimit(args));
+    connection->id = connections_.NewId();
+    connection->address = address;
+    connection->socket = socket;
+    connections_.Insert(connection->id, connection);
+    connection_ids_[address] = connection->id;
+    OutputDebugStringA("ConnectToDevice: Connection stored successfully\n");
+
+    OutputDebugStringA(
+        "HandleMethodCall: Connection successful, notifying state "
+        "change\n");
+    flutter::EncodableValue arguments(args);
+    NotifyConnectionStateChange(&arguments, true);
+
+    // Don't auto-start data listening here - let Flutter app call
+    // listen when ready
+    OutputDebugStringA(
+        "Connection established, waiting for data channel listen "
+        "request\n");
+    result->Success(flutter::EncodableValue(connection->id));
+}
 
-        // Create socket and connect
-        auto socket = winrt::Windows::Networking::Sockets::StreamSocket();
+winrt::Windows::Networking::Sockets::StreamSocket
+BluetoothClassicMultiplatformPlugin::OpenSocket(
+    const flutter::EncodableMap& args, const std::string& address,
+    PendingConnect& pending) {
+    try {
+        std::string clean_address = address;
+        clean_address.erase(
+            std::remove(clean_address.begin(), clean_address.end(), ':'),
+            clean_address.end());
+        uint64_t bt_address = std::stoull(clean_address, nullptr, 16);
+        auto uuid_it = args.find(flutter::EncodableValue("uuid"));
+        const auto* uuid = uuid_it != args.end()
+                               ? std::get_if<std::string>(&uuid_it->second)
+                               : nullptr;
+        const std::string service_uuid = uuid ? *uuid : kSerialPortServiceUuid;
+
+        auto make_socket = [&args]() {
+            winrt::Windows::Networking::Sockets::StreamSocket socket;
+            // StreamSocketControl only exposes the send side; the receive
+            // buffer is not configurable through WinRT.
+            int64_t send_buffer_size = 0;
+            if (GetIntArgument(args, "socketSendBufferSize",
+                               &send_buffer_size) &&
+                send_buffer_size > 0 && send_buffer_size <= UINT32_MAX) {
+                socket.Control().OutboundBufferSizeInBytes(
+                    static_cast<uint32_t>(send_buffer_size));
+            }
+            return socket;
+        };
+
+        // "<host name> <service name>" that connected last time; reusing
+        // them skips looking up the device and its services. They are
+        // forgotten once they fail.
+        winrt::Windows::Networking::Sockets::StreamSocket socket{nullptr};
+        std::string cached;
+        if (channel_cache_->Lookup(bt_address, service_uuid, &cached)) {
+            size_t split = cached.find(' ');
+            try {
+                if (split != std::string::npos) {
+                    auto candidate = make_socket();
+                    AwaitConnectStep(
+                        pending,
+                        candidate.ConnectAsync(
+                            winrt::Windows::Networking::HostName(
+                                winrt::to_hstring(cached.substr(0, split))),
+                            winrt::to_hstring(cached.substr(split + 1))));
+                    socket = candidate;
+                    OutputDebugStringA(
+                        "ConnectToDevice: Connected to cached service\n");
+                }
+            } catch (const winrt::hresult_error&) {
+                OutputDebugStringA("ConnectToDevice: Cached service failed\n");
+            }
+            if (!socket) {
+                std::unique_lock<std::mutex> lock(pending.mutex);
+                // Cut short, the attempt says nothing about the service.
+                if (pending.stop != ConnectStop::kNone) return nullptr;
+                lock.unlock();
+                channel_cache_->Invalidate(bt_address, service_uuid);
+            }
+        }
 
-        // Connect to the service
-        socket
-            .ConnectAsync(service.ConnectionHostName(),
-                          service.ConnectionServiceName())
-            .get();
+        if (!socket) {
+            // Get Bluetooth device
+            auto device = GetBluetoothDevice(address, pending);
+            if (device == nullptr) {
+                OutputDebugStringA("ConnectToDevice: Device not found\n");
+                return nullptr;
+            }
 
-        // Store successful connection
-        connected_sockets_[*address_str] = socket;
-        OutputDebugStringA("ConnectToDevice: Connection stored successfully\n");
+            // Get RFCOMM service
+            auto service = GetRfcommService(device, pending);
+            if (service == nullptr) {
+                OutputDebugStringA(
+                    "ConnectToDevice: No RFCOMM service found\n");
+                return nullptr;
+            }
 
-        return true;
+            // Connect to the service
+            socket = make_socket();
+            AwaitConnectStep(
+                pending, socket.ConnectAsync(service.ConnectionHostName(),
+                                             service.ConnectionServiceName()));
+            channel_cache_->Store(
+                bt_address, service_uuid,
+                winrt::to_string(service.ConnectionHostName().RawName()) +
+                    " " + winrt::to_string(service.ConnectionServiceName()));
+        }
+        return socket;
     } catch (const winrt::hresult_error& ex) {
         std::string error_msg =
             "ConnectToDevice: WinRT error: " + winrt::to_string(ex.message()) +
             "\n";
         OutputDebugStringA(error_msg.c_str());
-        return false;
+        return nullptr;
     } catch (...) {
         OutputDebugStringA("ConnectToDevice: Unknown error occurred\n");
-        return false;
+        return nullptr;
+    }
+}
+
+// static
+void BluetoothClassicMultiplatformPlugin::StopConnect(PendingConnect& pending,
+                                                      ConnectStop stop) {
+    std::lock_guard<std::mutex> lock(pending.mutex);
+    if (pending.stop != ConnectStop::kNone) return;
+    pending.stop = stop;
+    if (!pending.operation) return;
+    try {
+        // Completes the awaited step with an error, which ends OpenSocket().
+        pending.operation.Cancel();
+    } catch (...) {
+        // Already completed
+    }
+}
+
+// static
+winrt::fire_and_forget BluetoothClassicMultiplatformPlugin::StopConnectAfter(
+    std::weak_ptr<PendingConnect> weak_pending,
+    winrt::Windows::Foundation::TimeSpan delay) {
+    co_await winrt::resume_after(delay);
+    if (auto pending = weak_pending.lock()) {
+        StopConnect(*pending, ConnectStop::kTimedOut);
     }
 }
 
+bool BluetoothClassicMultiplatformPlugin::CancelConnect(
+    const flutter::EncodableValue* arguments) {
+    const auto* args = std::get_if<flutter::EncodableMap>(arguments);
+    if (!args) return false;
+    auto address_it = args->find(flutter::EncodableValue("address"));
+    if (address_it == args->end()) return false;
+    const auto* address_str = std::get_if<std::string>(&address_it->second);
+    if (!address_str) return false;
+    auto it = pending_connects_.find(*address_str);
+    if (it == pending_connects_.end()) return false;
+    // connect() still completes, with "connectCancelled".
+    StopConnect(*it->second, ConnectStop::kCancelled);
+    return true;
+}
+
 bool BluetoothClassicMultiplatformPlugin::DisconnectDevice(
     const flutter::EncodableValue* arguments) {
     if (!arguments) {
         // Disconnect all devices
-        for (auto& pair : connected_sockets_) {
-            try {
-                pair.second.Close();
-            } catch (...) {
-                // Ignore errors during cleanup
-            }
+        for (const auto& connection : connections_.Snapshot()) {
+            RemoveConnection(connection->address);
         }
-        connected_sockets_.clear();
         return true;
     }
 
@@ -500,17 +837,7 @@ bool BluetoothClassicMultiplatformPlugin::DisconnectDevice(
     const auto* address_str = std::get_if<std::string>(&address_it->second);
     if (!address_str) return false;
 
-    auto sock_it = connected_sockets_.find(*address_str);
-    if (sock_it != connected_sockets_.end()) {
-        try {
-            sock_it->second.Close();
-        } catch (...) {
-            // Ignore errors during cleanup
-        }
-        connected_sockets_.erase(sock_it);
-        return true;
-    }
-
+    RemoveConnection(*address_str);
     return true;  // Return true even if not found (already disconnected)
 }
 
@@ -527,7 +854,7 @@ bool BluetoothClassicMultiplatformPlugin::IsDeviceConnected(
     const auto* address_str = std::get_if<std::string>(&address_it->second);
     if (!address_str) return false;
 
-    return connected_sockets_.find(*address_str) != connected_sockets_.end();
+    return FindConnection(*address_str) != nullptr;
 }
 
 void BluetoothClassicMultiplatformPlugin::NotifyConnectionStateChange(
@@ -544,157 +871,188 @@ void BluetoothClassicMultiplatformPlugin::StartDataListening(
         "StartDataListening called for: " + device_address + "\n";
     OutputDebugStringA(debug_msg.c_str());
 
+    auto connection = FindConnection(device_address);
+    if (!connection) {
+        OutputDebugStringA(
+            "Cannot start data listening - device not connected\n");
+        return;
+    }
+
     // Check if already listening for this device
-    if (listening_devices_.find(device_address) != listening_devices_.end()) {
+    if (connection->listening.exchange(true)) {
         OutputDebugStringA("Data listening already active for device\n");
         return;
     }
 
-    auto sock_it = connected_sockets_.find(device_address);
-    if (sock_it == connected_sockets_.end()) {
-        OutputDebugStringA(
-            "Cannot start data listening - device not connected\n");
-        return;
+    // Clear any existing data buffer for fresh start
+    {
+        std::lock_guard<std::mutex> lock(connection->data_mutex);
+        connection->received.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(loops_mutex_);
+        ++active_loops_;
     }
 
-    auto socket = sock_it->second;
+    ReceiveLoop(connection);
 
-    // Store device for data monitoring
-    listening_devices_.insert(device_address);
+    OutputDebugStringA("Data listening started for device\n");
+}
 
-    // Clear any existing data buffer for fresh start
-    {
-        std::lock_guard<std::mutex> lock(data_mutex_);
-        received_data_[device_address].clear();
+winrt::fire_and_forget BluetoothClassicMultiplatformPlugin::ReceiveLoop(
+    std::shared_ptr<Connection> connection) {
+    // Started on the platform thread, whose STA every co_await below would
+    // resume on; the destructor blocks that thread while it waits for the
+    // loop to end.
+    co_await winrt::resume_background();
+    // Taken by value: the frame outlives the caller's stack.
+    const std::string& device_address = connection->address;
+    std::string loop_debug_msg =
+        "ReceiveLoop: Started for device: " + device_address + "\n";
+    OutputDebugStringA(loop_debug_msg.c_str());
+
+    auto buffer = AcquireBuffer();
+    AdaptiveReadSize read_size;
+    try {
+        auto input_stream = connection->socket.InputStream();
+        while (connection->listening) {
+            uint32_t requested = static_cast<uint32_t>(read_size.current());
+            // Partial completes as soon as any bytes arrive; the caller's
+            // thread is released until then.
+            auto read = input_stream.ReadAsync(
+                buffer, requested,
+                winrt::Windows::Storage::Streams::InputStreamOptions::Partial);
+            {
+                std::lock_guard<std::mutex> lock(connection->read_mutex);
+                connection->pending_read = read;
+            }
+            // StopListening() may have missed the read just stored.
+            if (!connection->listening) read.Cancel();
+            auto result = co_await read;
+            uint32_t bytes_read = result.Length();
+            read_size.OnRead(requested, bytes_read);
+            if (bytes_read == 0) break;  // Closed by the remote device
+
+            // Store raw received data. The vector keeps its capacity across
+            // chunks, so steady state allocates nothing here.
+            const uint8_t* data = result.data();
+            {
+                std::lock_guard<std::mutex> lock(connection->data_mutex);
+                auto& received = connection->received;
+                received.insert(received.end(), data, data + bytes_read);
+            }
+        }
+    } catch (const winrt::hresult_error& ex) {
+        // Closing the socket cancels the pending read and lands here.
+        std::string error_msg = "ReceiveLoop: Read ended: " +
+                                winrt::to_string(ex.message()) + "\n";
+        OutputDebugStringA(error_msg.c_str());
     }
 
-    // Start background thread for data monitoring
-    std::thread data_thread([this, device_address, socket]() {
-        this->DataListeningThread(device_address, socket);
-    });
-    data_thread.detach();
+    ReleaseBuffer(std::move(buffer));
 
-    OutputDebugStringA("Data listening thread started for device\n");
+    OutputDebugStringA("ReceiveLoop: Ending for device\n");
+    {
+        std::lock_guard<std::mutex> lock(connection->read_mutex);
+        connection->pending_read = nullptr;
+    }
+    connection->listening = false;
+    std::lock_guard<std::mutex> lock(loops_mutex_);
+    --active_loops_;
+    loops_done_.notify_all();
 }
 
-void BluetoothClassicMultiplatformPlugin::DataListeningThread(
-    const std::string& device_address,
-    winrt::Windows::Networking::Sockets::StreamSocket socket) {
-    std::string thread_debug_msg =
-        "DataListeningThread: Started for device: " + device_address + "\n";
-    OutputDebugStringA(thread_debug_msg.c_str());
+std::shared_ptr<BluetoothClassicMultiplatformPlugin::Connection>
+BluetoothClassicMultiplatformPlugin::FindConnection(
+    const std::string& device_address) {
+    auto id_it = connection_ids_.find(device_address);
+    if (id_it == connection_ids_.end()) return nullptr;
+    return connections_.Find(id_it->second);
+}
 
+void BluetoothClassicMultiplatformPlugin::RemoveConnection(
+    const std::string& device_address) {
+    auto id_it = connection_ids_.find(device_address);
+    if (id_it == connection_ids_.end()) return;
+    auto connection = connections_.Remove(id_it->second);
+    connection_ids_.erase(id_it);
+    if (!connection) return;
+
+    StopListening(*connection);
+    // Fails the writes not yet handed to a store; a pending store fails
+    // once the close aborts it.
+    connection->outgoing->Close(
+        static_cast<int32_t>(HRESULT_FROM_WIN32(ERROR_OPERATION_ABORTED)));
     try {
-        auto input_stream = socket.InputStream();
-        auto reader =
-            winrt::Windows::Storage::Streams::DataReader(input_stream);
-
-        while (listening_devices_.find(device_address) !=
-                   listening_devices_.end() &&
-               connected_sockets_.find(device_address) !=
-                   connected_sockets_.end()) {
-            try {
-                // Load data from stream
-                auto load_task = reader.LoadAsync(1024);
-                load_task.get();  // Wait for completion
-
-                if (load_task.Status() ==
-                    winrt::Windows::Foundation::AsyncStatus::Completed) {
-                    uint32_t bytes_read = reader.UnconsumedBufferLength();
-
-                    if (bytes_read > 0) {
-                        // Read the data
-                        std::vector<uint8_t> buffer(bytes_read);
-                        reader.ReadBytes(buffer);
-
-                        // Store raw received data
-                        {
-                            std::lock_guard<std::mutex> lock(data_mutex_);
-                            received_data_[device_address].append(
-                                reinterpret_cast<const char*>(buffer.data()),
-                                bytes_read);
-                        }
+        connection->socket.Close();
+    } catch (...) {
+        // Ignore errors during cleanup
+    }
+}
 
-                        // Debug: Log received data
-                        std::string recv_debug_msg =
-                            "Received " + std::to_string(bytes_read) +
-                            " bytes from " + device_address + ": ";
-                        int max_chars = bytes_read < 50 ? bytes_read : 50;
-                        for (int j = 0; j < max_chars; j++) {
-                            if (buffer[j] >= 32 && buffer[j] <= 126) {
-                                recv_debug_msg += static_cast<char>(buffer[j]);
-                            } else {
-                                recv_debug_msg +=
-                                    "[" + std::to_string(buffer[j]) + "]";
-                            }
-                        }
-                        if (bytes_read > 50) recv_debug_msg += "...";
-                        recv_debug_msg += "\n";
-                        OutputDebugStringA(recv_debug_msg.c_str());
-                    }
-                } else {
-                    // No data available or connection closed
-                    break;
-                }
-            } catch (...) {
-                // Connection likely closed
-                break;
-            }
+void BluetoothClassicMultiplatformPlugin::StopListening(
+    Connection& connection) {
+    connection.listening = false;
+    std::lock_guard<std::mutex> lock(connection.read_mutex);
+    if (!connection.pending_read) return;
+    try {
+        // Completes the awaited read with an error, which ends the loop.
+        connection.pending_read.Cancel();
+    } catch (...) {
+        // Already completed
+    }
+}
 
-            // Use same delay as Android (10ms)
-            Sleep(10);
+winrt::Windows::Storage::Streams::IBuffer
+BluetoothClassicMultiplatformPlugin::AcquireBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(buffer_pool_mutex_);
+        if (!buffer_pool_.empty()) {
+            auto buffer = std::move(buffer_pool_.back());
+            buffer_pool_.pop_back();
+            return buffer;
         }
-    } catch (...) {
-        // Handle any exceptions
     }
+    return winrt::Windows::Storage::Streams::Buffer(
+        static_cast<uint32_t>(AdaptiveReadSize::kMaxSize));
+}
 
-    OutputDebugStringA("DataListeningThread: Ending for device\n");
-    listening_devices_.erase(device_address);
+void BluetoothClassicMultiplatformPlugin::ReleaseBuffer(
+    winrt::Windows::Storage::Streams::IBuffer buffer) {
+    std::lock_guard<std::mutex> lock(buffer_pool_mutex_);
+    if (buffer_pool_.size() < kMaxPooledBuffers) {
+        buffer_pool_.push_back(std::move(buffer));
+    }
 }
 
-std::string BluetoothClassicMultiplatformPlugin::ReadData(
+std::vector<uint8_t> BluetoothClassicMultiplatformPlugin::ReadData(
     const flutter::EncodableValue* arguments) {
-    if (!arguments) return "";
+    if (!arguments) return {};
 
     const auto* args = std::get_if<flutter::EncodableMap>(arguments);
-    if (!args) return "";
+    if (!args) return {};
 
     auto address_it = args->find(flutter::EncodableValue("address"));
-    if (address_it == args->end()) return "";
+    if (address_it == args->end()) return {};
 
     const auto* address_str = std::get_if<std::string>(&address_it->second);
-    if (!address_str) return "";
-
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    auto data_it = received_data_.find(*address_str);
-    if (data_it != received_data_.end()) {
-        std::string data = data_it->second;
-        if (!data.empty()) {
-            data_it->second.clear();  // Clear after reading
-
-            // Debug: Log what's being returned to Flutter
-            std::string read_debug_msg = "ReadData returning " +
-                                         std::to_string(data.length()) +
-                                         " bytes: ";
-            size_t max_chars = data.length() < 50 ? data.length() : 50;
-            for (size_t k = 0; k < max_chars; k++) {
-                if (data[k] >= 32 && data[k] <= 126) {
-                    read_debug_msg += data[k];
-                } else {
-                    read_debug_msg +=
-                        "[" + std::to_string((unsigned char)data[k]) + "]";
-                }
-            }
-            if (data.length() > 50) read_debug_msg += "...";
-            read_debug_msg += "\n";
-            OutputDebugStringA(read_debug_msg.c_str());
+    if (!address_str) return {};
 
-            // Return raw data exactly as received - no processing
-            return data;
-        }
+    // Allocated before taking the lock so the reader thread only ever waits
+    // for a pointer swap.
+    auto connection = FindConnection(*address_str);
+    if (!connection) return {};
+
+    std::vector<uint8_t> data;
+    data.reserve(kReceiveBufferReserve);
+    {
+        std::lock_guard<std::mutex> lock(connection->data_mutex);
+        if (connection->received.empty()) return {};
+        data.swap(connection->received);
     }
 
-    return "";
+    // Return raw data exactly as received - no processing
+    return data;
 }
 
 int BluetoothClassicMultiplatformPlugin::GetAvailableBytes(
@@ -710,10 +1068,10 @@ int BluetoothClassicMultiplatformPlugin::GetAvailableBytes(
     const auto* address_str = std::get_if<std::string>(&address_it->second);
     if (!address_str) return 0;
 
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    auto data_it = received_data_.find(*address_str);
-    if (data_it != received_data_.end()) {
-        int available = (int)data_it->second.length();
+    auto connection = FindConnection(*address_str);
+    if (connection) {
+        std::lock_guard<std::mutex> lock(connection->data_mutex);
+        int available = (int)connection->received.size();
         if (available > 0) {
             std::string debug_msg =
                 "GetAvailableBytes: " + std::to_string(available) +
@@ -739,70 +1097,296 @@ bool BluetoothClassicMultiplatformPlugin::FlushData(
     const auto* address_str = std::get_if<std::string>(&address_it->second);
     if (!address_str) return false;
 
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    received_data_[*address_str].clear();
+    auto connection = FindConnection(*address_str);
+    if (connection) {
+        std::lock_guard<std::mutex> lock(connection->data_mutex);
+        connection->received.clear();
+    }
     return true;
 }
 
-bool BluetoothClassicMultiplatformPlugin::WriteData(
-    const flutter::EncodableValue* arguments) {
-    if (!arguments) return false;
-
+void BluetoothClassicMultiplatformPlugin::WriteData(
+    const flutter::EncodableValue* arguments,
+    std::function<void(int error)> on_done) {
+    // Bad arguments and unknown connections read as false in Dart.
+    const int32_t invalid = static_cast<int32_t>(E_INVALIDARG);
     const auto* args = std::get_if<flutter::EncodableMap>(arguments);
-    if (!args) return false;
+    if (!args) return on_done(invalid);
 
     auto address_it = args->find(flutter::EncodableValue("address"));
     auto data_it = args->find(flutter::EncodableValue("data"));
 
-    if (address_it == args->end() || data_it == args->end()) return false;
+    if (address_it == args->end() || data_it == args->end()) {
+        return on_done(invalid);
+    }
 
     const auto* address_str = std::get_if<std::string>(&address_it->second);
-    if (!address_str) return false;
+    if (!address_str) return on_done(invalid);
+
+    auto connection = FindConnection(*address_str);
+    if (!connection) return on_done(invalid);
+
+    // A Uint8List arrives as bytes, a String as UTF-8. Sends complete
+    // after the call returns, so the queue takes one copy of either, into
+    // the storage of a write that already completed.
+    std::vector<uint8_t> data_buffer = connection->outgoing->TakeBuffer();
+    if (const auto* bytes =
+            std::get_if<std::vector<uint8_t>>(&data_it->second)) {
+        data_buffer.assign(bytes->begin(), bytes->end());
+    } else if (const auto* text = std::get_if<std::string>(&data_it->second)) {
+        data_buffer.assign(text->begin(), text->end());
+    }
+
+    if (data_buffer.empty()) return on_done(invalid);
+
+    WritePriority priority = WritePriority::kNormal;
+    std::chrono::microseconds timeout(0);
+    if (!ParseWriteOptions(*args, &priority, &timeout)) {
+        return on_done(invalid);
+    }
+
+    size_t size = data_buffer.size();
+    std::string address = *address_str;
+    QueueWrite(connection, std::move(data_buffer), priority, timeout,
+               [on_done, size, address](int error) {
+                   if (error == 0) {
+                       std::string debug_msg =
+                           "WriteData: Sent " + std::to_string(size) +
+                           " bytes to " + address + "\n";
+                       OutputDebugStringA(debug_msg.c_str());
+                   } else {
+                       OutputDebugStringA("WriteData: Error writing data\n");
+                   }
+                   on_done(error);
+               });
+}
+
+void BluetoothClassicMultiplatformPlugin::WriteBatch(
+    const flutter::EncodableValue* arguments,
+    std::function<void(int error)> on_done) {
+    const int32_t invalid = static_cast<int32_t>(E_INVALIDARG);
+    const auto* args = std::get_if<flutter::EncodableMap>(arguments);
+    if (!args) return on_done(invalid);
+    auto addresses_it = args->find(flutter::EncodableValue("addresses"));
+    auto data_it = args->find(flutter::EncodableValue("data"));
+    if (addresses_it == args->end() || data_it == args->end()) {
+        return on_done(invalid);
+    }
+    const auto* addresses =
+        std::get_if<flutter::EncodableList>(&addresses_it->second);
+    const auto* buffers = std::get_if<flutter::EncodableList>(&data_it->second);
+    // One address for all buffers, or one per buffer.
+    if (!addresses || !buffers || addresses->empty() ||
+        (addresses->size() != 1 && addresses->size() != buffers->size())) {
+        return on_done(invalid);
+    }
+    WritePriority priority = WritePriority::kNormal;
+    std::chrono::microseconds timeout(0);
+    if (!ParseWriteOptions(*args, &priority, &timeout)) {
+        return on_done(invalid);
+    }
+
+    // Everything is checked before the first buffer is queued, so a bad
+    // entry fails the batch without sending part of it.
+    std::vector<std::shared_ptr<Connection>> connections;
+    for (const auto& address : *addresses) {
+        const auto* address_str = std::get_if<std::string>(&address);
+        auto connection = address_str ? FindConnection(*address_str) : nullptr;
+        if (!connection) return on_done(invalid);
+        connections.push_back(std::move(connection));
+    }
+    for (const auto& buffer : *buffers) {
+        if (!std::get_if<std::vector<uint8_t>>(&buffer)) {
+            return on_done(invalid);
+        }
+    }
+    if (buffers->empty()) return on_done(0);
+
+    // Completions all run on the platform thread: the last one reports the
+    // first error any write had.
+    auto left = std::make_shared<size_t>(buffers->size());
+    auto first_error = std::make_shared<int>(0);
+    for (size_t i = 0; i < buffers->size(); ++i) {
+        const auto& connection = connections[connections.size() == 1 ? 0 : i];
+        const auto& bytes = std::get<std::vector<uint8_t>>((*buffers)[i]);
+        std::vector<uint8_t> data = connection->outgoing->TakeBuffer();
+        data.assign(bytes.begin(), bytes.end());
+        QueueWrite(connection, std::move(data), priority, timeout,
+                   [on_done, left, first_error](int error) {
+                       if (*first_error == 0) *first_error = error;
+                       if (--*left == 0) on_done(*first_error);
+                   });
+    }
+}
+
+void BluetoothClassicMultiplatformPlugin::QueueWrite(
+    const std::shared_ptr<Connection>& connection, std::vector<uint8_t> data,
+    WritePriority priority, std::chrono::microseconds timeout,
+    std::function<void(int error)> on_done) {
+    // Stores complete on pool threads; the method results behind |on_done|
+    // must only be completed on the platform thread, which is this one.
+    winrt::apartment_context platform_thread;
+    std::string address = connection->address;
+    auto on_sent = [this, platform_thread, on_done, address](int error) {
+        RunOn(platform_thread, [this, on_done, error, address]() {
+            on_done(error);
+            if (error != kWriteTimedOut) return;
+            // Dropped if it had not started; otherwise the stream broke off
+            // mid-write and the device stopped reading: closed like a lost
+            // link.
+            auto connection = FindConnection(address);
+            if (connection && connection->outgoing->GetStats().timed_out) {
+                RemoveConnection(address);
+                flutter::EncodableValue arguments(flutter::EncodableMap{
+                    {flutter::EncodableValue("address"),
+                     flutter::EncodableValue(address)}});
+                NotifyConnectionStateChange(&arguments, false);
+                CleanupDataChannels(&arguments);
+            }
+        });
+    };
+    WriteQueue::Clock::time_point deadline;
+    if (timeout.count() > 0) deadline = WriteQueue::Clock::now() + timeout;
+    if (connection->outgoing->Push(std::move(data), std::move(on_sent),
+                                   priority, deadline)) {
+        FlushWrites(connection);
+    }
+    if (timeout.count() > 0 && connection->outgoing->ArmExpiry(deadline)) {
+        ExpireWritesAt(connection, deadline);
+    }
+}
 
-    auto sock_it = connected_sockets_.find(*address_str);
-    if (sock_it == connected_sockets_.end()) return false;
+void BluetoothClassicMultiplatformPlugin::FlushWrites(
+    const std::shared_ptr<Connection>& connection) {
+    {
+        std::lock_guard<std::mutex> lock(connection->send_mutex);
+        if (connection->sending) {
+            connection->flush_requested = true;
+            return;
+        }
+        connection->sending = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(loops_mutex_);
+        ++active_loops_;
+    }
+    SendLoop(connection);
+}
 
+winrt::fire_and_forget BluetoothClassicMultiplatformPlugin::SendLoop(
+    std::shared_ptr<Connection> connection) {
+    // FlushWrites() may run on the platform thread, whose STA every
+    // co_await below would resume on; the destructor blocks that thread
+    // while it waits for the loop to end.
+    co_await winrt::resume_background();
+    WriteQueue& queue = *connection->outgoing;
+    // One buffer for the whole loop; WriteAsync() is done with it once it
+    // completes, so each round refills it in place.
+    auto buffer = AcquireBuffer();
+    int32_t error = 0;
     try {
-        // Handle both string and binary data
-        std::vector<uint8_t> data_buffer;
-
-        if (const auto* data_str = std::get_if<std::string>(&data_it->second)) {
-            data_buffer.assign(data_str->begin(), data_str->end());
-        } else if (const auto* data_list =
-                       std::get_if<flutter::EncodableList>(&data_it->second)) {
-            // Handle binary data as list of bytes
-            data_buffer.reserve(data_list->size());
-            for (const auto& byte_val : *data_list) {
-                if (const auto* byte_int = std::get_if<int>(&byte_val)) {
-                    data_buffer.push_back(static_cast<uint8_t>(*byte_int));
+        auto output_stream = connection->socket.OutputStream();
+        bool more = true;
+        while (more) {
+            WriteQueue::Span spans[kMaxSendSpans];
+            size_t count = 0;
+            auto hold = queue.HoldTime();
+            if (hold.count() > 0) {
+                // Coalescing: come back once the oldest write is due.
+                {
+                    std::lock_guard<std::mutex> lock(loops_mutex_);
+                    ++active_loops_;
+                }
+                FlushWritesAfter(connection, hold);
+            } else if ((count = queue.Peek(spans, kMaxSendSpans)) > 0) {
+                // Gathered into the buffer up to its capacity; a span cut
+                // short is picked up again by the next Peek().
+                uint8_t* out = buffer.data();
+                uint32_t capacity = buffer.Capacity();
+                uint32_t length = 0;
+                for (size_t i = 0; i < count && length < capacity; ++i) {
+                    uint32_t take = static_cast<uint32_t>(std::min<size_t>(
+                        spans[i].size, capacity - length));
+                    memcpy(out + length, spans[i].data, take);
+                    length += take;
                 }
+                buffer.Length(length);
+                auto write = output_stream.WriteAsync(buffer);
+                {
+                    std::lock_guard<std::mutex> lock(connection->send_mutex);
+                    // ExpireWritesAt() may have missed the write just made.
+                    if (connection->writes_timed_out) write.Cancel();
+                    connection->pending_write = write;
+                }
+                uint32_t written = co_await write;
+                {
+                    std::lock_guard<std::mutex> lock(connection->send_mutex);
+                    connection->pending_write = nullptr;
+                }
+                queue.Consume(written);
+                continue;
             }
+            // Done, unless a flush came in meanwhile.
+            std::lock_guard<std::mutex> lock(connection->send_mutex);
+            more = connection->flush_requested;
+            connection->flush_requested = false;
+            if (!more) connection->sending = false;
         }
+    } catch (const winrt::hresult_error& ex) {
+        // Closing the socket aborts a pending write and lands here.
+        error = ex.code();
+        std::string error_msg =
+            "SendLoop: Write failed: " + winrt::to_string(ex.message()) + "\n";
+        OutputDebugStringA(error_msg.c_str());
+    }
+    ReleaseBuffer(std::move(buffer));
 
-        if (!data_buffer.empty()) {
-            // Create data writer and write data
-            auto output_stream = sock_it->second.OutputStream();
-            auto writer =
-                winrt::Windows::Storage::Streams::DataWriter(output_stream);
-
-            writer.WriteBytes(data_buffer);
-            auto store_task = writer.StoreAsync();
-            store_task.get();  // Wait for completion
-
-            if (store_task.Status() ==
-                winrt::Windows::Foundation::AsyncStatus::Completed) {
-                std::string debug_msg = "WriteData: Sent " +
-                                        std::to_string(data_buffer.size()) +
-                                        " bytes to " + *address_str + "\n";
-                OutputDebugStringA(debug_msg.c_str());
-                return true;
+    if (error != 0) {
+        queue.Close(error);
+        std::lock_guard<std::mutex> lock(connection->send_mutex);
+        connection->sending = false;
+        connection->flush_requested = false;
+    }
+    std::lock_guard<std::mutex> lock(loops_mutex_);
+    --active_loops_;
+    loops_done_.notify_all();
+}
+
+winrt::fire_and_forget BluetoothClassicMultiplatformPlugin::FlushWritesAfter(
+    std::shared_ptr<Connection> connection, std::chrono::microseconds delay) {
+    co_await winrt::resume_after(delay);
+    FlushWrites(connection);
+    std::lock_guard<std::mutex> lock(loops_mutex_);
+    --active_loops_;
+    loops_done_.notify_all();
+}
+
+// static
+winrt::fire_and_forget BluetoothClassicMultiplatformPlugin::ExpireWritesAt(
+    std::weak_ptr<Connection> weak_connection,
+    WriteQueue::Clock::time_point deadline) {
+    co_await winrt::resume_after(
+        std::chrono::ceil<winrt::Windows::Foundation::TimeSpan>(
+            deadline - WriteQueue::Clock::now()));
+    auto connection = weak_connection.lock();
+    if (!connection) co_return;
+    WriteQueue::Clock::time_point rearm;
+    if (connection->outgoing->Expire(WriteQueue::Clock::now(), &rearm)) {
+        std::lock_guard<std::mutex> lock(connection->send_mutex);
+        connection->writes_timed_out = true;
+        if (connection->pending_write) {
+            try {
+                // Completes the awaited write with an error, which ends
+                // SendLoop().
+                connection->pending_write.Cancel();
+            } catch (...) {
+                // Already completed
             }
         }
-    } catch (...) {
-        OutputDebugStringA("WriteData: Error writing data\n");
     }
-
-    return false;
+    if (rearm != WriteQueue::Clock::time_point()) {
+        ExpireWritesAt(weak_connection, rearm);
+    }
 }
 
 void BluetoothClassicMultiplatformPlugin::CleanupDataChannels(
@@ -814,13 +1398,15 @@ void BluetoothClassicMultiplatformPlugin::CleanupDataChannels(
             if (address_it != args->end()) {
                 const auto* address_str =
                     std::get_if<std::string>(&address_it->second);
-                if (address_str) {
+                auto connection =
+                    address_str ? FindConnection(*address_str) : nullptr;
+                if (connection) {
                     // Stop data listening for this device
-                    listening_devices_.erase(*address_str);
+                    StopListening(*connection);
 
                     // Clear buffered data
-                    std::lock_guard<std::mutex> lock(data_mutex_);
-                    received_data_.erase(*address_str);
+                    std::lock_guard<std::mutex> lock(connection->data_mutex);
+                    connection->received.clear();
 
                     OutputDebugStringA(
                         "CleanupDataChannels: Cleaned up data channels\n");
@@ -829,9 +1415,11 @@ void BluetoothClassicMultiplatformPlugin::CleanupDataChannels(
         }
     } else {
         // Clean up all data channels if no specific device
-        listening_devices_.clear();
-        std::lock_guard<std::mutex> lock(data_mutex_);
-        received_data_.clear();
+        for (const auto& connection : connections_.Snapshot()) {
+            StopListening(*connection);
+            std::lock_guard<std::mutex> lock(connection->data_mutex);
+            connection->received.clear();
+        }
         OutputDebugStringA(
             "CleanupDataChannels: Cleaned up all data channels\n");
     }
@@ -846,9 +1434,11 @@ void BluetoothClassicMultiplatformPlugin::CancelDataChannel(
             if (address_it != args->end()) {
                 const auto* address_str =
                     std::get_if<std::string>(&address_it->second);
-                if (address_str) {
+                auto connection =
+                    address_str ? FindConnection(*address_str) : nullptr;
+                if (connection) {
                     // Stop listening for this device
-                    listening_devices_.erase(*address_str);
+                    StopListening(*connection);
                     OutputDebugStringA(
                         "CancelDataChannel: Cancelled data channel\n");
                 }
@@ -866,12 +1456,13 @@ void BluetoothClassicMultiplatformPlugin::CloseDataChannel(
             if (address_it != args->end()) {
                 const auto* address_str =
                     std::get_if<std::string>(&address_it->second);
-                if (address_str) {
+                auto connection =
+                    address_str ? FindConnection(*address_str) : nullptr;
+                if (connection) {
                     // Stop listening and clear data
-                    listening_devices_.erase(*address_str);
-
-                    std::lock_guard<std::mutex> lock(data_mutex_);
-                    received_data_.erase(*address_str);
+                    StopListening(*connection);
+                    std::lock_guard<std::mutex> lock(connection->data_mutex);
+                    connection->received.clear();
 
                     OutputDebugStringA(
                         "CloseDataChannel: Closed data channel\n");
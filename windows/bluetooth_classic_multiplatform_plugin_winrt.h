@@ -13,12 +13,18 @@
 #include <winrt/Windows.Networking.Sockets.h>
 #include <winrt/Windows.Storage.Streams.h>
 
-#include <map>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
-#include <set>
 #include <string>
-#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "channel_cache.h"
+#include "connection_table.h"
+#include "write_queue.h"
 
 namespace bluetooth_classic_multiplatform {
 
@@ -43,23 +49,140 @@ class BluetoothClassicMultiplatformPlugin : public flutter::Plugin {
         std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
    private:
+    // One open RFCOMM connection. The receive loop holds on to it, so the
+    // hot path never goes through the address.
+    struct Connection {
+        int id;
+        std::string address;
+        winrt::Windows::Networking::Sockets::StreamSocket socket{nullptr};
+        // A receive loop is running; cleared to make it stop.
+        std::atomic<bool> listening{false};
+        // Guards |pending_read|.
+        std::mutex read_mutex;
+        // The receive loop's outstanding ReadAsync, cancelled to stop the
+        // loop without waiting for the next byte from the device.
+        winrt::Windows::Foundation::IAsyncOperationWithProgress<
+            winrt::Windows::Storage::Streams::IBuffer, uint32_t>
+            pending_read{nullptr};
+        // Guards |received|.
+        std::mutex data_mutex;
+        // Filled by the receive loop; ReadData swaps a fresh buffer in.
+        std::vector<uint8_t> received;
+        // Outbound bytes, drained by SendLoop().
+        std::shared_ptr<WriteQueue> outgoing = std::make_shared<WriteQueue>();
+        // Guards |sending| and |flush_requested|, which keep one SendLoop()
+        // per connection, and the write state below.
+        std::mutex send_mutex;
+        bool sending = false;
+        bool flush_requested = false;
+        // SendLoop()'s outstanding WriteAsync, cancelled once a write it
+        // carries timed out: the device stopped reading, and the write
+        // would never complete otherwise.
+        winrt::Windows::Foundation::IAsyncOperationWithProgress<uint32_t,
+                                                                uint32_t>
+            pending_write{nullptr};
+        bool writes_timed_out = false;
+    };
+
+    // Why a connect() under way gave up early.
+    enum class ConnectStop { kNone, kCancelled, kTimedOut };
+
+    // A connect() under way. Stopping it cancels the WinRT operation it
+    // waits on, and every one it would start after.
+    struct PendingConnect {
+        std::mutex mutex;
+        ConnectStop stop = ConnectStop::kNone;
+        winrt::Windows::Foundation::IAsyncInfo operation{nullptr};
+    };
+
     // Bluetooth helper methods
     bool IsBluetoothAvailable();
     bool IsBluetoothEnabled();
     void OpenBluetoothSettings();
     flutter::EncodableList GetPairedDevices();
     flutter::EncodableList StartDiscovery();
-    bool ConnectToDevice(const flutter::EncodableValue* arguments);
+    // Starts ConnectInBackground() for "address" unless it is connected or
+    // being connected already; |result| gets the connection's id.
+    void ConnectToDevice(
+        const flutter::EncodableValue* arguments,
+        std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            result);
+    // Opens the socket on a pool thread, so no WinRT call blocks the
+    // platform thread, and registers it back there.
+    winrt::fire_and_forget ConnectInBackground(
+        flutter::EncodableMap args, std::string address,
+        std::shared_ptr<PendingConnect> pending,
+        std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+            result);
+    // Connects to the cached service of the device, else to the first one
+    // it offers. Blocks; null once that failed or |pending| was stopped.
+    winrt::Windows::Networking::Sockets::StreamSocket OpenSocket(
+        const flutter::EncodableMap& args, const std::string& address,
+        PendingConnect& pending);
+    // Waits for |operation| as the current step of |pending|, which
+    // cancels it when stopped; get() then throws.
+    template <typename Operation>
+    static auto AwaitConnectStep(PendingConnect& pending,
+                                 Operation operation);
+    // Stops |pending| unless it was stopped already.
+    static void StopConnect(PendingConnect& pending, ConnectStop stop);
+    // Stops the connect behind |weak_pending| with kTimedOut after |delay|.
+    static winrt::fire_and_forget StopConnectAfter(
+        std::weak_ptr<PendingConnect> weak_pending,
+        winrt::Windows::Foundation::TimeSpan delay);
+    // Cancels the connect under way to "address"; false if there is none.
+    bool CancelConnect(const flutter::EncodableValue* arguments);
     bool DisconnectDevice(const flutter::EncodableValue* arguments);
     bool IsDeviceConnected(const flutter::EncodableValue* arguments);
-    bool WriteData(const flutter::EncodableValue* arguments);
-    std::string ReadData(const flutter::EncodableValue* arguments);
+    // |on_done| gets 0 once the data was written, kWriteTimedOut if it was
+    // not within the optional "timeoutMicros", or another error.
+    void WriteData(const flutter::EncodableValue* arguments,
+                   std::function<void(int error)> on_done);
+    // Queues each buffer in "data" on the connection to "addresses": one
+    // address for all of them, or one per buffer. |on_done| runs once, after
+    // all of them completed, with the first error any of them had.
+    void WriteBatch(const flutter::EncodableValue* arguments,
+                    std::function<void(int error)> on_done);
+    std::vector<uint8_t> ReadData(const flutter::EncodableValue* arguments);
     flutter::EncodableList GetConnectedDevices();
 
     // Data streaming methods
     void StartDataListening(const std::string& device_address);
-    void DataListeningThread(const std::string& device_address, 
-                           winrt::Windows::Networking::Sockets::StreamSocket socket);
+    // Reads the socket with co_await until it closes or listening stops.
+    // Moves to the thread pool first and resumes there on completions; no
+    // thread waits on a connection.
+    winrt::fire_and_forget ReceiveLoop(std::shared_ptr<Connection> connection);
+    std::shared_ptr<Connection> FindConnection(
+        const std::string& device_address);
+    void RemoveConnection(const std::string& device_address);
+    // Queues |data| on |connection| without blocking, ahead of queued
+    // writes of a lower |priority|; |on_done| runs on the platform thread
+    // once it is written to the socket (error 0) or failed. With a nonzero
+    // |timeout| it fails with kWriteTimedOut once that passed, and the
+    // connection is closed if the write had started by then.
+    void QueueWrite(const std::shared_ptr<Connection>& connection,
+                    std::vector<uint8_t> data, WritePriority priority,
+                    std::chrono::microseconds timeout,
+                    std::function<void(int error)> on_done);
+    // Starts SendLoop() unless one runs; that one then goes round again.
+    void FlushWrites(const std::shared_ptr<Connection>& connection);
+    // Copies the queued writes into a pooled buffer and sends it with
+    // co_await WriteAsync() until the queue is empty or holds off to
+    // coalesce. Runs on the thread pool, like ReceiveLoop().
+    winrt::fire_and_forget SendLoop(std::shared_ptr<Connection> connection);
+    winrt::fire_and_forget FlushWritesAfter(
+        std::shared_ptr<Connection> connection,
+        std::chrono::microseconds delay);
+    // Runs WriteQueue::Expire() on |connection| at |deadline| and cancels
+    // the pending write if one that started timed out. Touches nothing of
+    // the plugin, so the destructor does not wait for it.
+    static winrt::fire_and_forget ExpireWritesAt(
+        std::weak_ptr<Connection> weak_connection,
+        WriteQueue::Clock::time_point deadline);
+    // Stops the receive loop of |connection|, if any, right away.
+    void StopListening(Connection& connection);
+    winrt::Windows::Storage::Streams::IBuffer AcquireBuffer();
+    void ReleaseBuffer(winrt::Windows::Storage::Streams::IBuffer buffer);
     int GetAvailableBytes(const flutter::EncodableValue* arguments);
     bool FlushData(const flutter::EncodableValue* arguments);
 
@@ -73,15 +196,37 @@ class BluetoothClassicMultiplatformPlugin : public flutter::Plugin {
     void CloseDataChannel(const flutter::EncodableValue* arguments);
 
     // WinRT helper methods
-    winrt::Windows::Devices::Bluetooth::BluetoothDevice GetBluetoothDevice(const std::string& address);
+    winrt::Windows::Devices::Bluetooth::BluetoothDevice GetBluetoothDevice(
+        const std::string& address, PendingConnect& pending);
     winrt::Windows::Devices::Bluetooth::Rfcomm::RfcommDeviceService GetRfcommService(
-        const winrt::Windows::Devices::Bluetooth::BluetoothDevice& device);
-
-    // Store connected sockets and data using WinRT types
-    std::map<std::string, winrt::Windows::Networking::Sockets::StreamSocket> connected_sockets_;
-    std::set<std::string> listening_devices_;
-    std::map<std::string, std::string> received_data_;
-    std::mutex data_mutex_;
+        const winrt::Windows::Devices::Bluetooth::BluetoothDevice& device,
+        PendingConnect& pending);
+
+    // Host and service names that last reached a service of a device.
+    std::unique_ptr<ChannelCache> channel_cache_;
+
+    // Open connections by id.
+    ConnectionTable<Connection> connections_;
+    // Ids of the open connections by device address, for the method calls
+    // that name a device. Platform thread only.
+    std::unordered_map<std::string, int> connection_ids_;
+    // Connects under way by device address. Platform thread only.
+    std::unordered_map<std::string, std::shared_ptr<PendingConnect>>
+        pending_connects_;
+
+    // Guards active_loops_, the running receive and send loops, which the
+    // destructor waits on.
+    std::mutex loops_mutex_;
+    int active_loops_ = 0;
+    std::condition_variable loops_done_;
+    // Expires with the plugin. ConnectInBackground() holds it weakly to
+    // tell, once back on the platform thread, whether there still is one.
+    std::shared_ptr<bool> alive_ = std::make_shared<bool>(true);
+
+    // Buffers handed back by finished receive and send loops, reused by
+    // new ones.
+    std::vector<winrt::Windows::Storage::Streams::IBuffer> buffer_pool_;
+    std::mutex buffer_pool_mutex_;
 };
 
 }  // namespace bluetooth_classic_multiplatform
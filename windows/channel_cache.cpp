@@ -0,0 +1,140 @@
+#include "channel_cache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+
+namespace {
+
+// First line of the file; a file without it is from another version and
+// ignored.
+constexpr char kHeader[] = "# bluetooth_classic_multiplatform channel cache 1";
+
+}  // namespace
+
+ChannelCache::ChannelCache(std::filesystem::path path)
+    : path_(std::move(path)) {}
+
+ChannelCache::Key ChannelCache::MakeKey(uint64_t address,
+                                        const std::string& service) {
+    std::string upper = service;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](char c) {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    });
+    return Key(address, upper);
+}
+
+bool ChannelCache::Lookup(uint64_t address, const std::string& service,
+                          std::string* value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadLocked();
+    auto it = entries_.find(MakeKey(address, service));
+    if (it == entries_.end()) {
+        ++stats_.misses;
+        return false;
+    }
+    ++stats_.hits;
+    *value = it->second.value;
+    return true;
+}
+
+void ChannelCache::Store(uint64_t address, const std::string& service,
+                         const std::string& value) {
+    if (value.find_first_of("\r\n") != std::string::npos) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadLocked();
+    Entry& entry = entries_[MakeKey(address, service)];
+    bool changed = entry.value != value;
+    entry.value = value;
+    entry.stored = next_stored_++;
+    if (entries_.size() > kMaxEntries) {
+        auto oldest = std::min_element(
+            entries_.begin(), entries_.end(),
+            [](const auto& a, const auto& b) {
+                return a.second.stored < b.second.stored;
+            });
+        entries_.erase(oldest);
+        changed = true;
+    }
+    // Storing what is cached already, as every reconnect does, leaves the
+    // file alone.
+    if (changed) SaveLocked();
+}
+
+void ChannelCache::Invalidate(uint64_t address, const std::string& service) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadLocked();
+    if (entries_.erase(MakeKey(address, service)) == 0) return;
+    ++stats_.invalidations;
+    SaveLocked();
+}
+
+ChannelCacheStats ChannelCache::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ChannelCacheStats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+void ChannelCache::LoadLocked() {
+    if (loaded_) return;
+    loaded_ = true;
+    std::ifstream in(path_);
+    std::string line;
+    if (!std::getline(in, line) || line != kHeader) return;
+    // "<address> <service> <value>", the address in hex.
+    while (std::getline(in, line)) {
+        size_t first = line.find(' ');
+        size_t second =
+            first == std::string::npos ? first : line.find(' ', first + 1);
+        if (second == std::string::npos) continue;
+        char* end = nullptr;
+        uint64_t address = std::strtoull(line.c_str(), &end, 16);
+        if (end != line.c_str() + first) continue;
+        std::string service = line.substr(first + 1, second - first - 1);
+        Entry& entry = entries_[MakeKey(address, service)];
+        entry.value = line.substr(second + 1);
+        entry.stored = next_stored_++;
+    }
+}
+
+void ChannelCache::SaveLocked() {
+    std::error_code error;
+    if (path_.has_parent_path()) {
+        std::filesystem::create_directories(path_.parent_path(), error);
+    }
+    // Written aside and moved over the old file, so a crash midway leaves
+    // the old entries intact.
+    std::filesystem::path temp = path_;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        if (!out) return;
+        out << kHeader << '\n';
+        // Oldest first, so loading restores the eviction order.
+        std::vector<const std::pair<const Key, Entry>*> ordered;
+        for (const auto& entry : entries_) ordered.push_back(&entry);
+        std::sort(ordered.begin(), ordered.end(),
+                  [](const auto* a, const auto* b) {
+                      return a->second.stored < b->second.stored;
+                  });
+        char address[17];
+        for (const auto* entry : ordered) {
+            snprintf(address, sizeof(address), "%012" PRIx64,
+                     entry->first.first);
+            out << address << ' ' << entry->first.second << ' '
+                << entry->second.value << '\n';
+        }
+        if (!out.flush()) return;
+    }
+    std::filesystem::rename(temp, path_, error);
+}
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace bluetooth_classic_multiplatform {
+
+struct ChannelCacheStats {
+    // Lookups that found an entry, and those that did not.
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Entries dropped because connecting with them failed.
+    uint64_t invalidations = 0;
+    size_t entries = 0;
+};
+
+// Remembers where a service of a device was last reached, keyed by its
+// Bluetooth address and service UUID: the RFCOMM channel for the Winsock
+// plugin, the names WinRT connects to for the other. Reconnects try that
+// first instead of finding the service anew.
+//
+// Kept in a small text file, one entry per line, read on the first lookup
+// and rewritten whenever an entry changes. A file that cannot be read is
+// treated as empty, and one that cannot be written only costs the next
+// start its entries. Thread-safe.
+class ChannelCache {
+   public:
+    // Entries kept; the one stored longest ago goes first beyond that.
+    static constexpr size_t kMaxEntries = 256;
+
+    explicit ChannelCache(std::filesystem::path path);
+
+    // Disallow copy and assign.
+    ChannelCache(const ChannelCache&) = delete;
+    ChannelCache& operator=(const ChannelCache&) = delete;
+
+    // Returns false on a miss. |service| is compared case-insensitively.
+    bool Lookup(uint64_t address, const std::string& service,
+                std::string* value);
+    // |value| must not contain a line break.
+    void Store(uint64_t address, const std::string& service,
+               const std::string& value);
+    // Drops the entry after connecting with it failed.
+    void Invalidate(uint64_t address, const std::string& service);
+
+    ChannelCacheStats GetStats();
+
+   private:
+    using Key = std::pair<uint64_t, std::string>;
+    struct Entry {
+        std::string value;
+        // Order of the Store() calls, for eviction.
+        uint64_t stored = 0;
+    };
+
+    static Key MakeKey(uint64_t address, const std::string& service);
+    void LoadLocked();
+    void SaveLocked();
+
+    const std::filesystem::path path_;
+    std::mutex mutex_;
+    bool loaded_ = false;
+    std::map<Key, Entry> entries_;
+    uint64_t next_stored_ = 0;
+    ChannelCacheStats stats_;
+};
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,252 @@
+#include "channel_prober.h"
+
+#ifdef _WIN32
+// This must be included before windows.h.
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace bluetooth_classic_multiplatform {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+#ifdef _WIN32
+int LastSocketError() { return WSAGetLastError(); }
+#else
+int LastSocketError() { return errno; }
+#endif
+
+// The outcome of a connect the socket reported as finished.
+int GetConnectError(NativeSocket socket) {
+    int error = 0;
+#ifdef _WIN32
+    int size = sizeof(error);
+#else
+    socklen_t size = sizeof(error);
+#endif
+    if (getsockopt(socket, SOL_SOCKET, SO_ERROR,
+                   reinterpret_cast<char*>(&error), &size) != 0) {
+        return LastSocketError();
+    }
+    return error;
+}
+
+enum class AttemptState { kUnstarted, kPending, kConnected, kFailed };
+
+struct Attempt {
+    AttemptState state = AttemptState::kUnstarted;
+    NativeSocket socket = kInvalidNativeSocket;
+    Clock::time_point deadline;
+};
+
+}  // namespace
+
+ProbeResult ProbeChannels(const std::vector<int>& channels,
+                          size_t parallelism,
+                          std::chrono::milliseconds attempt_timeout,
+                          const StartConnect& start_connect,
+                          const ConnectCancellation* cancellation) {
+    ProbeResult result;
+    parallelism = std::max<size_t>(parallelism, 1);
+    const size_t count = channels.size();
+    std::vector<Attempt> attempts(count);
+    // Attempts before |first| failed; none from |limit| on is started,
+    // since the one at |limit| connected.
+    size_t first = 0;
+    size_t next = 0;
+    size_t limit = count;
+    size_t pending = 0;
+    size_t winner = count;
+
+    auto fail = [&](Attempt& attempt, int error) {
+        if (attempt.state == AttemptState::kPending) --pending;
+        if (attempt.socket != kInvalidNativeSocket) {
+            CloseNativeSocket(attempt.socket);
+            attempt.socket = kInvalidNativeSocket;
+        }
+        attempt.state = AttemptState::kFailed;
+        result.error = error;
+    };
+
+    for (;;) {
+        while (first < count &&
+               attempts[first].state == AttemptState::kFailed) {
+            ++first;
+        }
+        if (first == count) break;
+        if (attempts[first].state == AttemptState::kConnected) {
+            winner = first;
+            break;
+        }
+        // Open attempts are closed below.
+        if (int error = cancellation ? cancellation->Check() : 0) {
+            result.error = error;
+            break;
+        }
+
+        while (pending < parallelism && next < limit) {
+            Attempt& attempt = attempts[next];
+            int error = 0;
+            attempt.socket = start_connect(channels[next], &error);
+            ++result.attempts;
+            ++next;
+            if (attempt.socket == kInvalidNativeSocket) {
+                fail(attempt, error);
+                continue;
+            }
+            attempt.state = AttemptState::kPending;
+            attempt.deadline = Clock::now() + attempt_timeout;
+            ++pending;
+        }
+        // Some failed at once; see whether that settled it.
+        if (pending == 0) continue;
+
+        // Windows reports a failed connect as an exception, POSIX as
+        // writable; SO_ERROR tells them apart from a success.
+        fd_set writable;
+        fd_set failed;
+        FD_ZERO(&writable);
+        FD_ZERO(&failed);
+        NativeSocket max_socket = 0;
+        Clock::time_point wake = Clock::time_point::max();
+        for (size_t i = first; i < next; ++i) {
+            if (attempts[i].state != AttemptState::kPending) continue;
+            FD_SET(attempts[i].socket, &writable);
+            FD_SET(attempts[i].socket, &failed);
+            max_socket = std::max(max_socket, attempts[i].socket);
+            wake = std::min(wake, attempts[i].deadline);
+        }
+        if (cancellation) {
+            wake = std::min({wake, cancellation->deadline(),
+                             Clock::now() + kCancellationPollInterval});
+        }
+        auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::max(wake - Clock::now(), Clock::duration::zero()));
+        timeval timeout;
+        timeout.tv_sec = static_cast<long>(wait.count() / 1000000);
+        timeout.tv_usec = static_cast<long>(wait.count() % 1000000);
+        // The first argument is ignored by Winsock.
+        if (select(static_cast<int>(max_socket + 1), nullptr, &writable,
+                   &failed, &timeout) < 0) {
+            int error = LastSocketError();
+            for (size_t i = first; i < next; ++i) {
+                if (attempts[i].state == AttemptState::kPending) {
+                    fail(attempts[i], error);
+                }
+            }
+            continue;
+        }
+
+        Clock::time_point now = Clock::now();
+        for (size_t i = first; i < next; ++i) {
+            Attempt& attempt = attempts[i];
+            if (attempt.state != AttemptState::kPending) continue;
+            if (FD_ISSET(attempt.socket, &writable) ||
+                FD_ISSET(attempt.socket, &failed)) {
+                int error = GetConnectError(attempt.socket);
+                if (error != 0) {
+                    fail(attempt, error);
+                    continue;
+                }
+                attempt.state = AttemptState::kConnected;
+                --pending;
+                limit = std::min(limit, i);
+            } else if (now >= attempt.deadline) {
+                fail(attempt, kConnectTimedOut);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < next; ++i) {
+        if (i != winner && attempts[i].socket != kInvalidNativeSocket) {
+            CloseNativeSocket(attempts[i].socket);
+        }
+    }
+    if (winner < count) {
+        result.socket = attempts[winner].socket;
+        result.channel = channels[winner];
+        result.error = 0;
+    }
+    return result;
+}
+
+bool RunCancellable(std::function<void()> call,
+                    const ConnectCancellation& cancellation) {
+    // Shared with the thread, which may outlive the wait.
+    struct State {
+        std::mutex mutex;
+        std::condition_variable returned_changed;
+        bool returned = false;
+    };
+    auto state = std::make_shared<State>();
+    std::thread([state, call = std::move(call)]() {
+        call();
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->returned = true;
+        state->returned_changed.notify_all();
+    }).detach();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (!state->returned) {
+        if (cancellation.Check() != 0) return false;
+        state->returned_changed.wait_for(lock, kCancellationPollInterval);
+    }
+    return true;
+}
+
+bool StartNonBlockingConnect(NativeSocket socket, const void* address,
+                             int address_size, int* error) {
+#ifdef _WIN32
+    u_long non_blocking = 1;
+    if (ioctlsocket(socket, FIONBIO, &non_blocking) != 0) {
+        *error = WSAGetLastError();
+        return false;
+    }
+    if (connect(socket, static_cast<const sockaddr*>(address),
+                address_size) == 0) {
+        return true;
+    }
+    int result = WSAGetLastError();
+    if (result == WSAEWOULDBLOCK) return true;
+    *error = result;
+    return false;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0 || fcntl(socket, F_SETFL, flags | O_NONBLOCK) != 0) {
+        *error = errno;
+        return false;
+    }
+    if (connect(socket, static_cast<const sockaddr*>(address),
+                static_cast<socklen_t>(address_size)) == 0) {
+        return true;
+    }
+    int result = errno;
+    if (result == EINPROGRESS) return true;
+    *error = result;
+    return false;
+#endif
+}
+
+void CloseNativeSocket(NativeSocket socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+}  // namespace bluetooth_classic_multiplatform
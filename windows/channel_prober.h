@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "io_reactor.h"
+
+namespace bluetooth_classic_multiplatform {
+
+// Starts a connect to |channel| on a fresh non-blocking socket (see
+// StartNonBlockingConnect()). Returns the socket with the connect under
+// way or already done, or kInvalidNativeSocket with |error| set.
+using StartConnect = std::function<NativeSocket(int channel, int* error)>;
+
+#ifdef _WIN32
+constexpr NativeSocket kInvalidNativeSocket = ~NativeSocket(0);
+#else
+constexpr NativeSocket kInvalidNativeSocket = -1;
+#endif
+
+// Errors a connect fails with once it was cancelled, or once the deadline
+// of the whole connect passed.
+#ifdef _WIN32
+constexpr int kConnectCancelled = 10103;  // WSAECANCELLED
+constexpr int kConnectTimedOut = 10060;   // WSAETIMEDOUT
+#else
+constexpr int kConnectCancelled = ECANCELED;
+constexpr int kConnectTimedOut = ETIMEDOUT;
+#endif
+
+// Bounds a connect that runs off the calling thread: by a deadline, and by
+// Cancel(), which any thread may call.
+class ConnectCancellation {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ConnectCancellation(
+        Clock::time_point deadline = Clock::time_point::max())
+        : deadline_(deadline.time_since_epoch().count()) {}
+
+    // Disallow copy and assign.
+    ConnectCancellation(const ConnectCancellation&) = delete;
+    ConnectCancellation& operator=(const ConnectCancellation&) = delete;
+
+    void Cancel() { cancelled_ = true; }
+    bool cancelled() const { return cancelled_; }
+    Clock::time_point deadline() const {
+        return Clock::time_point(Clock::duration(deadline_.load()));
+    }
+    // Moves the deadline, e.g. once a connect that was queued starts.
+    void set_deadline(Clock::time_point deadline) {
+        deadline_ = deadline.time_since_epoch().count();
+    }
+
+    // kConnectCancelled or kConnectTimedOut once the connect should give
+    // up; 0 while it may go on.
+    int Check() const {
+        if (cancelled_) return kConnectCancelled;
+        if (Clock::now() >= deadline()) return kConnectTimedOut;
+        return 0;
+    }
+
+   private:
+    std::atomic<Clock::rep> deadline_;
+    std::atomic<bool> cancelled_{false};
+};
+
+struct ProbeResult {
+    // Connected and left non-blocking; kInvalidNativeSocket if no channel
+    // accepted.
+    NativeSocket socket = kInvalidNativeSocket;
+    int channel = 0;
+    // Error of the last channel that failed, or of |cancellation|; 0 on
+    // success.
+    int error = 0;
+    // Connects started, including those given up once another won.
+    size_t attempts = 0;
+};
+
+// Connects to the first of |channels| that accepts, trying up to
+// |parallelism| of them at once. The result is the one a sequential scan in
+// list order would find: a channel that answers early is only taken once
+// every channel before it failed, and no channel after it is started. An
+// attempt that has not finished after |attempt_timeout| counts as failed.
+// The losing sockets are closed.
+//
+// With |cancellation|, probing stops within kCancellationPollInterval of
+// Cancel() or of its deadline, and every attempt still open is closed.
+ProbeResult ProbeChannels(const std::vector<int>& channels,
+                          size_t parallelism,
+                          std::chrono::milliseconds attempt_timeout,
+                          const StartConnect& start_connect,
+                          const ConnectCancellation* cancellation = nullptr);
+
+// How often ProbeChannels() looks for a Cancel() while it waits.
+constexpr std::chrono::milliseconds kCancellationPollInterval(50);
+
+// Runs |call| on a thread of its own and waits for it to return, for a
+// blocking call that Cancel() cannot interrupt. Returns false, without
+// waiting further, within kCancellationPollInterval of Cancel() or of the
+// deadline; |call| then finishes on its own, so it must own what it uses.
+bool RunCancellable(std::function<void()> call,
+                    const ConnectCancellation& cancellation);
+
+// Switches |socket| to non-blocking mode and starts connecting it to
+// |address|. Returns false with |error| set if the connect failed at once;
+// an error it would only report later is not one.
+bool StartNonBlockingConnect(NativeSocket socket, const void* address,
+                             int address_size, int* error);
+
+void CloseNativeSocket(NativeSocket socket);
+
+}  // namespace bluetooth_classic_multiplatform
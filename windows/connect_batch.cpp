@@ -0,0 +1,61 @@
+#include "connect_batch.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+
+namespace bluetooth_classic_multiplatform {
+
+size_t ClampConnectParallelism(int64_t requested) {
+    return static_cast<size_t>(
+        std::clamp<int64_t>(requested, 1, kMaxConnectParallelism));
+}
+
+std::vector<std::string> PlanConnectBatch(
+    const std::vector<std::string>& addresses,
+    const std::function<int(const std::string& address)>& connection_id,
+    const std::function<bool(const std::string& address)>& connecting,
+    const ConnectReport& report) {
+    std::vector<std::string> queued;
+    std::unordered_set<std::string> named;
+    for (const auto& address : addresses) {
+        bool first = named.insert(address).second;
+        if (int id = connection_id(address)) {
+            report(address, id, 0);
+        } else if (!first || connecting(address)) {
+            report(address, 0, kConnectInProgress);
+        } else {
+            queued.push_back(address);
+        }
+    }
+    return queued;
+}
+
+ConnectBatch::ConnectBatch(std::vector<std::string> addresses,
+                           std::chrono::microseconds timeout)
+    : addresses_(std::move(addresses)),
+      timeout_(timeout),
+      left_(addresses_.size()) {
+    for (size_t i = 0; i < addresses_.size(); ++i) {
+        cancellations_.push_back(std::make_shared<ConnectCancellation>());
+    }
+}
+
+bool ConnectBatch::Take(size_t* index) {
+    size_t next = next_++;
+    if (next >= addresses_.size()) return false;
+    if (timeout_.count() > 0) {
+        cancellations_[next]->set_deadline(
+            ConnectCancellation::Clock::now() + timeout_);
+    }
+    *index = next;
+    return true;
+}
+
+bool ConnectBatch::Finish() { return --left_ == 0; }
+
+void ConnectBatch::Cancel() {
+    for (auto& cancellation : cancellations_) cancellation->Cancel();
+}
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "channel_prober.h"
+
+namespace bluetooth_classic_multiplatform {
+
+// Devices connectMany() pages at once unless it names a number, and the
+// most it may; the radio shares its time between the pages under way.
+constexpr int64_t kDefaultConnectParallelism = 4;
+constexpr int64_t kMaxConnectParallelism = 16;
+
+// Stands in for the error of a connect not started because another to the
+// same device is under way, or named it before in the same call.
+constexpr int kConnectInProgress = -2;
+
+// The "maxParallel" of connectMany(), clamped to 1..kMaxConnectParallelism.
+size_t ClampConnectParallelism(int64_t requested);
+
+// What became of one device of a connect() or connectMany() call: the id of
+// its connection, or the error there is none for.
+using ConnectReport =
+    std::function<void(const std::string& address, int id, int error)>;
+
+// Sorts the "addresses" of a connectMany() call. A device |connection_id|
+// gives an id for (0 if it has no connection) is reported with it right
+// away; one |connecting| names, or one named before in |addresses|, with
+// kConnectInProgress. The rest are returned in order, to be connected.
+std::vector<std::string> PlanConnectBatch(
+    const std::vector<std::string>& addresses,
+    const std::function<int(const std::string& address)>& connection_id,
+    const std::function<bool(const std::string& address)>& connecting,
+    const ConnectReport& report);
+
+// The devices of one connect() or connectMany() call, taken on by workers
+// one after the other. Each has a cancellation of its own, whose timeout
+// counts from when a worker takes the device rather than from when the
+// call queued it.
+class ConnectBatch {
+   public:
+    // No timeout if |timeout| is zero.
+    ConnectBatch(std::vector<std::string> addresses,
+                 std::chrono::microseconds timeout);
+
+    // Disallow copy and assign.
+    ConnectBatch(const ConnectBatch&) = delete;
+    ConnectBatch& operator=(const ConnectBatch&) = delete;
+
+    size_t size() const { return addresses_.size(); }
+    const std::string& address(size_t index) const {
+        return addresses_[index];
+    }
+    const std::shared_ptr<ConnectCancellation>& cancellation(
+        size_t index) const {
+        return cancellations_[index];
+    }
+
+    // Hands a worker the next device in |index| and starts its timeout;
+    // false once none is left. Any thread.
+    bool Take(size_t* index);
+
+    // Counts a device as finished; true for the last. Any thread.
+    bool Finish();
+
+    // Cancels every device: those under way give up, and those not taken
+    // yet are cancelled before they start.
+    void Cancel();
+
+   private:
+    const std::vector<std::string> addresses_;
+    std::vector<std::shared_ptr<ConnectCancellation>> cancellations_;
+    const std::chrono::microseconds timeout_;
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> left_;
+};
+
+}  // namespace bluetooth_classic_multiplatform
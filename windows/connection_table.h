@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+
+// Live connections keyed by the integer id handed to Dart. Entries are
+// spread over kShardCount shards by id, each behind its own mutex, so a
+// lookup is one integer hash plus one briefly held lock that lookups of
+// other connections rarely share. Entries are held by shared_ptr: a caller
+// that found one keeps it valid after it has been removed, and compares
+// against Find() to tell whether it is still the current one.
+//
+// Ids are never reused, so a stale id cannot reach a newer connection.
+template <typename Entry>
+class ConnectionTable {
+   public:
+    static constexpr size_t kShardCount = 16;
+
+    ConnectionTable() = default;
+
+    // Disallow copy and assign.
+    ConnectionTable(const ConnectionTable&) = delete;
+    ConnectionTable& operator=(const ConnectionTable&) = delete;
+
+    // Hands out a fresh id, so the entry can carry it before Insert().
+    int NewId() { return next_id_.fetch_add(1); }
+
+    // Stores |entry| under |id|, which must come from NewId().
+    void Insert(int id, std::shared_ptr<Entry> entry) {
+        Shard& shard = ShardFor(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries[id] = std::move(entry);
+    }
+
+    // Returns null if |id| is unknown or already removed.
+    std::shared_ptr<Entry> Find(int id) const {
+        const Shard& shard = ShardFor(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(id);
+        if (it == shard.entries.end()) return nullptr;
+        return it->second;
+    }
+
+    // Removes and returns the entry, or null if there was none.
+    std::shared_ptr<Entry> Remove(int id) {
+        Shard& shard = ShardFor(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(id);
+        if (it == shard.entries.end()) return nullptr;
+        std::shared_ptr<Entry> entry = std::move(it->second);
+        shard.entries.erase(it);
+        return entry;
+    }
+
+    // Every entry present when its shard was visited; shards are locked one
+    // at a time, never together.
+    std::vector<std::shared_ptr<Entry>> Snapshot() const {
+        std::vector<std::shared_ptr<Entry>> entries;
+        for (const Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto& pair : shard.entries) {
+                entries.push_back(pair.second);
+            }
+        }
+        return entries;
+    }
+
+    size_t size() const {
+        size_t count = 0;
+        for (const Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            count += shard.entries.size();
+        }
+        return count;
+    }
+
+   private:
+    // Own cache line each, so locking one shard does not slow its
+    // neighbours down.
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<int, std::shared_ptr<Entry>> entries;
+    };
+
+    Shard& ShardFor(int id) {
+        return shards_[static_cast<size_t>(id) % kShardCount];
+    }
+    const Shard& ShardFor(int id) const {
+        return shards_[static_cast<size_t>(id) % kShardCount];
+    }
+
+    std::atomic<int> next_id_{1};
+    Shard shards_[kShardCount];
+};
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,100 @@
+#include "file_transfer.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+
+FileTransfer::FileTransfer(std::unique_ptr<MappedFile> file,
+                           size_t chunk_size,
+                           std::shared_ptr<WriteQueue> queue,
+                           Callbacks callbacks)
+    : file_(std::move(file)),
+      chunk_size_(std::max<size_t>(chunk_size, 1)),
+      queue_(std::move(queue)),
+      callbacks_(std::move(callbacks)) {}
+
+bool FileTransfer::Start() {
+    if (file_->size() == 0) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished_ = true;
+        }
+        if (callbacks_.on_done) callbacks_.on_done(0);
+        return false;
+    }
+    return Pump();
+}
+
+bool FileTransfer::Pump() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pumping_) {
+            pump_requested_ = true;
+            return false;
+        }
+        pumping_ = true;
+    }
+    bool flush = false;
+    for (;;) {
+        size_t offset = 0;
+        size_t size = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (finished_ || next_offset_ >= file_->size() ||
+                chunks_in_flight_ >= kChunksInFlight) {
+                if (!pump_requested_) {
+                    pumping_ = false;
+                    break;
+                }
+                pump_requested_ = false;
+                continue;
+            }
+            offset = next_offset_;
+            size = std::min(chunk_size_, file_->size() - offset);
+            next_offset_ += size;
+            ++chunks_in_flight_;
+        }
+        // Copied into storage the queue recycles; the mapping is only read
+        // once, front to back.
+        std::vector<uint8_t> chunk = queue_->TakeBuffer();
+        chunk.assign(file_->data() + offset, file_->data() + offset + size);
+        // On a closed queue the callback runs right here, and its Pump()
+        // call only asks this loop to go round again.
+        auto self = shared_from_this();
+        flush |= queue_->Push(std::move(chunk), [self, size](int error) {
+            self->OnChunkSent(size, error);
+        });
+    }
+    return flush;
+}
+
+void FileTransfer::OnChunkSent(size_t size, int error) {
+    uint64_t bytes_sent = 0;
+    bool done = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --chunks_in_flight_;
+        // Chunks queued behind a failed one fail too; reported once.
+        if (finished_) return;
+        if (error != 0) {
+            finished_ = true;
+            done = true;
+        } else {
+            bytes_sent_ += size;
+            bytes_sent = bytes_sent_;
+            done = finished_ = bytes_sent_ == file_->size();
+        }
+    }
+    if (error == 0 && callbacks_.on_progress) {
+        callbacks_.on_progress(bytes_sent, file_->size());
+    }
+    if (done) {
+        if (callbacks_.on_done) callbacks_.on_done(error);
+        return;
+    }
+    if (Pump() && callbacks_.flush) callbacks_.flush();
+}
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "mapped_file.h"
+#include "write_queue.h"
+
+namespace bluetooth_classic_multiplatform {
+
+// Streams a mapped file through a connection's WriteQueue in chunks. A few
+// chunks are kept queued at all times, so the link never waits for the
+// next one, and each one the transport takes makes room for another from
+// the completion itself: nothing has to come back to the caller per chunk.
+class FileTransfer : public std::enable_shared_from_this<FileTransfer> {
+   public:
+    // Chunks queued at once; bounds the file's share of the queue.
+    static constexpr size_t kChunksInFlight = 4;
+
+    // All of these may run on a reactor worker.
+    struct Callbacks {
+        // A chunk found the queue idle: start a drainer (IoReactor::Flush()).
+        // Not asked for by Start(), which returns it instead.
+        std::function<void()> flush;
+        // After every chunk the transport took.
+        std::function<void(uint64_t bytes_sent, uint64_t total)> on_progress;
+        // Once: 0 after the last chunk went out, otherwise the error of the
+        // first chunk that failed; the rest of the file is not sent then.
+        std::function<void(int error)> on_done;
+    };
+
+    FileTransfer(std::unique_ptr<MappedFile> file, size_t chunk_size,
+                 std::shared_ptr<WriteQueue> queue, Callbacks callbacks);
+
+    // Disallow copy and assign.
+    FileTransfer(const FileTransfer&) = delete;
+    FileTransfer& operator=(const FileTransfer&) = delete;
+
+    // Queues the first chunks. Returns true if the caller has to start a
+    // drainer, as after WriteQueue::Push(). The transfer keeps itself alive
+    // until on_done ran.
+    bool Start();
+
+    uint64_t size() const { return file_->size(); }
+
+   private:
+    // Queues chunks until kChunksInFlight are out or the file is. Only one
+    // thread pumps at a time, so chunks are queued in file order; a call
+    // meanwhile makes that one go round again.
+    bool Pump();
+    void OnChunkSent(size_t size, int error);
+
+    const std::unique_ptr<MappedFile> file_;
+    const size_t chunk_size_;
+    const std::shared_ptr<WriteQueue> queue_;
+    const Callbacks callbacks_;
+
+    std::mutex mutex_;
+    size_t next_offset_ = 0;
+    size_t chunks_in_flight_ = 0;
+    uint64_t bytes_sent_ = 0;
+    bool pumping_ = false;
+    bool pump_requested_ = false;
+    bool finished_ = false;
+};
+
+}  // namespace bluetooth_classic_multiplatform
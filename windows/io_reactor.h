@@ -0,0 +1,117 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "write_queue.h"
+
+namespace bluetooth_classic_multiplatform {
+
+#ifdef _WIN32
+// Same underlying type as the Winsock SOCKET typedef, so this header does not
+// have to drag winsock2.h into every translation unit.
+using NativeSocket = uintptr_t;
+#else
+using NativeSocket = int;
+#endif
+
+// Callbacks invoked on a reactor worker for a registered socket. Callbacks of
+// one socket never run concurrently; those of different sockets may, and so
+// may the completions of its writes.
+struct IoHandler {
+    // Optional. Asked before every read how many bytes the owner can take;
+    // the read is capped to that. Returning 0 pauses the socket, so unread
+    // data stays queued in the transport (and its flow control pushes back
+    // on the peer) until IoReactor::Resume() is called. A hangup is only
+    // reported once the data before it has been read.
+    std::function<size_t()> read_budget;
+
+    // Called with every chunk read from the socket as soon as it arrives.
+    std::function<void(const uint8_t* data, size_t size)> on_data;
+
+    // Called once when the peer closes the connection (error == 0) or the
+    // socket fails. The socket is already unregistered at that point.
+    std::function<void(int error)> on_closed;
+};
+
+// Read counters for one registered socket.
+struct IoStats {
+    // Size of the next read; adapts to throughput between 1 KiB and 64 KiB.
+    size_t read_size = 0;
+    uint64_t reads = 0;
+    uint64_t bytes_read = 0;
+};
+
+// Portable socket engine. Sockets added to the reactor are switched to
+// non-blocking mode and drained whenever the OS reports them readable, so
+// data is picked up the moment it arrives and an idle connection costs no
+// wakeups at all. Outbound data is queued per socket and sent from the
+// workers as the transport takes it, so no caller blocks on a slow link. A
+// small fixed pool of workers serves every socket, so the thread count does
+// not grow with the number of connections.
+//
+// The Windows backend waits on an I/O completion port, the Linux backend on
+// epoll; the latter exists so the engine can be tested against socketpairs.
+class IoReactor {
+   public:
+    // Creates the backend for the current platform and starts
+    // |worker_count| workers; 0 starts one per hardware thread.
+    static std::unique_ptr<IoReactor> Create(size_t worker_count = 0);
+
+    // Stops and joins the workers, waiting for callbacks in progress but
+    // starting no new ones. Queued writes fail; registered sockets are not
+    // closed.
+    virtual ~IoReactor() = default;
+
+    virtual size_t worker_count() const = 0;
+
+    // Starts watching |socket|. Returns false if it could not be registered.
+    virtual bool Add(NativeSocket socket, IoHandler handler) = 0;
+
+    // Stops reading |socket|; its writes carry on. Once this returns none
+    // of its IoHandler callbacks is running or will run again, so their
+    // captures may be destroyed; a callback of |socket| may stop it, but
+    // one of another socket must not (it could wait on its own worker).
+    virtual void StopReading(NativeSocket socket) = 0;
+
+    // Makes |queue| the outbound queue of |socket|, whether or not it is
+    // read, and switches the socket to non-blocking mode. Returns false if
+    // it could not be registered or has one already.
+    virtual bool AddWriter(NativeSocket socket,
+                           std::shared_ptr<WriteQueue> queue) = 0;
+
+    // Starts draining the queue of |socket| on the workers. Call it whenever
+    // WriteQueue::Push() asks for a drainer; it never blocks.
+    virtual void Flush(NativeSocket socket) = 0;
+
+    // Fails the writes of |socket| due by |deadline| once it passed, as
+    // WriteQueue::Expire() does. Call it after every Push() with a
+    // deadline; it costs nothing while an earlier expiry is pending. Should
+    // a write time out after it started, a send the transport still holds
+    // is cancelled and every later write fails too: the link stopped taking
+    // data, and the owner should close it.
+    virtual void WatchDeadline(NativeSocket socket,
+                               WriteQueue::Clock::time_point deadline) = 0;
+
+    // Stops reading and writing |socket|, with the guarantees of
+    // StopReading(); writes still queued fail. The socket itself is left
+    // open.
+    virtual void Remove(NativeSocket socket) = 0;
+
+    // Fills |stats| for |socket|. Returns false if it is not registered.
+    virtual bool GetStats(NativeSocket socket, IoStats* stats) = 0;
+
+    // Starts reading a socket paused by its read_budget again. Cheap and
+    // harmless if the socket is not paused; safe to call from any thread.
+    virtual void Resume(NativeSocket socket) = 0;
+
+    // Runs |task| on a reactor worker once |delay| has elapsed. Tasks still
+    // pending when the reactor is destroyed are dropped.
+    virtual void RunAfter(std::chrono::microseconds delay,
+                          std::function<void()> task) = 0;
+};
+
+}  // namespace bluetooth_classic_multiplatform
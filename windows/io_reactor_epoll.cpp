@@ -0,0 +1,550 @@
+// epoll backend of IoReactor. It is not part of the Windows plugin build; it
+// lets the receive engine be exercised on Linux against socketpairs.
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "adaptive_read_size.h"
+#include "io_reactor.h"
+#include "timer_queue.h"
+#include "write_queue.h"
+
+namespace bluetooth_classic_multiplatform {
+
+namespace {
+
+// Events taken per epoll_wait. Kept small so one worker does not sit on a
+// batch of ready sockets while the others are idle.
+constexpr int kMaxEvents = 16;
+
+// Upper bound on reads per readiness event so one busy socket cannot starve
+// the others. Sockets are re-armed afterwards and report leftovers again.
+constexpr int kMaxReadsPerWakeup = 16;
+
+// The same for sends.
+constexpr int kMaxSendsPerWakeup = 16;
+
+// Queued writes gathered into one sendmsg().
+constexpr size_t kMaxSendSpans = 16;
+
+struct Registration {
+    int fd = -1;
+    IoHandler handler;
+    // Guarded by the reactor's mutex_.
+    bool paused = false;
+    bool resume_requested = false;
+    // Set while a worker runs the handler; Remove() waits for it to clear.
+    bool in_service = false;
+    std::thread::id service_thread;
+    // Owned by whichever worker holds the socket's one-shot event.
+    AdaptiveReadSize read_size;
+    // Mirrors for GetStats().
+    std::atomic<size_t> current_read_size{AdaptiveReadSize::kMinSize};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> bytes_read{0};
+};
+
+// The send side of a socket. epoll keys its interest list by descriptor, so
+// writes watch a dup() of the socket; that gives them a one-shot event of
+// their own, independent of the reads.
+struct Writer {
+    int fd = -1;
+    int watch_fd = -1;
+    std::shared_ptr<WriteQueue> queue;
+    // Guarded by the reactor's mutex_.
+    bool watched = false;
+    // Flush() came in while a worker was still serving the writes.
+    bool flush_requested = false;
+    bool in_service = false;
+    std::thread::id service_thread;
+};
+
+// Tags write events in epoll_event::data next to the descriptor.
+constexpr uint64_t kWriteEvent = uint64_t{1} << 32;
+
+uint64_t EventKey(int fd) { return static_cast<uint32_t>(fd); }
+
+bool SetNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// All workers wait on one epoll instance. Sockets are armed EPOLLONESHOT, so
+// a readiness event goes to exactly one worker and the socket stays disabled
+// until that worker re-arms it; this keeps each socket's callbacks serial.
+class EpollReactor : public IoReactor {
+   public:
+    explicit EpollReactor(size_t worker_count) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        timer_fd_ =
+            timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+        // Level-triggered and never read: once signalled it wakes every
+        // worker for shutdown.
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = EventKey(wake_fd_);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = EventKey(timer_fd_);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &event);
+
+        for (size_t i = 0; i < worker_count; ++i) {
+            workers_.emplace_back([this]() { Run(); });
+        }
+    }
+
+    ~EpollReactor() override {
+        running_ = false;
+        uint64_t one = 1;
+        ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+        (void)ignored;
+        for (auto& worker : workers_) worker.join();
+        for (auto& pair : writers_) {
+            close(pair.second->watch_fd);
+            pair.second->queue->Close(ECANCELED);
+        }
+        close(timer_fd_);
+        close(wake_fd_);
+        close(epoll_fd_);
+    }
+
+    size_t worker_count() const override { return workers_.size(); }
+
+    bool Add(NativeSocket socket, IoHandler handler) override {
+        if (!SetNonBlocking(socket)) return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (registrations_.count(socket) != 0) return false;
+
+        epoll_event event = {};
+        event.events = kReadEvents;
+        event.data.u64 = EventKey(socket);
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket, &event) != 0) {
+            return false;
+        }
+        auto registration = std::make_shared<Registration>();
+        registration->fd = socket;
+        registration->handler = std::move(handler);
+        registrations_[socket] = std::move(registration);
+        return true;
+    }
+
+    void StopReading(NativeSocket socket) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = registrations_.find(socket);
+        if (it == registrations_.end()) return;
+        std::shared_ptr<Registration> registration = std::move(it->second);
+        registrations_.erase(it);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket, nullptr);
+        WaitForServiceLocked(*registration, &lock);
+    }
+
+    bool AddWriter(NativeSocket socket,
+                   std::shared_ptr<WriteQueue> queue) override {
+        if (!SetNonBlocking(socket)) return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writers_.count(socket) != 0) return false;
+        int watch_fd = fcntl(socket, F_DUPFD_CLOEXEC, 0);
+        if (watch_fd < 0) return false;
+
+        auto writer = std::make_shared<Writer>();
+        writer->fd = socket;
+        writer->watch_fd = watch_fd;
+        writer->queue = std::move(queue);
+        writers_[socket] = std::move(writer);
+        return true;
+    }
+
+    void Flush(NativeSocket socket) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = writers_.find(socket);
+        if (it == writers_.end()) return;
+        if (it->second->in_service) {
+            it->second->flush_requested = true;
+        } else {
+            WatchWritableLocked(it->second.get());
+        }
+    }
+
+    void WatchDeadline(NativeSocket socket,
+                       WriteQueue::Clock::time_point deadline) override {
+        std::shared_ptr<WriteQueue> queue;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = writers_.find(socket);
+            if (it == writers_.end()) return;
+            queue = it->second->queue;
+        }
+        if (queue->ArmExpiry(deadline)) ExpireAt(queue, deadline);
+    }
+
+    void Remove(NativeSocket socket) override {
+        StopReading(socket);
+
+        std::shared_ptr<Writer> writer;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto it = writers_.find(socket);
+            if (it == writers_.end()) return;
+            writer = std::move(it->second);
+            writers_.erase(it);
+            WaitForServiceLocked(*writer, &lock);
+            if (writer->watched) {
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, writer->watch_fd, nullptr);
+            }
+        }
+        close(writer->watch_fd);
+        writer->queue->Close(ECANCELED);
+    }
+
+    bool GetStats(NativeSocket socket, IoStats* stats) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = registrations_.find(socket);
+        if (it == registrations_.end()) return false;
+        stats->read_size = it->second->current_read_size.load();
+        stats->reads = it->second->reads.load();
+        stats->bytes_read = it->second->bytes_read.load();
+        return true;
+    }
+
+    void Resume(NativeSocket socket) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = registrations_.find(socket);
+        if (it == registrations_.end()) return;
+        Registration& registration = *it->second;
+        if (registration.paused) {
+            registration.paused = false;
+            // Otherwise the worker re-arms it when it is done.
+            if (!registration.in_service) ArmLocked(socket);
+        } else {
+            // The worker that is about to pause picks this up instead.
+            registration.resume_requested = true;
+        }
+    }
+
+    void RunAfter(std::chrono::microseconds delay,
+                  std::function<void()> task) override {
+        if (timers_.Add(TimerQueue::Clock::now() + delay, std::move(task))) {
+            ArmTimer();
+        }
+    }
+
+   private:
+    static constexpr uint32_t kReadEvents =
+        EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+
+    // Must be called with |lock| on |mutex_| held. Returns once no worker
+    // serves |target|, unless that is the calling thread.
+    template <typename Target>
+    void WaitForServiceLocked(const Target& target,
+                              std::unique_lock<std::mutex>* lock) {
+        if (target.service_thread == std::this_thread::get_id()) return;
+        service_done_.wait(*lock, [&]() { return !target.in_service; });
+    }
+
+    // Must be called with |mutex_| held.
+    void ArmLocked(int fd) {
+        epoll_event event = {};
+        event.events = kReadEvents;
+        event.data.u64 = EventKey(fd);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+    }
+
+    // Must be called with |mutex_| held, by the queue's drainer.
+    void WatchWritableLocked(Writer* writer) {
+        epoll_event event = {};
+        event.events = EPOLLOUT | EPOLLONESHOT;
+        event.data.u64 = EventKey(writer->fd) | kWriteEvent;
+        epoll_ctl(epoll_fd_, writer->watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                  writer->watch_fd, &event);
+        writer->watched = true;
+    }
+
+    // Points the timerfd at the earliest pending deadline. Serialized so a
+    // stale deadline read by one thread cannot overwrite a newer one.
+    void ArmTimer() {
+        std::lock_guard<std::mutex> lock(arm_mutex_);
+        TimerQueue::Clock::time_point deadline;
+        if (!timers_.NextDeadline(&deadline)) return;
+
+        auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline - TimerQueue::Clock::now());
+        // A zero it_value would disarm the timer, so fire overdue ones asap.
+        long long nanoseconds = delay.count() > 0 ? delay.count() : 1;
+
+        itimerspec spec = {};
+        spec.it_value.tv_sec = static_cast<time_t>(nanoseconds / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(nanoseconds % 1000000000);
+        timerfd_settime(timer_fd_, 0, &spec, nullptr);
+    }
+
+    void ExpireAt(const std::shared_ptr<WriteQueue>& queue,
+                  TimerQueue::Clock::time_point deadline) {
+        std::weak_ptr<WriteQueue> weak_queue = queue;
+        if (timers_.Add(deadline,
+                        [this, weak_queue]() { ExpireWrites(weak_queue); })) {
+            ArmTimer();
+        }
+    }
+
+    // Sending stops by itself after a write that started timed out: the
+    // drainer waits for the socket to drain at most, and the closed queue
+    // hands it nothing more.
+    void ExpireWrites(const std::weak_ptr<WriteQueue>& weak_queue) {
+        std::shared_ptr<WriteQueue> queue = weak_queue.lock();
+        if (!queue) return;
+        WriteQueue::Clock::time_point rearm;
+        queue->Expire(WriteQueue::Clock::now(), &rearm);
+        if (rearm != WriteQueue::Clock::time_point()) ExpireAt(queue, rearm);
+    }
+
+    void RunTimers() {
+        uint64_t expirations;
+        ssize_t ignored = read(timer_fd_, &expirations, sizeof(expirations));
+        (void)ignored;
+
+        auto expired = timers_.TakeExpired(TimerQueue::Clock::now());
+        // Hand the timer to the next free worker before running the tasks.
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = EventKey(timer_fd_);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, timer_fd_, &event);
+
+        for (auto& task : expired) task();
+        ArmTimer();
+    }
+
+    void Run() {
+        // Per worker, so workers never contend for a read buffer.
+        std::vector<uint8_t> read_buffer(AdaptiveReadSize::kMaxSize);
+        epoll_event events[kMaxEvents];
+        while (running_) {
+            int count = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            for (int i = 0; i < count && running_; ++i) {
+                uint64_t key = events[i].data.u64;
+                int fd = static_cast<int>(key & 0xffffffff);
+                if (key & kWriteEvent) {
+                    ServeWrites(fd);
+                } else if (fd == timer_fd_) {
+                    RunTimers();
+                } else if (fd != wake_fd_) {
+                    Serve(fd, read_buffer.data());
+                }
+            }
+        }
+    }
+
+    // Runs the handler of |fd|, marked as in service so Remove() can wait
+    // for it to finish. Re-arming happens under the same lock as the
+    // unmarking, so the next worker cannot start before this one is done.
+    void Serve(int fd, uint8_t* read_buffer) {
+        std::shared_ptr<Registration> registration;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = registrations_.find(fd);
+            if (it == registrations_.end()) return;
+            registration = it->second;
+            registration->in_service = true;
+            registration->service_thread = std::this_thread::get_id();
+        }
+
+        Drain(registration, read_buffer);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        registration->in_service = false;
+        registration->service_thread = std::thread::id();
+        auto it = registrations_.find(fd);
+        if (it != registrations_.end() && it->second == registration &&
+            !registration->paused) {
+            ArmLocked(fd);
+        }
+        service_done_.notify_all();
+    }
+
+    void Drain(const std::shared_ptr<Registration>& registration,
+               uint8_t* read_buffer) {
+        const int fd = registration->fd;
+        const IoHandler& handler = registration->handler;
+
+        for (int reads = 0; reads < kMaxReadsPerWakeup; ++reads) {
+            size_t limit = registration->read_size.current();
+            if (handler.read_budget) {
+                size_t budget = handler.read_budget();
+                if (budget == 0) {
+                    Pause(registration.get());
+                    return;
+                }
+                if (budget < limit) limit = budget;
+            }
+            ssize_t received = recv(fd, read_buffer, limit, 0);
+            if (received > 0) {
+                size_t size = static_cast<size_t>(received);
+                registration->read_size.OnRead(limit, size);
+                registration->current_read_size.store(
+                    registration->read_size.current(),
+                    std::memory_order_relaxed);
+                registration->reads.fetch_add(1, std::memory_order_relaxed);
+                registration->bytes_read.fetch_add(size,
+                                                   std::memory_order_relaxed);
+                if (handler.on_data) handler.on_data(read_buffer, size);
+                // A short read drained the socket; skip the recv() that
+                // would only report EAGAIN. Re-arming catches races.
+                if (size < limit) return;
+                continue;
+            }
+            if (received == 0) {
+                Close(registration, 0);
+                return;
+            }
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                Close(registration, errno);
+            }
+            return;
+        }
+    }
+
+    // Leaves the socket disarmed, so neither input nor a hangup is reported
+    // until Resume(); unless Resume() already came in, and the socket is
+    // re-armed as usual.
+    void Pause(Registration* registration) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (registration->resume_requested) {
+            registration->resume_requested = false;
+        } else {
+            registration->paused = true;
+        }
+    }
+
+    void Close(const std::shared_ptr<Registration>& registration, int error) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = registrations_.find(registration->fd);
+            // Removed (or replaced) by the owner while we were reading.
+            if (it == registrations_.end() || it->second != registration) {
+                return;
+            }
+            registrations_.erase(it);
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, registration->fd, nullptr);
+        }
+        if (registration->handler.on_closed) {
+            registration->handler.on_closed(error);
+        }
+    }
+
+    // Sends what the queue of |fd| holds; the drainer is whoever holds the
+    // write event. Watches for writability again if the socket filled up.
+    void ServeWrites(int fd) {
+        std::shared_ptr<Writer> writer;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = writers_.find(fd);
+            if (it == writers_.end()) return;
+            writer = it->second;
+            writer->in_service = true;
+            writer->service_thread = std::this_thread::get_id();
+        }
+
+        bool blocked = SendQueued(*writer);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        writer->in_service = false;
+        writer->service_thread = std::thread::id();
+        auto it = writers_.find(fd);
+        if ((blocked || writer->flush_requested) && it != writers_.end() &&
+            it->second == writer) {
+            WatchWritableLocked(writer.get());
+        }
+        writer->flush_requested = false;
+        service_done_.notify_all();
+    }
+
+    // Returns true if sending has to wait for the socket to drain. A failed
+    // send fails the queue; the reads report the broken link themselves. A
+    // queue holding off for more writes is flushed again once it is due.
+    bool SendQueued(const Writer& writer) {
+        WriteQueue::Span spans[kMaxSendSpans];
+        iovec vectors[kMaxSendSpans];
+        for (int sends = 0; sends < kMaxSendsPerWakeup; ++sends) {
+            auto hold = writer.queue->HoldTime();
+            if (hold.count() > 0) {
+                int fd = writer.fd;
+                RunAfter(hold, [this, fd]() { Flush(fd); });
+                return false;
+            }
+            size_t count = writer.queue->Peek(spans, kMaxSendSpans);
+            if (count == 0) return false;
+            // A short send resumes from the first unsent byte next round.
+            for (size_t i = 0; i < count; ++i) {
+                vectors[i].iov_base = const_cast<uint8_t*>(spans[i].data);
+                vectors[i].iov_len = spans[i].size;
+            }
+            msghdr message = {};
+            message.msg_iov = vectors;
+            message.msg_iovlen = count;
+            ssize_t sent = sendmsg(writer.fd, &message, MSG_NOSIGNAL);
+            if (sent > 0) {
+                writer.queue->Consume(static_cast<size_t>(sent));
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                // Nothing is in flight while the socket drains, so urgent
+                // writes may still go ahead of the spans.
+                writer.queue->Consume(0);
+                return true;
+            }
+            writer.queue->Close(sent < 0 ? errno : EPIPE);
+            return false;
+        }
+        // Still writable; let the other sockets have a turn first.
+        return true;
+    }
+
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    int timer_fd_ = -1;
+    TimerQueue timers_;
+    std::mutex arm_mutex_;
+    std::atomic<bool> running_{true};
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable service_done_;
+    std::map<int, std::shared_ptr<Registration>> registrations_;
+    std::map<int, std::shared_ptr<Writer>> writers_;
+};
+
+}  // namespace
+
+// static
+std::unique_ptr<IoReactor> IoReactor::Create(size_t worker_count) {
+    if (worker_count == 0) worker_count = std::thread::hardware_concurrency();
+    if (worker_count == 0) worker_count = 1;
+    return std::make_unique<EpollReactor>(worker_count);
+}
+
+}  // namespace bluetooth_classic_multiplatform
+
+#endif  // __linux__
@@ -0,0 +1,697 @@
+// Winsock backend of IoReactor.
+#ifdef _WIN32
+
+// This must be included before windows.h.
+#include <winsock2.h>
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "adaptive_read_size.h"
+#include "io_reactor.h"
+#include "timer_queue.h"
+#include "write_queue.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace bluetooth_classic_multiplatform {
+
+namespace {
+
+// Upper bound on reads per completion so one busy socket cannot starve the
+// others. The next zero-byte read completes at once while data remains.
+constexpr int kMaxReadsPerWakeup = 16;
+
+// Queued writes gathered into one WSASend, and the most bytes it takes.
+// A high-priority write waits for the whole send in flight, so that is
+// kept to about what a socket buffers rather than to 16 whole writes.
+constexpr size_t kMaxSendSpans = 16;
+constexpr size_t kMaxSendBytes = 64 * 1024;
+
+// Completion keys. Socket operations are told apart by their OVERLAPPED.
+constexpr ULONG_PTR kSocketKey = 0;
+constexpr ULONG_PTR kTimerKey = 1;
+constexpr ULONG_PTR kShutdownKey = 2;
+
+// Common head of every overlapped operation, so a completion maps back to
+// its reader or writer with a plain static_cast.
+struct Operation : OVERLAPPED {
+    explicit Operation(bool is_send) : is_send(is_send) {}
+    const bool is_send;
+};
+
+// The read side of a socket.
+struct Registration : Operation {
+    Registration() : Operation(false) {}
+
+    SOCKET socket;
+    IoHandler handler;
+    // Set while the zero-byte WSARecv is owned by the kernel, so the
+    // registration outlives a StopReading() that races with its completion.
+    std::shared_ptr<Registration> in_flight;
+    // Guarded by the reactor's mutex_.
+    bool paused = false;
+    bool resume_requested = false;
+    // Set while a worker runs the handler; StopReading() waits for it.
+    bool in_service = false;
+    std::thread::id service_thread;
+    // Owned by whichever worker took the socket's completion.
+    AdaptiveReadSize read_size;
+    // Mirrors for GetStats().
+    std::atomic<size_t> current_read_size{AdaptiveReadSize::kMinSize};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> bytes_read{0};
+};
+
+// The send side of a socket. Its queue is drained one overlapped WSASend at
+// a time; each completion hands the next bytes to the kernel.
+struct Writer : Operation {
+    Writer() : Operation(true) {}
+
+    SOCKET socket;
+    std::shared_ptr<WriteQueue> queue;
+    // Set while a WSASend is owned by the kernel; it keeps the queued
+    // buffers it points into alive as well.
+    std::shared_ptr<Writer> in_flight;
+    // Guarded by the reactor's mutex_.
+    bool in_service = false;
+    std::thread::id service_thread;
+};
+
+// A pool of workers blocked in GetQueuedCompletionStatus on one I/O
+// completion port. Each read socket keeps a single zero-byte overlapped
+// WSARecv outstanding: it completes once data (or a hangup) is queued,
+// without pinning a receive buffer per connection. The worker that takes the
+// completion then drains the socket with non-blocking recv() into its own
+// buffer and posts the next zero-byte read, so a socket is only ever served
+// by one worker at a time.
+//
+// A socket cannot be detached from a completion port, so a socket that was
+// removed cannot be added again; connections use a fresh socket anyway.
+class IocpReactor : public IoReactor {
+   public:
+    explicit IocpReactor(size_t worker_count) {
+        port_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0,
+                                       static_cast<DWORD>(worker_count));
+        // High resolution timers (Windows 10 1803+) avoid rounding short
+        // delays up to the 15.6 ms system tick.
+        timer_ = CreateWaitableTimerExW(nullptr, nullptr,
+                                        CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                        TIMER_ALL_ACCESS);
+        if (timer_ == nullptr) {
+            timer_ = CreateWaitableTimerW(nullptr, FALSE, nullptr);
+        }
+        stop_event_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+        // Only turns timer expiries into completion packets, so RunAfter()
+        // tasks run on the workers like everything else.
+        timer_thread_ = std::thread([this]() {
+            HANDLE handles[] = {stop_event_, timer_};
+            while (WaitForMultipleObjects(2, handles, FALSE, INFINITE) ==
+                   WAIT_OBJECT_0 + 1) {
+                PostQueuedCompletionStatus(port_, 0, kTimerKey, nullptr);
+            }
+        });
+        for (size_t i = 0; i < worker_count; ++i) {
+            workers_.emplace_back([this]() { Run(); });
+        }
+    }
+
+    ~IocpReactor() override {
+        std::vector<std::shared_ptr<WriteQueue>> idle_queues;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& pair : registrations_) {
+                CancelIoEx(reinterpret_cast<HANDLE>(pair.first),
+                           pair.second.get());
+            }
+            for (auto& pair : writers_) {
+                if (pair.second->in_flight) {
+                    CancelIoEx(reinterpret_cast<HANDLE>(pair.first),
+                               pair.second.get());
+                } else {
+                    idle_queues.push_back(pair.second->queue);
+                }
+            }
+            registrations_.clear();
+            writers_.clear();
+        }
+        SetEvent(stop_event_);
+        timer_thread_.join();
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            PostQueuedCompletionStatus(port_, 0, kShutdownKey, nullptr);
+        }
+        for (auto& worker : workers_) worker.join();
+        for (auto& queue : idle_queues) queue->Close(WSA_OPERATION_ABORTED);
+
+        // Collect the cancelled operations so they are freed, and fail the
+        // writes whose send was cut short.
+        while (ops_in_flight_ > 0) {
+            DWORD bytes;
+            ULONG_PTR key;
+            OVERLAPPED* overlapped = nullptr;
+            GetQueuedCompletionStatus(port_, &bytes, &key, &overlapped, 1000);
+            if (overlapped == nullptr) break;
+            auto* operation = static_cast<Operation*>(overlapped);
+            std::shared_ptr<Writer> writer;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (operation->is_send) {
+                    writer = TakeCompletionLocked(
+                        static_cast<Writer*>(operation));
+                } else {
+                    TakeCompletionLocked(
+                        static_cast<Registration*>(operation));
+                }
+            }
+            if (writer) writer->queue->Close(WSA_OPERATION_ABORTED);
+        }
+
+        CloseHandle(stop_event_);
+        CloseHandle(timer_);
+        CloseHandle(port_);
+    }
+
+    size_t worker_count() const override { return workers_.size(); }
+
+    bool Add(NativeSocket socket, IoHandler handler) override {
+        u_long non_blocking = 1;
+        if (ioctlsocket(socket, FIONBIO, &non_blocking) != 0) return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (registrations_.count(socket) != 0) return false;
+        if (!AssociateLocked(socket)) return false;
+
+        auto registration = std::make_shared<Registration>();
+        registration->socket = socket;
+        registration->handler = std::move(handler);
+        if (!PostReadLocked(registration)) return false;
+        registrations_[socket] = std::move(registration);
+        return true;
+    }
+
+    void StopReading(NativeSocket socket) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = registrations_.find(socket);
+        if (it == registrations_.end()) return;
+        std::shared_ptr<Registration> registration = std::move(it->second);
+        registrations_.erase(it);
+        // The aborted read still completes; the worker then finds the
+        // registration gone and drops it.
+        CancelIoEx(reinterpret_cast<HANDLE>(socket), registration.get());
+        WaitForServiceLocked(*registration, &lock);
+    }
+
+    bool AddWriter(NativeSocket socket,
+                   std::shared_ptr<WriteQueue> queue) override {
+        // Like the epoll backend, so owners can try a send of their own
+        // without blocking.
+        u_long non_blocking = 1;
+        if (ioctlsocket(socket, FIONBIO, &non_blocking) != 0) return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writers_.count(socket) != 0) return false;
+        if (!AssociateLocked(socket)) return false;
+
+        auto writer = std::make_shared<Writer>();
+        writer->socket = socket;
+        writer->queue = std::move(queue);
+        writers_[socket] = std::move(writer);
+        return true;
+    }
+
+    void Flush(NativeSocket socket) override {
+        std::shared_ptr<Writer> failed;
+        int error = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = writers_.find(socket);
+            // A worker in service looks at the queue again before it is
+            // done, and an outstanding send continues on its completion.
+            if (it == writers_.end() || it->second->in_service ||
+                it->second->in_flight) {
+                return;
+            }
+            if (PostSendLocked(it->second)) return;
+            failed = it->second;
+            error = WSAGetLastError();
+        }
+        failed->queue->Close(error);
+    }
+
+    void WatchDeadline(NativeSocket socket,
+                       WriteQueue::Clock::time_point deadline) override {
+        std::shared_ptr<Writer> writer;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = writers_.find(socket);
+            if (it == writers_.end()) return;
+            writer = it->second;
+        }
+        if (writer->queue->ArmExpiry(deadline)) ExpireAt(writer, deadline);
+    }
+
+    void Remove(NativeSocket socket) override {
+        StopReading(socket);
+
+        std::shared_ptr<Writer> writer;
+        bool sending = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            associated_.erase(socket);
+            auto it = writers_.find(socket);
+            if (it == writers_.end()) return;
+            writer = std::move(it->second);
+            writers_.erase(it);
+            WaitForServiceLocked(*writer, &lock);
+            // An aborted send fails the queue once it completes; until then
+            // the kernel may still read from the queued buffers.
+            sending = writer->in_flight != nullptr;
+            if (sending) {
+                CancelIoEx(reinterpret_cast<HANDLE>(socket), writer.get());
+            }
+        }
+        if (!sending) writer->queue->Close(WSA_OPERATION_ABORTED);
+    }
+
+    bool GetStats(NativeSocket socket, IoStats* stats) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = registrations_.find(socket);
+        if (it == registrations_.end()) return false;
+        stats->read_size = it->second->current_read_size.load();
+        stats->reads = it->second->reads.load();
+        stats->bytes_read = it->second->bytes_read.load();
+        return true;
+    }
+
+    void Resume(NativeSocket socket) override {
+        std::shared_ptr<Registration> failed;
+        int error = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = registrations_.find(socket);
+            if (it == registrations_.end()) return;
+            if (!it->second->paused) {
+                // The worker that is about to pause picks this up instead.
+                it->second->resume_requested = true;
+                return;
+            }
+            it->second->paused = false;
+            // Otherwise the worker posts the read when it is done.
+            if (it->second->in_service) return;
+            if (PostReadLocked(it->second)) return;
+            failed = it->second;
+            error = WSAGetLastError();
+        }
+        Close(failed, error);
+    }
+
+    void RunAfter(std::chrono::microseconds delay,
+                  std::function<void()> task) override {
+        if (timers_.Add(TimerQueue::Clock::now() + delay, std::move(task))) {
+            ArmTimer();
+        }
+    }
+
+   private:
+    // Points the waitable timer at the earliest pending deadline. Serialized
+    // so a stale deadline read by one thread cannot overwrite a newer one.
+    void ArmTimer() {
+        std::lock_guard<std::mutex> lock(arm_mutex_);
+        TimerQueue::Clock::time_point deadline;
+        if (!timers_.NextDeadline(&deadline)) return;
+
+        auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline - TimerQueue::Clock::now());
+        // Negative due times are relative, in 100 ns units.
+        LARGE_INTEGER due_time;
+        due_time.QuadPart = -(delay.count() > 0 ? delay.count() / 100 : 1);
+        SetWaitableTimer(timer_, &due_time, 0, nullptr, nullptr, FALSE);
+    }
+
+    void ExpireAt(const std::shared_ptr<Writer>& writer,
+                  TimerQueue::Clock::time_point deadline) {
+        std::weak_ptr<Writer> weak_writer = writer;
+        if (timers_.Add(deadline,
+                        [this, weak_writer]() { ExpireWrites(weak_writer); })) {
+            ArmTimer();
+        }
+    }
+
+    // A write that started timed out: the WSASend holding it would wait for
+    // the peer forever, so it is cancelled; its completion then finds the
+    // queue closed and fails the writes it carried.
+    void ExpireWrites(const std::weak_ptr<Writer>& weak_writer) {
+        std::shared_ptr<Writer> writer = weak_writer.lock();
+        if (!writer) return;
+        WriteQueue::Clock::time_point rearm;
+        if (writer->queue->Expire(WriteQueue::Clock::now(), &rearm)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Otherwise Remove() cancelled it already.
+            if (writer->in_flight && IsCurrentLocked(writer)) {
+                CancelIoEx(reinterpret_cast<HANDLE>(writer->socket),
+                           writer.get());
+            }
+        }
+        if (rearm != WriteQueue::Clock::time_point()) ExpireAt(writer, rearm);
+    }
+
+    void RunTimers() {
+        for (auto& task : timers_.TakeExpired(TimerQueue::Clock::now())) {
+            task();
+        }
+        ArmTimer();
+    }
+
+    // Must be called with |mutex_| held. Reads and writes share one
+    // association, made by whichever comes first.
+    bool AssociateLocked(SOCKET socket) {
+        if (associated_.count(socket) != 0) return true;
+        if (CreateIoCompletionPort(reinterpret_cast<HANDLE>(socket), port_,
+                                   kSocketKey, 0) == nullptr) {
+            return false;
+        }
+        associated_.insert(socket);
+        return true;
+    }
+
+    // Must be called with |lock| on |mutex_| held. Returns once no worker
+    // serves |target|, unless that is the calling thread.
+    template <typename Target>
+    void WaitForServiceLocked(const Target& target,
+                              std::unique_lock<std::mutex>* lock) {
+        if (target.service_thread == std::this_thread::get_id()) return;
+        service_done_.wait(*lock, [&]() { return !target.in_service; });
+    }
+
+    // Must be called with |mutex_| held. Queues the zero-byte read that
+    // reports the next arrival; on failure WSAGetLastError() says why.
+    bool PostReadLocked(const std::shared_ptr<Registration>& registration) {
+        OVERLAPPED* overlapped = registration.get();
+        ZeroMemory(overlapped, sizeof(OVERLAPPED));
+        registration->in_flight = registration;
+        ++ops_in_flight_;
+
+        WSABUF buffer = {0, nullptr};
+        DWORD flags = 0;
+        if (WSARecv(registration->socket, &buffer, 1, nullptr, &flags,
+                    overlapped, nullptr) == 0 ||
+            WSAGetLastError() == WSA_IO_PENDING) {
+            // The completion may already be running on another worker.
+            return true;
+        }
+        int error = WSAGetLastError();
+        registration->in_flight.reset();
+        --ops_in_flight_;
+        WSASetLastError(error);
+        return false;
+    }
+
+    // Must be called with |mutex_| held, by the queue's drainer. Sends the
+    // front of the queue, or hands the queue back if it is empty; on failure
+    // WSAGetLastError() says why.
+    bool PostSendLocked(const std::shared_ptr<Writer>& writer) {
+        // Holding off for more writes; Flush() comes back once it is due.
+        auto hold = writer->queue->HoldTime();
+        if (hold.count() > 0) {
+            SOCKET socket = writer->socket;
+            RunAfter(hold, [this, socket]() { Flush(socket); });
+            return true;
+        }
+
+        WriteQueue::Span spans[kMaxSendSpans];
+        size_t count =
+            writer->queue->Peek(spans, kMaxSendSpans, kMaxSendBytes);
+        if (count == 0) return true;
+
+        // Gathers several queued writes into one call. Winsock captures the
+        // WSABUF array before returning, so it may live on the stack; a
+        // send that completes short resumes from the first unsent byte.
+        WSABUF buffers[kMaxSendSpans];
+        DWORD buffer_count = 0;
+        for (size_t i = 0; i < count; ++i) {
+            buffers[i].len = static_cast<ULONG>(std::min<size_t>(
+                spans[i].size, std::numeric_limits<ULONG>::max()));
+            buffers[i].buf =
+                reinterpret_cast<char*>(const_cast<uint8_t*>(spans[i].data));
+            ++buffer_count;
+            // Nothing may follow a span that was cut short.
+            if (buffers[i].len < spans[i].size) break;
+        }
+
+        OVERLAPPED* overlapped = writer.get();
+        ZeroMemory(overlapped, sizeof(OVERLAPPED));
+        writer->in_flight = writer;
+        ++ops_in_flight_;
+
+        if (WSASend(writer->socket, buffers, buffer_count, nullptr, 0,
+                    overlapped, nullptr) == 0 ||
+            WSAGetLastError() == WSA_IO_PENDING) {
+            return true;
+        }
+        int error = WSAGetLastError();
+        writer->in_flight.reset();
+        --ops_in_flight_;
+        WSASetLastError(error);
+        return false;
+    }
+
+    // Must be called with |mutex_| held.
+    template <typename Target>
+    std::shared_ptr<Target> TakeCompletionLocked(Target* target) {
+        std::shared_ptr<Target> owner = std::move(target->in_flight);
+        --ops_in_flight_;
+        return owner;
+    }
+
+    bool IsCurrentLocked(const std::shared_ptr<Registration>& registration) {
+        auto it = registrations_.find(registration->socket);
+        return it != registrations_.end() && it->second == registration;
+    }
+
+    bool IsCurrentLocked(const std::shared_ptr<Writer>& writer) {
+        auto it = writers_.find(writer->socket);
+        return it != writers_.end() && it->second == writer;
+    }
+
+    void Run() {
+        // Per worker, so workers never contend for a read buffer.
+        std::vector<char> read_buffer(AdaptiveReadSize::kMaxSize);
+        for (;;) {
+            DWORD bytes = 0;
+            ULONG_PTR key = 0;
+            OVERLAPPED* overlapped = nullptr;
+            BOOL ok = GetQueuedCompletionStatus(port_, &bytes, &key,
+                                                &overlapped, INFINITE);
+            if (overlapped == nullptr) {
+                if (!ok || key == kShutdownKey) return;
+                if (key == kTimerKey) RunTimers();
+                continue;
+            }
+
+            auto* operation = static_cast<Operation*>(overlapped);
+            if (operation->is_send) {
+                ServeSend(static_cast<Writer*>(operation), ok, bytes);
+            } else {
+                ServeRead(static_cast<Registration*>(operation), ok,
+                          read_buffer.data());
+            }
+        }
+    }
+
+    // Runs the handler, marked as in service so StopReading() can wait for
+    // it. The next read is posted under the same lock as the unmarking, so
+    // its completion cannot be served before this worker is done.
+    void ServeRead(Registration* completed, BOOL ok, char* read_buffer) {
+        std::shared_ptr<Registration> registration;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            registration = TakeCompletionLocked(completed);
+            // Removed (or replaced) by the owner; the read was aborted.
+            if (!IsCurrentLocked(registration)) return;
+            registration->in_service = true;
+            registration->service_thread = std::this_thread::get_id();
+        }
+
+        if (ok) {
+            Service(registration, read_buffer);
+        } else {
+            DWORD bytes = 0;
+            DWORD flags = 0;
+            WSAGetOverlappedResult(registration->socket, completed, &bytes,
+                                   FALSE, &flags);
+            Close(registration, WSAGetLastError());
+        }
+
+        int error = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!IsCurrentLocked(registration) || registration->paused ||
+                PostReadLocked(registration)) {
+                FinishServiceLocked(registration.get());
+                return;
+            }
+            error = WSAGetLastError();
+        }
+        // Still in service: the close is one of this socket's callbacks.
+        Close(registration, error);
+        std::lock_guard<std::mutex> lock(mutex_);
+        FinishServiceLocked(registration.get());
+    }
+
+    template <typename Target>
+    void FinishServiceLocked(Target* target) {
+        target->in_service = false;
+        target->service_thread = std::thread::id();
+        service_done_.notify_all();
+    }
+
+    void Service(const std::shared_ptr<Registration>& registration,
+                 char* read_buffer) {
+        const IoHandler& handler = registration->handler;
+        for (int reads = 0; reads < kMaxReadsPerWakeup; ++reads) {
+            size_t limit = registration->read_size.current();
+            if (handler.read_budget) {
+                size_t budget = handler.read_budget();
+                if (budget == 0) {
+                    Pause(registration.get());
+                    return;
+                }
+                if (budget < limit) limit = budget;
+            }
+            int received = recv(registration->socket, read_buffer,
+                                static_cast<int>(limit), 0);
+            if (received > 0) {
+                size_t size = static_cast<size_t>(received);
+                registration->read_size.OnRead(limit, size);
+                registration->current_read_size.store(
+                    registration->read_size.current(),
+                    std::memory_order_relaxed);
+                registration->reads.fetch_add(1, std::memory_order_relaxed);
+                registration->bytes_read.fetch_add(size,
+                                                   std::memory_order_relaxed);
+                if (handler.on_data) {
+                    handler.on_data(
+                        reinterpret_cast<const uint8_t*>(read_buffer), size);
+                }
+                // A short read drained the socket; skip the recv() that
+                // would only report WSAEWOULDBLOCK. The zero-byte read
+                // posted next catches anything arriving meanwhile.
+                if (size < limit) return;
+                continue;
+            }
+            if (received == 0) {
+                Close(registration, 0);
+                return;
+            }
+            int error = WSAGetLastError();
+            if (error != WSAEWOULDBLOCK) Close(registration, error);
+            return;
+        }
+    }
+
+    // Posts no read, so neither input nor a hangup is reported until
+    // Resume(); unless Resume() already came in, and the next read is
+    // posted as usual.
+    void Pause(Registration* registration) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (registration->resume_requested) {
+            registration->resume_requested = false;
+        } else {
+            registration->paused = true;
+        }
+    }
+
+    void Close(const std::shared_ptr<Registration>& registration, int error) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Removed (or replaced) by the owner while we were reading.
+            if (!IsCurrentLocked(registration)) return;
+            registrations_.erase(registration->socket);
+        }
+        if (registration->handler.on_closed) {
+            registration->handler.on_closed(error);
+        }
+    }
+
+    // Completes the sent bytes and sends what follows them. A failed send
+    // fails the queue; the reads report the broken link themselves.
+    void ServeSend(Writer* completed, BOOL ok, DWORD bytes) {
+        std::shared_ptr<Writer> writer;
+        bool current;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            writer = TakeCompletionLocked(completed);
+            current = IsCurrentLocked(writer);
+            if (current) {
+                writer->in_service = true;
+                writer->service_thread = std::this_thread::get_id();
+            }
+        }
+        if (!current) {
+            // Removed while sending; Remove() left the queue to us. A send
+            // that finished before the cancel still counts.
+            if (ok) writer->queue->Consume(bytes);
+            writer->queue->Close(WSA_OPERATION_ABORTED);
+            return;
+        }
+
+        int error = 0;
+        if (ok) {
+            writer->queue->Consume(bytes);
+        } else {
+            DWORD flags = 0;
+            WSAGetOverlappedResult(writer->socket, completed, &bytes, FALSE,
+                                   &flags);
+            error = WSAGetLastError();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (error == 0 && IsCurrentLocked(writer) &&
+                !PostSendLocked(writer)) {
+                error = WSAGetLastError();
+            }
+            FinishServiceLocked(writer.get());
+        }
+        if (error != 0) writer->queue->Close(error);
+    }
+
+    HANDLE port_;
+    HANDLE timer_;
+    HANDLE stop_event_;
+    TimerQueue timers_;
+    std::mutex arm_mutex_;
+    std::thread timer_thread_;
+    std::vector<std::thread> workers_;
+    std::atomic<int> ops_in_flight_{0};
+
+    std::mutex mutex_;
+    std::condition_variable service_done_;
+    std::set<SOCKET> associated_;
+    std::map<SOCKET, std::shared_ptr<Registration>> registrations_;
+    std::map<SOCKET, std::shared_ptr<Writer>> writers_;
+};
+
+}  // namespace
+
+// static
+std::unique_ptr<IoReactor> IoReactor::Create(size_t worker_count) {
+    if (worker_count == 0) worker_count = std::thread::hardware_concurrency();
+    if (worker_count == 0) worker_count = 1;
+    return std::make_unique<IocpReactor>(worker_count);
+}
+
+}  // namespace bluetooth_classic_multiplatform
+
+#endif  // _WIN32
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace bluetooth_classic_multiplatform {
+
+// Read-only mapping of a whole file, laid out for one sequential pass. The
+// view stays valid for the lifetime of the object.
+class MappedFile {
+   public:
+    // Maps the file at |path| (UTF-8). Returns null and sets |error| to the
+    // system error (GetLastError() / errno) if it cannot be opened or
+    // mapped. An empty file maps to data() == nullptr and size() == 0.
+    static std::unique_ptr<MappedFile> Open(const std::string& path,
+                                            int* error);
+
+    ~MappedFile();
+
+    // Disallow copy and assign.
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+   private:
+    MappedFile() = default;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace bluetooth_classic_multiplatform
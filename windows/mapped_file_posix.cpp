@@ -0,0 +1,49 @@
+#include "mapped_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bluetooth_classic_multiplatform {
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path,
+                                             int* error) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *error = errno;
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        *error = errno;
+        close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    if (info.st_size == 0) {
+        // mmap() refuses a zero length.
+        close(fd);
+        return mapped;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    // The mapping keeps the file open.
+    void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        *error = errno;
+        return nullptr;
+    }
+    madvise(view, size, MADV_SEQUENTIAL);
+    mapped->data_ = static_cast<const uint8_t*>(view);
+    mapped->size_ = size;
+    return mapped;
+}
+
+MappedFile::~MappedFile() {
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,65 @@
+#include "mapped_file.h"
+
+#include <windows.h>
+
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path,
+                                             int* error) {
+    int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    if (length <= 0) {
+        *error = static_cast<int>(GetLastError());
+        return nullptr;
+    }
+    std::vector<wchar_t> wide_path(length);
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wide_path.data(),
+                        length);
+
+    HANDLE file = CreateFileW(wide_path.data(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        *error = static_cast<int>(GetLastError());
+        return nullptr;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) ||
+        static_cast<uint64_t>(file_size.QuadPart) > SIZE_MAX) {
+        *error = static_cast<int>(GetLastError());
+        if (*error == 0) *error = ERROR_FILE_TOO_LARGE;
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    if (file_size.QuadPart == 0) {
+        // CreateFileMapping() refuses empty files.
+        CloseHandle(file);
+        return mapped;
+    }
+    // The view keeps the mapping, and the mapping the file, open.
+    HANDLE mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        *error = static_cast<int>(GetLastError());
+        return nullptr;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view) {
+        *error = static_cast<int>(GetLastError());
+        return nullptr;
+    }
+    mapped->data_ = static_cast<const uint8_t*>(view);
+    mapped->size_ = static_cast<size_t>(file_size.QuadPart);
+    return mapped;
+}
+
+MappedFile::~MappedFile() {
+    if (data_) UnmapViewOfFile(data_);
+}
+
+}  // namespace bluetooth_classic_multiplatform
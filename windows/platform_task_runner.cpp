@@ -0,0 +1,96 @@
+#include "platform_task_runner.h"
+
+#include <cstdio>
+#include <utility>
+
+namespace bluetooth_classic_multiplatform {
+
+namespace {
+
+constexpr wchar_t kWindowClassName[] =
+    L"BluetoothClassicMultiplatformPlatformTaskWindow";
+
+// The message that tells the window to run the queued tasks.
+constexpr UINT kRunTasksMessage = WM_APP;
+
+}  // namespace
+
+PlatformTaskRunner::PlatformTaskRunner() {
+    // The class belongs to the module of this code, the plugin DLL, rather
+    // than to the executable.
+    HMODULE module = nullptr;
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                           GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                       reinterpret_cast<LPCWSTR>(&WindowProc), &module);
+    WNDCLASSEXW window_class = {};
+    window_class.cbSize = sizeof(window_class);
+    window_class.lpfnWndProc = WindowProc;
+    window_class.hInstance = module;
+    window_class.lpszClassName = kWindowClassName;
+    // A second runner finds the class registered already.
+    if (!RegisterClassExW(&window_class) &&
+        GetLastError() != ERROR_CLASS_ALREADY_EXISTS) {
+        fprintf(stderr, "PlatformTaskRunner: RegisterClassEx failed: %lu\n",
+                GetLastError());
+        return;
+    }
+    // Message-only, so it is never shown and needs no top-level window; it
+    // belongs to this thread, which then runs what is posted to it.
+    window_ = CreateWindowExW(0, kWindowClassName, L"", 0, 0, 0, 0, 0,
+                              HWND_MESSAGE, nullptr, module, nullptr);
+    if (window_ == nullptr) {
+        fprintf(stderr, "PlatformTaskRunner: CreateWindowEx failed: %lu\n",
+                GetLastError());
+        return;
+    }
+    SetWindowLongPtrW(window_, GWLP_USERDATA,
+                      reinterpret_cast<LONG_PTR>(this));
+}
+
+PlatformTaskRunner::~PlatformTaskRunner() {
+    if (window_ != nullptr) DestroyWindow(window_);
+}
+
+void PlatformTaskRunner::PostTask(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+        if (message_pending_) return;
+        message_pending_ = true;
+    }
+
+    if (window_ == nullptr ||
+        !PostMessageW(window_, kRunTasksMessage, 0, 0)) {
+        // The queue of the platform thread is full, or the window could not
+        // be created; the tasks run with the next message that does make it
+        // through.
+        std::lock_guard<std::mutex> lock(mutex_);
+        message_pending_ = false;
+    }
+}
+
+// static
+LRESULT CALLBACK PlatformTaskRunner::WindowProc(HWND hwnd, UINT message,
+                                                WPARAM wparam, LPARAM lparam) {
+    if (message == kRunTasksMessage) {
+        auto* runner = reinterpret_cast<PlatformTaskRunner*>(
+            GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+        if (runner != nullptr) runner->RunPendingTasks();
+        return 0;
+    }
+    return DefWindowProcW(hwnd, message, wparam, lparam);
+}
+
+void PlatformTaskRunner::RunPendingTasks() {
+    std::deque<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks.swap(tasks_);
+        message_pending_ = false;
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+}  // namespace bluetooth_classic_multiplatform
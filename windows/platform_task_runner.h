@@ -0,0 +1,40 @@
+#pragma once
+#include <windows.h>
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace bluetooth_classic_multiplatform {
+
+// Runs tasks on the Flutter platform thread, which is the only thread allowed
+// to talk to channels. Tasks are handed over by posting a private message to
+// a message-only window of the runner's own, so any thread may call
+// PostTask(), with or without a view. Must be created and destroyed on the
+// platform thread.
+class PlatformTaskRunner {
+   public:
+    PlatformTaskRunner();
+    ~PlatformTaskRunner();
+
+    // Disallow copy and assign.
+    PlatformTaskRunner(const PlatformTaskRunner&) = delete;
+    PlatformTaskRunner& operator=(const PlatformTaskRunner&) = delete;
+
+    void PostTask(std::function<void()> task);
+
+   private:
+    static LRESULT CALLBACK WindowProc(HWND hwnd, UINT message, WPARAM wparam,
+                                       LPARAM lparam);
+    void RunPendingTasks();
+
+    HWND window_ = nullptr;
+
+    std::mutex mutex_;
+    std::deque<std::function<void()>> tasks_;
+    // Set while a wake-up message is in flight, so a burst of PostTask()
+    // calls costs a single window message.
+    bool message_pending_ = false;
+};
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,81 @@
+#include "receive_buffer.h"
+
+namespace bluetooth_classic_multiplatform {
+
+bool ParseOverflowPolicy(const std::string& name, OverflowPolicy* policy) {
+    if (name == "backpressure") {
+        *policy = OverflowPolicy::kBackpressure;
+    } else if (name == "dropOldest") {
+        *policy = OverflowPolicy::kDropOldest;
+    } else if (name == "dropNewest") {
+        *policy = OverflowPolicy::kDropNewest;
+    } else if (name == "disconnect") {
+        *policy = OverflowPolicy::kDisconnect;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+ReceiveBuffer::ReceiveBuffer(size_t capacity, OverflowPolicy policy)
+    : ring_(capacity), policy_(policy) {}
+
+ReceiveBufferStats ReceiveBuffer::GetStats() const {
+    ReceiveBufferStats stats;
+    stats.capacity = ring_.capacity();
+    stats.buffered_bytes = ring_.Available();
+    stats.overflow_count = overflow_count_.load(std::memory_order_relaxed);
+    stats.dropped_bytes = dropped_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+size_t ReceiveBuffer::ReadBudget() {
+    if (policy_ != OverflowPolicy::kBackpressure) return ring_.capacity();
+
+    size_t budget = ring_.FreeSpace();
+    if (budget > 0) return budget;
+
+    // Flag first, then look again: a consumer that drained in between
+    // either sees the flag and resumes us, or left room we can use now.
+    reads_paused_.store(true);
+    budget = ring_.FreeSpace();
+    if (budget == 0) CountOverflow(0);
+    return budget;
+}
+
+bool ReceiveBuffer::Store(const uint8_t* data, size_t size) {
+    switch (policy_) {
+        case OverflowPolicy::kBackpressure:
+        case OverflowPolicy::kDropNewest: {
+            // Under kBackpressure reads never exceed the budget, so this
+            // only drops if the caller ignored it.
+            size_t stored = ring_.Write(data, size);
+            if (stored < size) CountOverflow(size - stored);
+            return true;
+        }
+        case OverflowPolicy::kDropOldest: {
+            size_t dropped = ring_.WriteOverwriting(data, size);
+            if (dropped > 0) CountOverflow(dropped);
+            return true;
+        }
+        case OverflowPolicy::kDisconnect: {
+            if (!overflowed_) {
+                size_t stored = ring_.Write(data, size);
+                if (stored == size) return true;
+                overflowed_ = true;
+                CountOverflow(size - stored);
+            } else {
+                dropped_bytes_.fetch_add(size, std::memory_order_relaxed);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+void ReceiveBuffer::CountOverflow(size_t dropped) {
+    overflow_count_.fetch_add(1, std::memory_order_relaxed);
+    dropped_bytes_.fetch_add(dropped, std::memory_order_relaxed);
+}
+
+}  // namespace bluetooth_classic_multiplatform
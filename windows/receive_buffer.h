@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "spsc_byte_ring.h"
+
+namespace bluetooth_classic_multiplatform {
+
+// What a connection does when the peer sends faster than Dart drains.
+enum class OverflowPolicy {
+    // Stop reading the socket; RFCOMM flow control then throttles the peer.
+    kBackpressure,
+    // Discard the oldest buffered bytes to make room.
+    kDropOldest,
+    // Discard the bytes that do not fit.
+    kDropNewest,
+    // Close the connection.
+    kDisconnect,
+};
+
+// Maps the Dart enum names ("backpressure", "dropOldest", ...) to a policy.
+bool ParseOverflowPolicy(const std::string& name, OverflowPolicy* policy);
+
+struct ReceiveBufferStats {
+    size_t capacity = 0;
+    size_t buffered_bytes = 0;
+    // Times incoming data did not fit (for kBackpressure: reads paused).
+    uint64_t overflow_count = 0;
+    uint64_t dropped_bytes = 0;
+};
+
+// Bounded per-connection receive buffer. The I/O thread is the only
+// producer and the platform thread the only consumer, as for the ring
+// underneath; the counters may be read from anywhere.
+class ReceiveBuffer {
+   public:
+    ReceiveBuffer(size_t capacity, OverflowPolicy policy);
+
+    // Disallow copy and assign.
+    ReceiveBuffer(const ReceiveBuffer&) = delete;
+    ReceiveBuffer& operator=(const ReceiveBuffer&) = delete;
+
+    OverflowPolicy policy() const { return policy_; }
+    size_t Available() const { return ring_.Available(); }
+    ReceiveBufferStats GetStats() const;
+
+    // Producer side, for IoHandler::read_budget. Under kBackpressure this is
+    // the free space, and a 0 also marks reads as paused; the other
+    // policies always accept a full read.
+    size_t ReadBudget();
+
+    // Producer side. Stores |data| according to the policy. Returns false
+    // once the buffer overflowed under kDisconnect; everything received
+    // after that is dropped.
+    bool Store(const uint8_t* data, size_t size);
+
+    // Consumer side.
+    size_t ReadAll(std::vector<uint8_t>* out) { return ring_.ReadAll(out); }
+    size_t Read(uint8_t* out, size_t size) { return ring_.Read(out, size); }
+    void Clear() { ring_.Clear(); }
+
+    // Consumer side, after draining. Returns true exactly once per pause,
+    // and the caller then has to resume reading the socket.
+    bool TakeResumeRequest() { return reads_paused_.exchange(false); }
+
+   private:
+    void CountOverflow(size_t dropped);
+
+    SpscByteRing ring_;
+    const OverflowPolicy policy_;
+    std::atomic<bool> reads_paused_{false};
+    bool overflowed_ = false;  // Producer-owned.
+    std::atomic<uint64_t> overflow_count_{0};
+    std::atomic<uint64_t> dropped_bytes_{0};
+};
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+namespace bluetooth_classic_multiplatform {
+
+// How a connection is brought back after its link dropped.
+struct ReconnectPolicy {
+    // Wait before the second attempt, doubling after each failed one...
+    std::chrono::microseconds initial_delay{100000};
+    // ...up to this.
+    std::chrono::microseconds max_delay{5000000};
+    // Attempts before giving up; 0 keeps trying until disconnected.
+    int max_attempts = 10;
+};
+
+// Picks the wait before each reconnect attempt. The first goes out at once,
+// as an RF dropout often clears within the page it takes; each later one
+// waits twice as long as the one before, up to max_delay. The wait is
+// drawn from the upper half of that, so devices that dropped together do
+// not page in step.
+class ReconnectBackoff {
+   public:
+    explicit ReconnectBackoff(const ReconnectPolicy& policy,
+                              uint32_t seed = std::random_device()())
+        : policy_(policy), random_(seed) {}
+
+    int attempts() const { return attempts_; }
+
+    // Counts an attempt and sets |delay| to wait before it; false once the
+    // policy's attempts ran out.
+    bool Next(std::chrono::microseconds* delay) {
+        if (policy_.max_attempts > 0 && attempts_ >= policy_.max_attempts) {
+            return false;
+        }
+        if (attempts_++ == 0) {
+            *delay = std::chrono::microseconds(0);
+            return true;
+        }
+        int64_t ceiling = policy_.initial_delay.count();
+        int64_t max = policy_.max_delay.count();
+        for (int i = 2; i < attempts_ && ceiling < max; ++i) ceiling *= 2;
+        if (ceiling > max) ceiling = max;
+        if (ceiling <= 0) {
+            *delay = std::chrono::microseconds(0);
+            return true;
+        }
+        std::uniform_int_distribution<int64_t> jitter(ceiling / 2, ceiling);
+        *delay = std::chrono::microseconds(jitter(random_));
+        return true;
+    }
+
+   private:
+    ReconnectPolicy policy_;
+    std::mt19937 random_;
+    int attempts_ = 0;
+};
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+
+// Keeps the producer's and the consumer's hot fields on separate cache lines.
+constexpr size_t kCacheLineSize = 64;
+
+// Fixed-capacity single-producer/single-consumer byte queue. The I/O thread
+// writes, the platform thread reads, and neither ever takes a lock: the
+// producer owns the write index, the consumer advances the read index.
+//
+// The one exception is WriteOverwriting(), which lets the producer discard
+// the oldest bytes itself. Both sides therefore move the read index with a
+// compare-and-swap, and a consumer whose bytes were discarded (and possibly
+// overwritten) mid-copy notices the failed swap and retries.
+class SpscByteRing {
+   public:
+    // |capacity| is rounded up to the next power of two.
+    explicit SpscByteRing(size_t capacity) {
+        size_t rounded = 1;
+        while (rounded < capacity) rounded <<= 1;
+        mask_ = rounded - 1;
+        buffer_.reset(new uint8_t[rounded]);
+    }
+
+    // Disallow copy and assign.
+    SpscByteRing(const SpscByteRing&) = delete;
+    SpscByteRing& operator=(const SpscByteRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Bytes ready to be read. Safe to call from any thread.
+    size_t Available() const {
+        // Read index first: the write index can only be further ahead.
+        size_t read = read_pos_.load(std::memory_order_acquire);
+        return write_pos_.load(std::memory_order_acquire) - read;
+    }
+
+    // Producer side. Space a Write() is guaranteed to find.
+    size_t FreeSpace() const {
+        return capacity() - (write_pos_.load(std::memory_order_relaxed) -
+                             read_pos_.load(std::memory_order_acquire));
+    }
+
+    // Producer side. Copies as much of |data| as fits and returns how many
+    // bytes were accepted.
+    size_t Write(const uint8_t* data, size_t size) {
+        size_t write = write_pos_.load(std::memory_order_relaxed);
+        size_t free_space = capacity() - (write - cached_read_pos_);
+        if (free_space < size) {
+            cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+            free_space = capacity() - (write - cached_read_pos_);
+        }
+        if (size > free_space) size = free_space;
+        if (size == 0) return 0;
+
+        size_t offset = write & mask_;
+        size_t first = size < capacity() - offset ? size : capacity() - offset;
+        std::memcpy(&buffer_[offset], data, first);
+        std::memcpy(&buffer_[0], data + first, size - first);
+        write_pos_.store(write + size, std::memory_order_release);
+        return size;
+    }
+
+    // Producer side. Stores all of |data|, discarding the oldest buffered
+    // bytes to make room, and returns how many bytes were lost. If |data|
+    // alone exceeds the capacity only its tail is kept.
+    size_t WriteOverwriting(const uint8_t* data, size_t size) {
+        size_t dropped = 0;
+        if (size > capacity()) {
+            dropped = size - capacity();
+            data += dropped;
+            size = capacity();
+        }
+
+        size_t write = write_pos_.load(std::memory_order_relaxed);
+        size_t read = read_pos_.load(std::memory_order_acquire);
+        while (capacity() - (write - read) < size) {
+            size_t target = write + size - capacity();
+            if (read_pos_.compare_exchange_weak(read, target,
+                                                std::memory_order_acq_rel)) {
+                dropped += target - read;
+                break;
+            }
+        }
+        Write(data, size);
+        return dropped;
+    }
+
+    // Consumer side. Copies up to |size| bytes into |out|.
+    size_t Read(uint8_t* out, size_t size) {
+        size_t read = read_pos_.load(std::memory_order_acquire);
+        for (;;) {
+            size_t available = cached_write_pos_ - read;
+            // The second test catches a stale cache that a producer-side
+            // discard has moved |read| past.
+            if (available < size || available > capacity()) {
+                cached_write_pos_ = write_pos_.load(std::memory_order_acquire);
+                available = cached_write_pos_ - read;
+            }
+            size_t count = size < available ? size : available;
+            if (count == 0) return 0;
+
+            size_t offset = read & mask_;
+            size_t first =
+                count < capacity() - offset ? count : capacity() - offset;
+            std::memcpy(out, &buffer_[offset], first);
+            std::memcpy(out + first, &buffer_[0], count - first);
+            // Fails only if the producer discarded some of these bytes while
+            // they were being copied; |read| then holds the new position.
+            if (read_pos_.compare_exchange_strong(read, read + count,
+                                                  std::memory_order_acq_rel)) {
+                return count;
+            }
+        }
+    }
+
+    // Consumer side. Appends everything currently buffered to |out|.
+    size_t ReadAll(std::vector<uint8_t>* out) {
+        size_t old_size = out->size();
+        out->resize(old_size + Available());
+        size_t read = Read(out->data() + old_size, out->size() - old_size);
+        out->resize(old_size + read);
+        return read;
+    }
+
+    // Consumer side. Discards everything currently buffered.
+    void Clear() {
+        size_t read = read_pos_.load(std::memory_order_acquire);
+        do {
+            cached_write_pos_ = write_pos_.load(std::memory_order_acquire);
+        } while (!read_pos_.compare_exchange_weak(read, cached_write_pos_,
+                                                  std::memory_order_acq_rel));
+    }
+
+   private:
+    std::unique_ptr<uint8_t[]> buffer_;
+    size_t mask_;
+
+    // Producer-owned.
+    alignas(kCacheLineSize) std::atomic<size_t> write_pos_{0};
+    size_t cached_read_pos_ = 0;
+
+    // Consumer-owned.
+    alignas(kCacheLineSize) std::atomic<size_t> read_pos_{0};
+    size_t cached_write_pos_ = 0;
+};
+
+}  // namespace bluetooth_classic_multiplatform
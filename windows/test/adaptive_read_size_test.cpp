@@ -0,0 +1,42 @@
+#include "adaptive_read_size.h"
+
+#include <gtest/gtest.h>
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+TEST(AdaptiveReadSize, StartsAtMinimum) {
+    AdaptiveReadSize size;
+    EXPECT_EQ(size.current(), AdaptiveReadSize::kMinSize);
+}
+
+TEST(AdaptiveReadSize, DoublesOnFullReadsUpToMaximum) {
+    AdaptiveReadSize size;
+    size.OnRead(size.current(), size.current());
+    EXPECT_EQ(size.current(), 2 * AdaptiveReadSize::kMinSize);
+
+    for (int i = 0; i < 16; ++i) size.OnRead(size.current(), size.current());
+    EXPECT_EQ(size.current(), AdaptiveReadSize::kMaxSize);
+}
+
+TEST(AdaptiveReadSize, HalvesAfterRunOfSmallReads) {
+    AdaptiveReadSize size;
+    for (int i = 0; i < 3; ++i) size.OnRead(size.current(), size.current());
+    size_t grown = size.current();
+
+    for (int i = 0; i < AdaptiveReadSize::kShrinkAfter - 1; ++i) {
+        size.OnRead(size.current(), 10);
+    }
+    EXPECT_EQ(size.current(), grown);
+    size.OnRead(size.current(), 10);
+    EXPECT_EQ(size.current(), grown / 2);
+}
+
+TEST(AdaptiveReadSize, IgnoresCappedRequests) {
+    AdaptiveReadSize size;
+    size.OnRead(100, 100);
+    EXPECT_EQ(size.current(), AdaptiveReadSize::kMinSize);
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
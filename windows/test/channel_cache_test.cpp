@@ -0,0 +1,134 @@
+#include "channel_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+namespace {
+
+constexpr uint64_t kDevice = 0x001122334455;
+constexpr char kSpp[] = "00001101-0000-1000-8000-00805F9B34FB";
+
+// A cache file path that is deleted again with the object.
+class TempPath {
+   public:
+    explicit TempPath(const std::string& name) : path_(name) {
+        std::remove(path_.c_str());
+    }
+    ~TempPath() { std::remove(path_.c_str()); }
+
+    const std::string& path() const { return path_; }
+
+   private:
+    std::string path_;
+};
+
+}  // namespace
+
+TEST(ChannelCache, CountsHitsAndMisses) {
+    TempPath file("channel_cache_test.txt");
+    ChannelCache cache(file.path());
+    std::string value;
+    EXPECT_FALSE(cache.Lookup(kDevice, kSpp, &value));
+
+    cache.Store(kDevice, kSpp, "5");
+    ASSERT_TRUE(cache.Lookup(kDevice, kSpp, &value));
+    EXPECT_EQ(value, "5");
+    // Other devices and services are kept apart.
+    EXPECT_FALSE(cache.Lookup(kDevice + 1, kSpp, &value));
+    EXPECT_FALSE(cache.Lookup(kDevice, "0000110A-0000-1000-8000-00805F9B34FB",
+                              &value));
+
+    ChannelCacheStats stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 3u);
+    EXPECT_EQ(stats.entries, 1u);
+}
+
+TEST(ChannelCache, PersistsAcrossInstances) {
+    TempPath file("channel_cache_persist_test.txt");
+    {
+        ChannelCache cache(file.path());
+        cache.Store(kDevice, kSpp, "(00:11:22:33:44:55) Bluetooth#RFCOMM:5");
+        cache.Store(0x00aabbccddee, kSpp, "12");
+    }
+    ChannelCache cache(file.path());
+    std::string value;
+    // The service UUID matches in any case.
+    ASSERT_TRUE(cache.Lookup(kDevice, "00001101-0000-1000-8000-00805f9b34fb",
+                             &value));
+    EXPECT_EQ(value, "(00:11:22:33:44:55) Bluetooth#RFCOMM:5");
+    ASSERT_TRUE(cache.Lookup(0x00aabbccddee, kSpp, &value));
+    EXPECT_EQ(value, "12");
+}
+
+TEST(ChannelCache, InvalidateRemovesEntryFromFile) {
+    TempPath file("channel_cache_invalidate_test.txt");
+    {
+        ChannelCache cache(file.path());
+        cache.Store(kDevice, kSpp, "5");
+        cache.Invalidate(kDevice, kSpp);
+        // Nothing to drop: not counted.
+        cache.Invalidate(kDevice, kSpp);
+        std::string value;
+        EXPECT_FALSE(cache.Lookup(kDevice, kSpp, &value));
+        EXPECT_EQ(cache.GetStats().invalidations, 1u);
+    }
+    ChannelCache cache(file.path());
+    std::string value;
+    EXPECT_FALSE(cache.Lookup(kDevice, kSpp, &value));
+}
+
+// The file is only read by the first lookup, and what cannot be parsed is
+// skipped.
+TEST(ChannelCache, LoadsLazilyAndSkipsBadLines) {
+    TempPath file("channel_cache_lazy_test.txt");
+    ChannelCache cache(file.path());
+    {
+        std::ofstream out(file.path());
+        out << "# bluetooth_classic_multiplatform channel cache 1\n"
+            << "garbage\n"
+            << "xyz " << kSpp << " 3\n"
+            << "001122334455 " << kSpp << " 7\n";
+    }
+    std::string value;
+    ASSERT_TRUE(cache.Lookup(kDevice, kSpp, &value));
+    EXPECT_EQ(value, "7");
+    EXPECT_EQ(cache.GetStats().entries, 1u);
+
+    TempPath other("channel_cache_version_test.txt");
+    {
+        std::ofstream out(other.path());
+        out << "# some other format\n"
+            << "001122334455 " << kSpp << " 7\n";
+    }
+    ChannelCache old_version(other.path());
+    EXPECT_FALSE(old_version.Lookup(kDevice, kSpp, &value));
+}
+
+TEST(ChannelCache, EvictsOldestBeyondLimit) {
+    TempPath file("channel_cache_evict_test.txt");
+    {
+        ChannelCache cache(file.path());
+        for (uint64_t device = 0; device <= ChannelCache::kMaxEntries;
+             ++device) {
+            cache.Store(device, kSpp, "1");
+        }
+        EXPECT_EQ(cache.GetStats().entries, ChannelCache::kMaxEntries);
+    }
+    // The order survives a restart: device 1 is the oldest now.
+    ChannelCache cache(file.path());
+    std::string value;
+    EXPECT_FALSE(cache.Lookup(0, kSpp, &value));
+    cache.Store(1000, kSpp, "1");
+    EXPECT_FALSE(cache.Lookup(1, kSpp, &value));
+    EXPECT_TRUE(cache.Lookup(2, kSpp, &value));
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,287 @@
+#include "channel_prober.h"
+
+#include <gtest/gtest.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "socket_pair.h"
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+// Loopback TCP ports standing in for the RFCOMM channels of a device:
+// Listen() opens a channel, and every other one refuses connects.
+class FakeDevice {
+   public:
+    ~FakeDevice() {
+        for (const auto& listener : listeners_) {
+            CloseNativeSocket(listener.second);
+        }
+        for (const auto& pair : hanging_) {
+            CloseSocket(pair.plugin_side);
+            CloseSocket(pair.peer_side);
+        }
+    }
+
+    void Listen(int channel) {
+        NativeSocket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address = Address(0);
+        ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr*>(&address),
+                       sizeof(address)),
+                  0);
+        ASSERT_EQ(listen(listener, 4), 0);
+        listeners_[channel] = listener;
+    }
+
+    // A channel whose connect never finishes.
+    void Hang(int channel) { hang_.push_back(channel); }
+
+    StartConnect Connector() {
+        return [this](int channel, int* error) {
+            for (int hanging : hang_) {
+                if (hanging != channel) continue;
+                // Never writable: the send buffer is full, and the peer
+                // never reads.
+                SocketPair pair;
+                EXPECT_TRUE(MakeSocketPair(&pair));
+                hanging_.push_back(pair);
+                FillSendBuffer(pair.plugin_side);
+                return pair.plugin_side;
+            }
+            NativeSocket connecting =
+                socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            sockaddr_in address = Address(PortOf(channel));
+            if (!StartNonBlockingConnect(connecting, &address,
+                                         sizeof(address), error)) {
+                CloseNativeSocket(connecting);
+                return kInvalidNativeSocket;
+            }
+            return connecting;
+        };
+    }
+
+   private:
+    static sockaddr_in Address(uint16_t port) {
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        return address;
+    }
+
+    // A closed channel maps to a port that was just released, so nothing
+    // listens there.
+    uint16_t PortOf(int channel) {
+        auto it = listeners_.find(channel);
+        NativeSocket bound = kInvalidNativeSocket;
+        if (it == listeners_.end()) {
+            bound = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            sockaddr_in address = Address(0);
+            bind(bound, reinterpret_cast<sockaddr*>(&address),
+                 sizeof(address));
+        }
+        sockaddr_in address = {};
+        socklen_t size = sizeof(address);
+        getsockname(it == listeners_.end() ? bound : it->second,
+                    reinterpret_cast<sockaddr*>(&address), &size);
+        if (bound != kInvalidNativeSocket) CloseNativeSocket(bound);
+        return ntohs(address.sin_port);
+    }
+
+    static void FillSendBuffer(NativeSocket socket) {
+#ifdef _WIN32
+        u_long non_blocking = 1;
+        ioctlsocket(socket, FIONBIO, &non_blocking);
+#else
+        fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+        std::vector<char> chunk(64 * 1024, 'x');
+        while (send(socket, chunk.data(), static_cast<int>(chunk.size()),
+                    0) > 0) {
+        }
+    }
+
+    std::map<int, NativeSocket> listeners_;
+    std::vector<int> hang_;
+    std::vector<SocketPair> hanging_;
+};
+
+std::vector<int> Channels(int first, int last) {
+    std::vector<int> channels;
+    for (int channel = first; channel <= last; ++channel) {
+        channels.push_back(channel);
+    }
+    return channels;
+}
+
+}  // namespace
+
+TEST(ChannelProber, FindsOpenChannel) {
+    FakeDevice device;
+    device.Listen(6);
+    ProbeResult result = ProbeChannels(Channels(1, 8), 4, milliseconds(1000),
+                                       device.Connector());
+    ASSERT_NE(result.socket, kInvalidNativeSocket);
+    EXPECT_EQ(result.channel, 6);
+    EXPECT_EQ(result.error, 0);
+    // Nothing after the winner is started once it connected.
+    EXPECT_GE(result.attempts, 6u);
+    EXPECT_LE(result.attempts, 8u);
+    CloseNativeSocket(result.socket);
+}
+
+// The result is the one a sequential scan would find, even when a later
+// channel answers first.
+TEST(ChannelProber, PrefersEarlierChannel) {
+    FakeDevice device;
+    device.Hang(1);
+    device.Listen(2);
+    device.Listen(3);
+    ProbeResult result = ProbeChannels({1, 2, 3}, 3, milliseconds(100),
+                                       device.Connector());
+    ASSERT_NE(result.socket, kInvalidNativeSocket);
+    EXPECT_EQ(result.channel, 2);
+    CloseNativeSocket(result.socket);
+
+    result = ProbeChannels({1, 3, 2}, 3, milliseconds(100),
+                           device.Connector());
+    ASSERT_NE(result.socket, kInvalidNativeSocket);
+    EXPECT_EQ(result.channel, 3);
+    CloseNativeSocket(result.socket);
+}
+
+TEST(ChannelProber, ReportsErrorWhenNoChannelAccepts) {
+    FakeDevice device;
+    ProbeResult result = ProbeChannels(Channels(1, 5), 2, milliseconds(1000),
+                                       device.Connector());
+    EXPECT_EQ(result.socket, kInvalidNativeSocket);
+    EXPECT_NE(result.error, 0);
+    EXPECT_EQ(result.attempts, 5u);
+
+    result = ProbeChannels({}, 2, milliseconds(1000), device.Connector());
+    EXPECT_EQ(result.socket, kInvalidNativeSocket);
+    EXPECT_EQ(result.attempts, 0u);
+}
+
+// Channels that never answer are waited for side by side: four of them
+// cost one timeout, not four.
+TEST(ChannelProber, TimesOutStalledChannelsInParallel) {
+    FakeDevice device;
+    for (int channel = 1; channel <= 4; ++channel) device.Hang(channel);
+    device.Listen(5);
+    auto start = steady_clock::now();
+    ProbeResult result = ProbeChannels(Channels(1, 5), 4, milliseconds(200),
+                                       device.Connector());
+    auto elapsed = steady_clock::now() - start;
+    ASSERT_NE(result.socket, kInvalidNativeSocket);
+    EXPECT_EQ(result.channel, 5);
+    EXPECT_GE(elapsed, milliseconds(190));
+    EXPECT_LT(elapsed, milliseconds(400));
+    CloseNativeSocket(result.socket);
+}
+
+// Cancel() from another thread ends a probe that would otherwise wait out
+// the attempt timeout, and closes what it had open.
+TEST(ChannelProber, StopsWhenCancelled) {
+    FakeDevice device;
+    for (int channel = 1; channel <= 4; ++channel) device.Hang(channel);
+    ConnectCancellation cancellation;
+    std::thread canceller([&cancellation]() {
+        std::this_thread::sleep_for(milliseconds(100));
+        cancellation.Cancel();
+    });
+    auto start = steady_clock::now();
+    ProbeResult result = ProbeChannels(Channels(1, 4), 4, milliseconds(5000),
+                                       device.Connector(), &cancellation);
+    auto elapsed = steady_clock::now() - start;
+    canceller.join();
+    EXPECT_EQ(result.socket, kInvalidNativeSocket);
+    EXPECT_EQ(result.error, kConnectCancelled);
+    EXPECT_LT(elapsed, milliseconds(100) + 4 * kCancellationPollInterval);
+
+    // Cancelled before it started: nothing is tried.
+    result = ProbeChannels(Channels(1, 4), 4, milliseconds(5000),
+                           device.Connector(), &cancellation);
+    EXPECT_EQ(result.error, kConnectCancelled);
+    EXPECT_EQ(result.attempts, 0u);
+}
+
+// The deadline of the whole connect cuts the attempt timeout short.
+TEST(ChannelProber, StopsAtDeadline) {
+    FakeDevice device;
+    device.Hang(1);
+    device.Listen(2);
+    ConnectCancellation cancellation(steady_clock::now() + milliseconds(150));
+    auto start = steady_clock::now();
+    ProbeResult result = ProbeChannels({1, 2}, 1, milliseconds(5000),
+                                       device.Connector(), &cancellation);
+    auto elapsed = steady_clock::now() - start;
+    EXPECT_EQ(result.socket, kInvalidNativeSocket);
+    EXPECT_EQ(result.error, kConnectTimedOut);
+    EXPECT_GE(elapsed, milliseconds(140));
+    EXPECT_LT(elapsed, milliseconds(400));
+    // Channel 2 would have accepted, but was never reached.
+    EXPECT_EQ(result.attempts, 1u);
+}
+
+TEST(ChannelProber, RunCancellableWaitsForCall) {
+    ConnectCancellation cancellation;
+    int result = 0;
+    EXPECT_TRUE(RunCancellable(
+        [&result]() {
+            std::this_thread::sleep_for(milliseconds(20));
+            result = 7;
+        },
+        cancellation));
+    EXPECT_EQ(result, 7);
+}
+
+// A call that blocks past Cancel() is left to finish on its own.
+TEST(ChannelProber, RunCancellableStopsWaitingWhenCancelled) {
+    auto release = std::make_shared<std::promise<void>>();
+    auto finished = std::make_shared<std::promise<void>>();
+    std::shared_future<void> released = release->get_future().share();
+    std::future<void> done = finished->get_future();
+    ConnectCancellation cancellation;
+    std::thread canceller([&cancellation]() {
+        std::this_thread::sleep_for(milliseconds(50));
+        cancellation.Cancel();
+    });
+    auto start = steady_clock::now();
+    bool returned = RunCancellable(
+        [released, finished]() {
+            released.wait();
+            finished->set_value();
+        },
+        cancellation);
+    auto elapsed = steady_clock::now() - start;
+    canceller.join();
+    EXPECT_FALSE(returned);
+    EXPECT_LT(elapsed, milliseconds(50) + 4 * kCancellationPollInterval);
+
+    release->set_value();
+    EXPECT_EQ(done.wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,153 @@
+#include "connect_batch.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+namespace {
+
+using std::chrono::milliseconds;
+
+struct Report {
+    std::string address;
+    int id;
+    int error;
+
+    bool operator==(const Report& other) const {
+        return std::tie(address, id, error) ==
+               std::tie(other.address, other.id, other.error);
+    }
+};
+
+std::vector<std::string> Addresses(int count) {
+    std::vector<std::string> addresses;
+    for (int i = 0; i < count; ++i) {
+        addresses.push_back("00:00:00:00:00:" + std::to_string(10 + i));
+    }
+    return addresses;
+}
+
+}  // namespace
+
+TEST(ConnectBatch, ClampsParallelism) {
+    EXPECT_EQ(ClampConnectParallelism(-3), 1u);
+    EXPECT_EQ(ClampConnectParallelism(0), 1u);
+    EXPECT_EQ(ClampConnectParallelism(1), 1u);
+    EXPECT_EQ(ClampConnectParallelism(kDefaultConnectParallelism),
+              static_cast<size_t>(kDefaultConnectParallelism));
+    EXPECT_EQ(ClampConnectParallelism(kMaxConnectParallelism),
+              static_cast<size_t>(kMaxConnectParallelism));
+    EXPECT_EQ(ClampConnectParallelism(1000),
+              static_cast<size_t>(kMaxConnectParallelism));
+}
+
+// Devices connected already are reported with their ids, those being
+// connected or named twice as in progress; only the rest are connected.
+TEST(ConnectBatch, PlanSkipsConnectedPendingAndDuplicates) {
+    std::map<std::string, int> connected{{"A", 7}};
+    std::set<std::string> pending{"B"};
+    std::vector<Report> reports;
+    std::vector<std::string> queued = PlanConnectBatch(
+        {"A", "B", "C", "D", "C", "A"},
+        [&](const std::string& address) {
+            auto it = connected.find(address);
+            return it != connected.end() ? it->second : 0;
+        },
+        [&](const std::string& address) { return pending.count(address) > 0; },
+        [&](const std::string& address, int id, int error) {
+            reports.push_back({address, id, error});
+        });
+
+    EXPECT_EQ(queued, (std::vector<std::string>{"C", "D"}));
+    std::vector<Report> expected{
+        {"A", 7, 0},
+        {"B", 0, kConnectInProgress},
+        {"C", 0, kConnectInProgress},
+        {"A", 7, 0},
+    };
+    EXPECT_EQ(reports, expected);
+}
+
+TEST(ConnectBatch, TakesEachDeviceOnceAcrossWorkers) {
+    constexpr int kDevices = 200;
+    ConnectBatch batch(Addresses(kDevices), std::chrono::microseconds(0));
+    std::mutex mutex;
+    std::vector<size_t> taken;
+    std::atomic<int> lasts{0};
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < ClampConnectParallelism(100); ++i) {
+        workers.emplace_back([&]() {
+            size_t index = 0;
+            while (batch.Take(&index)) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    taken.push_back(index);
+                }
+                if (batch.Finish()) ++lasts;
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    ASSERT_EQ(taken.size(), static_cast<size_t>(kDevices));
+    std::sort(taken.begin(), taken.end());
+    for (size_t i = 0; i < taken.size(); ++i) EXPECT_EQ(taken[i], i);
+    EXPECT_EQ(lasts, 1);
+    size_t index = 0;
+    EXPECT_FALSE(batch.Take(&index));
+}
+
+// A device's timeout counts from when a worker takes it, not from when the
+// batch was queued.
+TEST(ConnectBatch, TimeoutStartsWhenDeviceIsTaken) {
+    ConnectBatch batch(Addresses(2), milliseconds(100));
+    size_t index = 0;
+    ASSERT_TRUE(batch.Take(&index));
+    EXPECT_EQ(batch.cancellation(index)->Check(), 0);
+
+    std::this_thread::sleep_for(milliseconds(150));
+    EXPECT_EQ(batch.cancellation(0)->Check(), kConnectTimedOut);
+    // Queued all along, but only starting now.
+    ASSERT_TRUE(batch.Take(&index));
+    EXPECT_EQ(index, 1u);
+    EXPECT_EQ(batch.cancellation(1)->Check(), 0);
+}
+
+TEST(ConnectBatch, NoTimeoutUnlessGiven) {
+    ConnectBatch batch(Addresses(1), std::chrono::microseconds(0));
+    size_t index = 0;
+    ASSERT_TRUE(batch.Take(&index));
+    EXPECT_EQ(batch.cancellation(index)->deadline(),
+              ConnectCancellation::Clock::time_point::max());
+}
+
+// Cancelling a batch stops the devices under way and those still queued,
+// and leaves another batch to the same devices alone.
+TEST(ConnectBatch, CancelStopsOnlyItsOwnDevices) {
+    ConnectBatch first(Addresses(3), std::chrono::microseconds(0));
+    ConnectBatch second(Addresses(3), std::chrono::microseconds(0));
+    size_t index = 0;
+    ASSERT_TRUE(first.Take(&index));
+
+    first.Cancel();
+    for (size_t i = 0; i < first.size(); ++i) {
+        EXPECT_EQ(first.cancellation(i)->Check(), kConnectCancelled);
+        EXPECT_EQ(second.cancellation(i)->Check(), 0);
+        EXPECT_EQ(first.address(i), second.address(i));
+    }
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
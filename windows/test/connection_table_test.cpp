@@ -0,0 +1,112 @@
+#include "connection_table.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+namespace {
+
+struct Entry {
+    explicit Entry(int value) : value(value) {}
+    int value;
+};
+
+int InsertNew(ConnectionTable<Entry>* table, int value) {
+    int id = table->NewId();
+    table->Insert(id, std::make_shared<Entry>(value));
+    return id;
+}
+
+}  // namespace
+
+TEST(ConnectionTable, FindsWhatWasInserted) {
+    ConnectionTable<Entry> table;
+    int first = InsertNew(&table, 10);
+    int second = InsertNew(&table, 20);
+
+    ASSERT_NE(table.Find(first), nullptr);
+    EXPECT_EQ(table.Find(first)->value, 10);
+    EXPECT_EQ(table.Find(second)->value, 20);
+    EXPECT_EQ(table.Find(second + 1), nullptr);
+    EXPECT_EQ(table.size(), 2u);
+}
+
+TEST(ConnectionTable, RemovedIdsAreNeverReused) {
+    ConnectionTable<Entry> table;
+    int old_id = InsertNew(&table, 1);
+    std::shared_ptr<Entry> removed = table.Remove(old_id);
+
+    // Whoever still holds the entry keeps it; the table forgets it.
+    ASSERT_NE(removed, nullptr);
+    EXPECT_EQ(removed->value, 1);
+    EXPECT_EQ(table.Find(old_id), nullptr);
+    EXPECT_EQ(table.Remove(old_id), nullptr);
+
+    // Enough inserts to wrap every shard at least once.
+    for (size_t i = 0; i < 2 * ConnectionTable<Entry>::kShardCount; ++i) {
+        EXPECT_NE(InsertNew(&table, 2), old_id);
+    }
+    EXPECT_EQ(table.Find(old_id), nullptr);
+}
+
+TEST(ConnectionTable, SnapshotCoversAllShards) {
+    ConnectionTable<Entry> table;
+    std::set<int> values;
+    for (int i = 0; i < 100; ++i) {
+        InsertNew(&table, i);
+        values.insert(i);
+    }
+
+    std::set<int> seen;
+    for (const auto& entry : table.Snapshot()) seen.insert(entry->value);
+    EXPECT_EQ(seen, values);
+}
+
+// Readers look entries up by id while another thread keeps adding and
+// removing others; lookups of the stable entries must never miss.
+TEST(ConnectionTable, ConcurrentLookupsWhileMutating) {
+    constexpr int kStable = 64;
+    ConnectionTable<Entry> table;
+    std::vector<int> stable_ids;
+    for (int i = 0; i < kStable; ++i) {
+        stable_ids.push_back(InsertNew(&table, i));
+    }
+
+    std::atomic<bool> running{true};
+    std::thread mutator([&]() {
+        while (running) {
+            int id = InsertNew(&table, -1);
+            table.Remove(id);
+            std::this_thread::yield();
+        }
+    });
+
+    std::atomic<int> misses{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&]() {
+            for (int round = 0; round < 2000; ++round) {
+                for (int i = 0; i < kStable; ++i) {
+                    auto entry = table.Find(stable_ids[i]);
+                    if (!entry || entry->value != i) ++misses;
+                }
+            }
+        });
+    }
+    for (auto& reader : readers) reader.join();
+    running = false;
+    mutator.join();
+
+    EXPECT_EQ(misses, 0);
+    EXPECT_EQ(table.size(), static_cast<size_t>(kStable));
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,144 @@
+#include "file_transfer.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "io_reactor.h"
+#include "socket_pair.h"
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+// A file with |contents| that is deleted again with the object.
+class TempFile {
+   public:
+    TempFile(const std::string& name, const std::string& contents)
+        : path_(name) {
+        std::ofstream out(path_, std::ios::binary);
+        out << contents;
+    }
+    ~TempFile() { std::remove(path_.c_str()); }
+
+    const std::string& path() const { return path_; }
+
+   private:
+    std::string path_;
+};
+
+std::unique_ptr<MappedFile> Map(const TempFile& file) {
+    int error = 0;
+    auto mapped = MappedFile::Open(file.path(), &error);
+    EXPECT_NE(mapped, nullptr) << "error " << error;
+    return mapped;
+}
+
+}  // namespace
+
+TEST(MappedFile, MapsWholeFile) {
+    TempFile file("mapped_file_test.bin", "firmware");
+    auto mapped = Map(file);
+    ASSERT_NE(mapped, nullptr);
+    ASSERT_EQ(mapped->size(), 8u);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(mapped->data()), 8),
+              "firmware");
+
+    TempFile empty("mapped_file_empty_test.bin", "");
+    mapped = Map(empty);
+    ASSERT_NE(mapped, nullptr);
+    EXPECT_EQ(mapped->size(), 0u);
+
+    int error = 0;
+    EXPECT_EQ(MappedFile::Open("does_not_exist.bin", &error), nullptr);
+    EXPECT_NE(error, 0);
+}
+
+// The whole file arrives in order while only a few chunks are queued at a
+// time, and progress ends at the file size.
+TEST(FileTransfer, StreamsFileThroughQueue) {
+    std::string contents;
+    for (int i = 0; i < 1024 * 1024 + 123; ++i) {
+        contents.push_back(static_cast<char>('a' + (i * 7) % 26));
+    }
+    TempFile file("file_transfer_test.bin", contents);
+
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    constexpr size_t kChunkSize = 16 * 1024;
+    std::atomic<uint64_t> last_progress{0};
+    std::atomic<bool> out_of_order{false};
+    std::atomic<size_t> max_queued{0};
+    std::atomic<int> done_calls{0};
+    std::atomic<int> done_error{-1};
+    FileTransfer::Callbacks callbacks;
+    callbacks.flush = [&]() { reactor->Flush(pair.plugin_side); };
+    callbacks.on_progress = [&](uint64_t sent, uint64_t total) {
+        if (sent <= last_progress || sent > total) out_of_order = true;
+        last_progress = sent;
+        size_t queued = queue->GetStats().queued_bytes;
+        if (queued > max_queued) max_queued = queued;
+    };
+    callbacks.on_done = [&](int error) {
+        done_error = error;
+        ++done_calls;
+    };
+    auto transfer = std::make_shared<FileTransfer>(Map(file), kChunkSize,
+                                                   queue, callbacks);
+    if (transfer->Start()) reactor->Flush(pair.plugin_side);
+    transfer.reset();
+
+    std::string received(contents.size(), '\0');
+    ASSERT_EQ(RecvAll(pair.peer_side, &received[0], received.size()),
+              contents.size());
+    EXPECT_TRUE(received == contents);
+
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    while (done_calls == 0 && steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(done_calls, 1);
+    EXPECT_EQ(done_error, 0);
+    EXPECT_EQ(last_progress, contents.size());
+    EXPECT_FALSE(out_of_order);
+    EXPECT_LE(max_queued, FileTransfer::kChunksInFlight * kChunkSize);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(FileTransfer, ReportsFirstErrorOnce) {
+    TempFile file("file_transfer_error_test.bin", std::string(100, 'x'));
+    auto queue = std::make_shared<WriteQueue>();
+    std::vector<int> errors;
+    FileTransfer::Callbacks callbacks;
+    callbacks.on_done = [&](int error) { errors.push_back(error); };
+    auto transfer =
+        std::make_shared<FileTransfer>(Map(file), 10, queue, callbacks);
+    EXPECT_TRUE(transfer->Start());
+    EXPECT_EQ(queue->GetStats().queued_writes, FileTransfer::kChunksInFlight);
+
+    // The link dropped: every queued chunk fails, the rest is never sent.
+    queue->Close(42);
+    EXPECT_EQ(errors, std::vector<int>{42});
+    EXPECT_EQ(queue->GetStats().queued_writes, 0u);
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
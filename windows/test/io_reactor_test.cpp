@@ -0,0 +1,950 @@
+#include "io_reactor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "socket_pair.h"
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+// Collects everything a reactor delivers for one socket.
+class Collector {
+   public:
+    IoHandler Handler() {
+        IoHandler handler;
+        handler.on_data = [this](const uint8_t* data, size_t size) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            data_.append(reinterpret_cast<const char*>(data), size);
+            ++chunks_;
+            changed_.notify_all();
+        };
+        handler.on_closed = [this](int error) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            error_ = error;
+            changed_.notify_all();
+        };
+        return handler;
+    }
+
+    bool WaitForSize(size_t size, milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, timeout,
+                                 [&]() { return data_.size() >= size; });
+    }
+
+    bool WaitForClose(milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, timeout, [&]() { return closed_; });
+    }
+
+    std::string data() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return data_;
+    }
+
+    int chunks() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return chunks_;
+    }
+
+    int error() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::string data_;
+    int chunks_ = 0;
+    bool closed_ = false;
+    int error_ = -1;
+};
+
+}  // namespace
+
+TEST(IoReactor, DeliversDataAsSoonAsItArrives) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    Collector collector;
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, collector.Handler()));
+
+    auto start = steady_clock::now();
+    ASSERT_EQ(SendAll(pair.peer_side, "ping", 4), 4);
+    ASSERT_TRUE(collector.WaitForSize(4, milliseconds(1000)));
+    auto latency = steady_clock::now() - start;
+
+    EXPECT_EQ(collector.data(), "ping");
+    // The old polling loop slept 10 ms between reads.
+    EXPECT_LT(latency, milliseconds(10));
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(IoReactor, IdleSocketProducesNoCallbacks) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    Collector collector;
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, collector.Handler()));
+
+    std::this_thread::sleep_for(milliseconds(50));
+    EXPECT_EQ(collector.chunks(), 0);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(IoReactor, DeliversLargeTransferInOrder) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    Collector collector;
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, collector.Handler()));
+
+    std::string payload(256 * 1024, '\0');
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(i * 31);
+    }
+    std::thread writer(
+        [&]() { SendAll(pair.peer_side, payload.data(), payload.size()); });
+    ASSERT_TRUE(collector.WaitForSize(payload.size(), milliseconds(5000)));
+    writer.join();
+
+    EXPECT_EQ(collector.data(), payload);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(IoReactor, BulkTransferUsesLargerReads) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    Collector collector;
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, collector.Handler()));
+
+    std::string payload(4 * 1024 * 1024, 'x');
+    std::thread writer(
+        [&]() { SendAll(pair.peer_side, payload.data(), payload.size()); });
+    ASSERT_TRUE(collector.WaitForSize(payload.size(), milliseconds(10000)));
+    writer.join();
+
+    IoStats stats;
+    ASSERT_TRUE(reactor->GetStats(pair.plugin_side, &stats));
+    EXPECT_EQ(stats.bytes_read, payload.size());
+    EXPECT_GT(stats.read_size, 1024u);
+    // Fixed 1 KiB reads would have needed 4096 of them.
+    EXPECT_LT(stats.reads, 1024u);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(IoReactor, ReportsRemoteClose) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    Collector collector;
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, collector.Handler()));
+
+    ASSERT_EQ(SendAll(pair.peer_side, "bye", 3), 3);
+    CloseSocket(pair.peer_side);
+
+    ASSERT_TRUE(collector.WaitForClose(milliseconds(1000)));
+    EXPECT_EQ(collector.data(), "bye");
+    EXPECT_EQ(collector.error(), 0);
+
+    CloseSocket(pair.plugin_side);
+}
+
+TEST(IoReactor, RemovedSocketIsNoLongerRead) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    Collector collector;
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, collector.Handler()));
+    reactor->Remove(pair.plugin_side);
+
+    ASSERT_EQ(SendAll(pair.peer_side, "late", 4), 4);
+    std::this_thread::sleep_for(milliseconds(50));
+    EXPECT_EQ(collector.chunks(), 0);
+
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(IoReactor, RemoveWaitsForRunningCallback) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    std::atomic<bool> entered{false};
+    std::atomic<bool> finished{false};
+    IoHandler handler;
+    handler.on_data = [&](const uint8_t*, size_t) {
+        entered = true;
+        std::this_thread::sleep_for(milliseconds(50));
+        finished = true;
+    };
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, std::move(handler)));
+
+    ASSERT_EQ(SendAll(pair.peer_side, "x", 1), 1);
+    while (!entered) std::this_thread::yield();
+    reactor->Remove(pair.plugin_side);
+    EXPECT_TRUE(finished);
+
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(IoReactor, CallbackMayRemoveItsOwnSocket) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    std::atomic<int> calls{0};
+    IoHandler handler;
+    handler.on_data = [&](const uint8_t*, size_t) {
+        reactor->Remove(pair.plugin_side);
+        ++calls;
+    };
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, std::move(handler)));
+
+    ASSERT_EQ(SendAll(pair.peer_side, "x", 1), 1);
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    while (calls == 0 && steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(SendAll(pair.peer_side, "y", 1), 1);
+    std::this_thread::sleep_for(milliseconds(50));
+    EXPECT_EQ(calls, 1);
+
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+// Tearing down busy connections must not wait on a reader to notice: every
+// Remove() plus the reactor's own shutdown stays within 5 ms a connection.
+TEST(IoReactor, TeardownUnderLoadIsBounded) {
+    constexpr int kSockets = 32;
+    constexpr int kWriters = 4;
+    auto reactor = IoReactor::Create(4);
+    SocketPair pairs[kSockets];
+    for (auto& pair : pairs) {
+        ASSERT_TRUE(MakeSocketPair(&pair));
+        IoHandler handler;
+        // Slow enough consumers that the workers are always mid-callback.
+        handler.on_data = [](const uint8_t*, size_t) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        };
+        ASSERT_TRUE(reactor->Add(pair.plugin_side, std::move(handler)));
+    }
+
+    std::atomic<bool> running{true};
+    std::atomic<int> writers_done{0};
+    std::thread writers[kWriters];
+    for (int w = 0; w < kWriters; ++w) {
+        writers[w] = std::thread([&, w]() {
+            const std::string chunk(1024, 'x');
+            while (running) {
+                for (int i = w; i < kSockets; i += kWriters) {
+                    SendAll(pairs[i].peer_side, chunk.data(), chunk.size());
+                }
+            }
+            ++writers_done;
+        });
+    }
+    std::this_thread::sleep_for(milliseconds(100));
+
+    auto start = steady_clock::now();
+    for (const auto& pair : pairs) reactor->Remove(pair.plugin_side);
+    reactor.reset();
+    auto elapsed = steady_clock::now() - start;
+    EXPECT_LT(elapsed, milliseconds(5) * kSockets);
+
+    // Unblock the writers by draining what they still send; the sockets are
+    // non-blocking since they were added.
+    running = false;
+    std::vector<char> sink(64 * 1024);
+    while (writers_done < kWriters) {
+        for (const auto& pair : pairs) {
+            recv(pair.plugin_side, sink.data(), static_cast<int>(sink.size()),
+                 0);
+        }
+    }
+    for (auto& writer : writers) writer.join();
+    for (const auto& pair : pairs) {
+        CloseSocket(pair.plugin_side);
+        CloseSocket(pair.peer_side);
+    }
+}
+
+TEST(IoReactor, ServesManySocketsFromFixedPool) {
+    constexpr int kSockets = 32;
+    constexpr size_t kPayloadSize = 64 * 1024;
+    auto reactor = IoReactor::Create(4);
+    EXPECT_EQ(reactor->worker_count(), 4u);
+    SocketPair pairs[kSockets];
+    Collector collectors[kSockets];
+    for (int i = 0; i < kSockets; ++i) {
+        ASSERT_TRUE(MakeSocketPair(&pairs[i]));
+        ASSERT_TRUE(
+            reactor->Add(pairs[i].plugin_side, collectors[i].Handler()));
+    }
+
+    // Every socket busy at once, so workers serve them in parallel; each
+    // stream must still arrive whole and in order.
+    std::string payloads[kSockets];
+    std::thread writers[kSockets];
+    for (int i = 0; i < kSockets; ++i) {
+        payloads[i].resize(kPayloadSize);
+        for (size_t j = 0; j < kPayloadSize; ++j) {
+            payloads[i][j] = static_cast<char>(j * 7 + i);
+        }
+        writers[i] = std::thread([&, i]() {
+            SendAll(pairs[i].peer_side, payloads[i].data(), kPayloadSize);
+        });
+    }
+    for (int i = 0; i < kSockets; ++i) {
+        ASSERT_TRUE(
+            collectors[i].WaitForSize(kPayloadSize, milliseconds(5000)));
+        EXPECT_EQ(collectors[i].data(), payloads[i]);
+    }
+    for (auto& writer : writers) writer.join();
+
+    for (auto& pair : pairs) {
+        reactor->Remove(pair.plugin_side);
+        CloseSocket(pair.plugin_side);
+        CloseSocket(pair.peer_side);
+    }
+}
+
+TEST(IoReactor, SendsQueuedWritesInOrder) {
+    auto reactor = IoReactor::Create(4);
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    constexpr int kWrites = 200;
+    std::string expected;
+    std::mutex mutex;
+    std::vector<int> completed;
+    for (int i = 0; i < kWrites; ++i) {
+        std::string text = std::to_string(i) + ";";
+        expected += text;
+        bool idle = queue->Push(
+            std::vector<uint8_t>(text.begin(), text.end()), [&, i](int error) {
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.push_back(error == 0 ? i : -1);
+            });
+        if (idle) reactor->Flush(pair.plugin_side);
+    }
+
+    std::string received(expected.size(), '\0');
+    ASSERT_EQ(RecvAll(pair.peer_side, &received[0], received.size()),
+              expected.size());
+    EXPECT_EQ(received, expected);
+
+    // The last completion may trail the bytes by a moment.
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    for (;;) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (completed.size() == kWrites || steady_clock::now() > deadline) {
+            break;
+        }
+    }
+    reactor->Remove(pair.plugin_side);
+    ASSERT_EQ(completed.size(), static_cast<size_t>(kWrites));
+    for (int i = 0; i < kWrites; ++i) EXPECT_EQ(completed[i], i);
+
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+// The buffers of a "writeBatch" reach each of their connections in order,
+// with one drainer started per connection, and the batch completes once,
+// after the last of them went out.
+TEST(IoReactor, WriteBatchSpansConnections) {
+    auto reactor = IoReactor::Create(4);
+    SocketPair pairs[2];
+    std::shared_ptr<WriteQueue> queues[2];
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_TRUE(MakeSocketPair(&pairs[i]));
+        queues[i] = std::make_shared<WriteQueue>();
+        ASSERT_TRUE(reactor->AddWriter(pairs[i].plugin_side, queues[i]));
+    }
+
+    constexpr int kBuffers = 100;
+    std::mutex mutex;
+    std::condition_variable finished;
+    int calls = 0;
+    int reported = -1;
+    auto batch = std::make_shared<WriteBatchCompletion>(
+        kBuffers, [&](int error) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++calls;
+            reported = error;
+            finished.notify_all();
+        });
+    std::string expected[2];
+    bool flush[2] = {false, false};
+    for (int i = 0; i < kBuffers; ++i) {
+        // Alternating, as with one id per buffer.
+        int connection = i % 2;
+        std::string text = std::to_string(i) + ";";
+        expected[connection] += text;
+        if (queues[connection]->Push(
+                std::vector<uint8_t>(text.begin(), text.end()),
+                [batch](int error) {
+                    if (batch->Complete(error)) batch->Finish();
+                })) {
+            flush[connection] = true;
+        }
+    }
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_TRUE(flush[i]);
+        reactor->Flush(pairs[i].plugin_side);
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        std::string received(expected[i].size(), '\0');
+        ASSERT_EQ(RecvAll(pairs[i].peer_side, &received[0], received.size()),
+                  expected[i].size());
+        EXPECT_EQ(received, expected[i]);
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait_for(lock, milliseconds(1000),
+                          [&]() { return calls > 0; });
+        EXPECT_EQ(calls, 1);
+        EXPECT_EQ(reported, 0);
+    }
+
+    for (auto& pair : pairs) {
+        reactor->Remove(pair.plugin_side);
+        CloseSocket(pair.plugin_side);
+        CloseSocket(pair.peer_side);
+    }
+}
+
+// A write larger than the socket buffers is queued without blocking the
+// caller and completes only once the peer has taken all of it.
+TEST(IoReactor, LargeWriteCompletesWhenTransportTakesIt) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    constexpr size_t kSize = 8 * 1024 * 1024;
+    std::vector<uint8_t> payload(kSize);
+    for (size_t i = 0; i < kSize; ++i) payload[i] = static_cast<uint8_t>(i);
+    std::atomic<int> result{-1};
+    auto start = steady_clock::now();
+    if (queue->Push(payload, [&](int error) { result = error; })) {
+        reactor->Flush(pair.plugin_side);
+    }
+    EXPECT_LT(steady_clock::now() - start, milliseconds(50));
+
+    std::this_thread::sleep_for(milliseconds(50));
+    EXPECT_EQ(result, -1);
+    EXPECT_GT(queue->GetStats().queued_bytes, 0u);
+
+    std::vector<uint8_t> received(kSize);
+    ASSERT_EQ(RecvAll(pair.peer_side, received.data(), kSize), kSize);
+    EXPECT_EQ(received, payload);
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    while (result == -1 && steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(result, 0);
+    EXPECT_EQ(queue->GetStats().queued_bytes, 0u);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(IoReactor, RemoveFailsQueuedWrites) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    // Far more than the socket buffers hold while the peer reads nothing.
+    std::atomic<int> failed{0};
+    for (int i = 0; i < 16; ++i) {
+        bool idle = queue->Push(std::vector<uint8_t>(1024 * 1024),
+                                [&](int error) {
+                                    if (error != 0) ++failed;
+                                });
+        if (idle) reactor->Flush(pair.plugin_side);
+    }
+    std::this_thread::sleep_for(milliseconds(50));
+    reactor->Remove(pair.plugin_side);
+
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    while (failed == 0 && steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_GT(failed, 0);
+    EXPECT_EQ(queue->GetStats().queued_writes, 0u);
+
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(IoReactor, StopReadingKeepsWriting) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    Collector collector;
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, collector.Handler()));
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+    reactor->StopReading(pair.plugin_side);
+
+    std::string text = "still here";
+    if (queue->Push(std::vector<uint8_t>(text.begin(), text.end()),
+                    nullptr)) {
+        reactor->Flush(pair.plugin_side);
+    }
+    std::string received(text.size(), '\0');
+    ASSERT_EQ(RecvAll(pair.peer_side, &received[0], received.size()),
+              text.size());
+    EXPECT_EQ(received, text);
+
+    // And reading can start again.
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, collector.Handler()));
+    ASSERT_EQ(SendAll(pair.peer_side, "back", 4), 4);
+    EXPECT_TRUE(collector.WaitForSize(4, milliseconds(1000)));
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+// A send buffer far smaller than the writes forces short sends all the
+// time; every write still arrives whole and in order.
+TEST(IoReactor, ShortSendsResumeWithoutTruncation) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    int small = 4096;
+    setsockopt(pair.plugin_side, SOL_SOCKET, SO_SNDBUF,
+               reinterpret_cast<const char*>(&small), sizeof(small));
+    setsockopt(pair.peer_side, SOL_SOCKET, SO_RCVBUF,
+               reinterpret_cast<const char*>(&small), sizeof(small));
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    constexpr int kWrites = 500;
+    std::string expected;
+    std::atomic<int> completed{0};
+    std::atomic<int> failed{0};
+    for (int i = 0; i < kWrites; ++i) {
+        std::string text(1 + (i * 37) % 3000, static_cast<char>('a' + i % 26));
+        expected += text;
+        auto on_sent = [&](int error) {
+            if (error == 0) {
+                ++completed;
+            } else {
+                ++failed;
+            }
+        };
+        if (queue->Push(std::vector<uint8_t>(text.begin(), text.end()),
+                        on_sent)) {
+            reactor->Flush(pair.plugin_side);
+        }
+    }
+
+    // Read in odd sizes so the sender keeps finding the buffer part full.
+    std::string received;
+    std::vector<char> chunk(997);
+    while (received.size() < expected.size()) {
+        auto read = recv(pair.peer_side, chunk.data(),
+                         static_cast<int>(chunk.size()), 0);
+        ASSERT_GT(read, 0);
+        received.append(chunk.data(), static_cast<size_t>(read));
+    }
+    EXPECT_EQ(received.size(), expected.size());
+    EXPECT_TRUE(received == expected);
+
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    while (completed < kWrites && steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(completed, kWrites);
+    EXPECT_EQ(failed, 0);
+    EXPECT_EQ(queue->GetStats().bytes_sent, expected.size());
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+// Writes that queued up go out gathered, many per send call.
+TEST(IoReactor, GathersQueuedWritesIntoFewerSends) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    constexpr int kWrites = 1024;
+    constexpr size_t kSize = 64;
+    bool idle = false;
+    for (int i = 0; i < kWrites; ++i) {
+        idle |= queue->Push(std::vector<uint8_t>(kSize, 'g'), nullptr);
+    }
+    ASSERT_TRUE(idle);
+    reactor->Flush(pair.plugin_side);
+
+    std::string received(kWrites * kSize, '\0');
+    ASSERT_EQ(RecvAll(pair.peer_side, &received[0], received.size()),
+              received.size());
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    while (queue->GetStats().writes_completed < kWrites &&
+           steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    WriteQueueStats stats = queue->GetStats();
+    EXPECT_EQ(stats.writes_completed, static_cast<uint64_t>(kWrites));
+    // One send per write without gathering.
+    EXPECT_LE(stats.sends, static_cast<uint64_t>(kWrites / 8));
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+// Small writes pushed back to back go out as one send once the window
+// closes; a full buffer goes out right away.
+TEST(IoReactor, CoalescesSmallWrites) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    auto queue = std::make_shared<WriteQueue>();
+    WriteCoalescing coalescing;
+    coalescing.max_bytes = 64;
+    coalescing.max_delay = std::chrono::microseconds(20000);
+    queue->SetCoalescing(coalescing);
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    std::atomic<int> completed{0};
+    auto push = [&](const std::string& text) {
+        if (queue->Push(std::vector<uint8_t>(text.begin(), text.end()),
+                        [&](int error) {
+                            if (error == 0) ++completed;
+                        })) {
+            reactor->Flush(pair.plugin_side);
+        }
+    };
+    auto start = steady_clock::now();
+    std::string expected;
+    for (int i = 0; i < 10; ++i) {
+        std::string text = "cmd" + std::to_string(i) + ";";
+        expected += text;
+        push(text);
+    }
+    std::string received(expected.size(), '\0');
+    ASSERT_EQ(RecvAll(pair.peer_side, &received[0], received.size()),
+              expected.size());
+    EXPECT_EQ(received, expected);
+    EXPECT_GE(steady_clock::now() - start, milliseconds(15));
+
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    while (completed < 10 && steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    WriteQueueStats stats = queue->GetStats();
+    EXPECT_EQ(stats.writes_completed, 10u);
+    EXPECT_EQ(stats.writes_merged, 9u);
+    EXPECT_EQ(stats.holds, 1u);
+    EXPECT_GE(stats.max_hold_time, std::chrono::microseconds(15000));
+
+    // Filling the buffer cuts the hold short.
+    start = steady_clock::now();
+    push(std::string(32, 'a'));
+    push(std::string(32, 'b'));
+    received.assign(64, '\0');
+    ASSERT_EQ(RecvAll(pair.peer_side, &received[0], received.size()), 64u);
+    EXPECT_EQ(received, std::string(32, 'a') + std::string(32, 'b'));
+    EXPECT_LT(steady_clock::now() - start, milliseconds(15));
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+// A control write overtakes a queued bulk upload at the next write boundary.
+TEST(IoReactor, HighPriorityWriteOvertakesBulk) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    int small = 4096;
+    setsockopt(pair.plugin_side, SOL_SOCKET, SO_SNDBUF,
+               reinterpret_cast<const char*>(&small), sizeof(small));
+    setsockopt(pair.peer_side, SOL_SOCKET, SO_RCVBUF,
+               reinterpret_cast<const char*>(&small), sizeof(small));
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    constexpr int kBulkWrites = 64;
+    constexpr size_t kBulkSize = 64 * 1024;
+    for (int i = 0; i < kBulkWrites; ++i) {
+        if (queue->Push(std::vector<uint8_t>(kBulkSize, 'b'), nullptr)) {
+            reactor->Flush(pair.plugin_side);
+        }
+    }
+
+    const std::string control = "STOP";
+    std::string received;
+    size_t received_at_push = 0;
+    std::vector<char> chunk(4096);
+    size_t total = kBulkWrites * kBulkSize + control.size();
+    while (received.size() < total) {
+        if (received_at_push == 0 && received.size() >= 2 * kBulkSize) {
+            received_at_push = received.size();
+            if (queue->Push(std::vector<uint8_t>(control.begin(),
+                                                 control.end()),
+                            nullptr, WritePriority::kHigh)) {
+                reactor->Flush(pair.plugin_side);
+            }
+        }
+        auto read = recv(pair.peer_side, chunk.data(),
+                         static_cast<int>(chunk.size()), 0);
+        ASSERT_GT(read, 0);
+        received.append(chunk.data(), static_cast<size_t>(read));
+    }
+
+    // Behind at most the write that was going out and those already handed
+    // to the transport with it, and never inside one.
+    size_t at = received.find(control);
+    ASSERT_NE(at, std::string::npos);
+    EXPECT_LT(at, received_at_push + 2 * kBulkSize);
+    EXPECT_EQ(at % kBulkSize, 0u);
+
+    WriteQueueStats stats = queue->GetStats();
+    const auto& high = stats.latency[static_cast<size_t>(WritePriority::kHigh)];
+    const auto& normal =
+        stats.latency[static_cast<size_t>(WritePriority::kNormal)];
+    EXPECT_EQ(high.count, 1u);
+    EXPECT_EQ(normal.count, static_cast<uint64_t>(kBulkWrites));
+    EXPECT_LT(high.max, normal.max);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+// Paced writes reach the peer at the configured rate, not faster.
+TEST(IoReactor, RateLimitHoldsConfiguredRate) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    auto queue = std::make_shared<WriteQueue>();
+    WriteRateLimit limit;
+    limit.bytes_per_second = 200 * 1024;
+    // Half a burst, 5 ms, absorbs a late wakeup on a loaded machine.
+    limit.burst_bytes = 2 * 1024;
+    queue->SetRateLimit(limit);
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    constexpr size_t kTotal = 62 * 1024;
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < kTotal / 512; ++i) {
+        if (queue->Push(std::vector<uint8_t>(512, 'p'), nullptr)) {
+            reactor->Flush(pair.plugin_side);
+        }
+    }
+    std::string received(kTotal, '\0');
+    ASSERT_EQ(RecvAll(pair.peer_side, &received[0], received.size()), kTotal);
+    auto elapsed = steady_clock::now() - start;
+
+    // The first burst goes out at once, the other 60 KiB at the rate.
+    auto expected = milliseconds(300);
+    EXPECT_GT(elapsed, expected * 9 / 10);
+    EXPECT_LT(elapsed, expected * 11 / 10);
+    // Measured once the drainer found the queue empty.
+    WriteQueueStats stats = queue->GetStats();
+    auto deadline = steady_clock::now() + milliseconds(1000);
+    while (stats.achieved_rate == 0 && steady_clock::now() < deadline) {
+        std::this_thread::yield();
+        stats = queue->GetStats();
+    }
+    EXPECT_GT(stats.throttles, 0u);
+    EXPECT_GT(stats.achieved_rate, limit.bytes_per_second * 9 / 10);
+    EXPECT_LT(stats.achieved_rate, limit.bytes_per_second * 11 / 10);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+// The peer never reads: the write that started fails once its deadline
+// passed, and so does everything behind it.
+TEST(IoReactor, WriteDeadlineFiresAgainstStalledPeer) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::vector<int> errors;
+    steady_clock::time_point failed_at;
+    auto record = [&](int error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (errors.empty()) failed_at = steady_clock::now();
+        errors.push_back(error);
+        done.notify_all();
+    };
+
+    constexpr auto kTimeout = milliseconds(300);
+    auto start = steady_clock::now();
+    auto deadline = start + kTimeout;
+    if (queue->Push(std::vector<uint8_t>(4 * 1024 * 1024, 's'), record,
+                    WritePriority::kNormal, deadline)) {
+        reactor->Flush(pair.plugin_side);
+    }
+    reactor->WatchDeadline(pair.plugin_side, deadline);
+    queue->Push(std::vector<uint8_t>(16, 't'), record);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(done.wait_for(lock, milliseconds(2000),
+                                  [&]() { return errors.size() == 2; }));
+        EXPECT_EQ(errors, (std::vector<int>{kWriteTimedOut, kWriteTimedOut}));
+        auto elapsed = failed_at - start;
+        EXPECT_GT(elapsed, kTimeout * 9 / 10);
+        EXPECT_LT(elapsed, kTimeout * 11 / 10);
+    }
+    WriteQueueStats stats = queue->GetStats();
+    EXPECT_EQ(stats.timeouts, 1u);
+    EXPECT_TRUE(stats.timed_out);
+    EXPECT_GT(stats.bytes_sent, 0u);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+// A write that times out before it started is dropped, and the link
+// carries on once the peer reads again.
+TEST(IoReactor, UnsentWriteTimesOutAndLinkCarriesOn) {
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    auto queue = std::make_shared<WriteQueue>();
+    ASSERT_TRUE(reactor->AddWriter(pair.plugin_side, queue));
+
+    // More than the socket buffers hold while the peer reads nothing.
+    constexpr size_t kBulk = 4 * 1024 * 1024;
+    std::atomic<int> bulk_error{-1};
+    if (queue->Push(std::vector<uint8_t>(kBulk, 'b'),
+                    [&](int error) { bulk_error = error; })) {
+        reactor->Flush(pair.plugin_side);
+    }
+    std::mutex mutex;
+    std::condition_variable done;
+    int error = -1;
+    steady_clock::time_point failed_at;
+    constexpr auto kTimeout = milliseconds(200);
+    auto start = steady_clock::now();
+    auto deadline = start + kTimeout;
+    queue->Push(
+        std::vector<uint8_t>(16, 'u'),
+        [&](int e) {
+            std::lock_guard<std::mutex> lock(mutex);
+            failed_at = steady_clock::now();
+            error = e;
+            done.notify_all();
+        },
+        WritePriority::kNormal, deadline);
+    reactor->WatchDeadline(pair.plugin_side, deadline);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(done.wait_for(lock, milliseconds(2000),
+                                  [&]() { return error != -1; }));
+        EXPECT_EQ(error, kWriteTimedOut);
+        auto elapsed = failed_at - start;
+        EXPECT_GT(elapsed, kTimeout * 9 / 10);
+        EXPECT_LT(elapsed, kTimeout * 11 / 10);
+    }
+    EXPECT_EQ(bulk_error, -1);
+
+    // Only the bulk write arrives, whole, and later writes go through.
+    std::atomic<int> next_error{-1};
+    if (queue->Push(std::vector<uint8_t>(1, 'n'),
+                    [&](int e) { next_error = e; })) {
+        reactor->Flush(pair.plugin_side);
+    }
+    std::string received(kBulk + 1, '\0');
+    ASSERT_EQ(RecvAll(pair.peer_side, &received[0], received.size()),
+              received.size());
+    EXPECT_EQ(received, std::string(kBulk, 'b') + "n");
+    auto wait_until = steady_clock::now() + milliseconds(1000);
+    while (next_error == -1 && steady_clock::now() < wait_until) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(bulk_error, 0);
+    EXPECT_EQ(next_error, 0);
+    EXPECT_FALSE(queue->GetStats().timed_out);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+TEST(IoReactor, RunsTimersInDeadlineOrder) {
+    auto reactor = IoReactor::Create();
+    std::mutex mutex;
+    std::condition_variable done;
+    std::string order;
+
+    auto record = [&](char tag) {
+        return [&, tag]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            order += tag;
+            done.notify_all();
+        };
+    };
+    auto start = steady_clock::now();
+    reactor->RunAfter(std::chrono::microseconds(20000), record('c'));
+    reactor->RunAfter(std::chrono::microseconds(2000), record('a'));
+    reactor->RunAfter(std::chrono::microseconds(10000), record('b'));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(done.wait_for(lock, milliseconds(1000),
+                              [&]() { return order.size() == 3; }));
+    EXPECT_EQ(order, "abc");
+    EXPECT_GE(steady_clock::now() - start, milliseconds(20));
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,150 @@
+#include "receive_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "io_reactor.h"
+#include "socket_pair.h"
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+std::vector<uint8_t> Bytes(const std::string& text) {
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+std::string Drain(ReceiveBuffer* buffer) {
+    std::vector<uint8_t> out;
+    buffer->ReadAll(&out);
+    return std::string(out.begin(), out.end());
+}
+
+}  // namespace
+
+TEST(ReceiveBuffer, ParsesDartPolicyNames) {
+    OverflowPolicy policy;
+    ASSERT_TRUE(ParseOverflowPolicy("dropOldest", &policy));
+    EXPECT_EQ(policy, OverflowPolicy::kDropOldest);
+    ASSERT_TRUE(ParseOverflowPolicy("disconnect", &policy));
+    EXPECT_EQ(policy, OverflowPolicy::kDisconnect);
+    EXPECT_FALSE(ParseOverflowPolicy("dropAll", &policy));
+}
+
+TEST(ReceiveBuffer, DropNewestKeepsWhatFits) {
+    ReceiveBuffer buffer(8, OverflowPolicy::kDropNewest);
+    auto data = Bytes("0123456789");
+    EXPECT_TRUE(buffer.Store(data.data(), data.size()));
+
+    EXPECT_EQ(Drain(&buffer), "01234567");
+    ReceiveBufferStats stats = buffer.GetStats();
+    EXPECT_EQ(stats.overflow_count, 1u);
+    EXPECT_EQ(stats.dropped_bytes, 2u);
+}
+
+TEST(ReceiveBuffer, DropOldestKeepsLatestBytes) {
+    ReceiveBuffer buffer(8, OverflowPolicy::kDropOldest);
+    auto first = Bytes("abcdef");
+    auto second = Bytes("ghij");
+    EXPECT_TRUE(buffer.Store(first.data(), first.size()));
+    EXPECT_TRUE(buffer.Store(second.data(), second.size()));
+
+    EXPECT_EQ(Drain(&buffer), "cdefghij");
+    EXPECT_EQ(buffer.GetStats().dropped_bytes, 2u);
+}
+
+TEST(ReceiveBuffer, DropOldestKeepsTailOfOversizedChunk) {
+    ReceiveBuffer buffer(8, OverflowPolicy::kDropOldest);
+    auto data = Bytes("0123456789AB");
+    EXPECT_TRUE(buffer.Store(data.data(), data.size()));
+
+    EXPECT_EQ(Drain(&buffer), "456789AB");
+    EXPECT_EQ(buffer.GetStats().dropped_bytes, 4u);
+}
+
+TEST(ReceiveBuffer, DisconnectReportsOverflowAndDropsTheRest) {
+    ReceiveBuffer buffer(8, OverflowPolicy::kDisconnect);
+    auto data = Bytes("012345");
+    EXPECT_TRUE(buffer.Store(data.data(), data.size()));
+    EXPECT_FALSE(buffer.Store(data.data(), data.size()));
+    EXPECT_FALSE(buffer.Store(data.data(), data.size()));
+
+    EXPECT_EQ(Drain(&buffer), "01234501");
+    ReceiveBufferStats stats = buffer.GetStats();
+    EXPECT_EQ(stats.overflow_count, 1u);
+    EXPECT_EQ(stats.dropped_bytes, 10u);
+}
+
+TEST(ReceiveBuffer, BackpressurePausesUntilDrained) {
+    ReceiveBuffer buffer(8, OverflowPolicy::kBackpressure);
+    EXPECT_EQ(buffer.ReadBudget(), 8u);
+    auto data = Bytes("01234567");
+    buffer.Store(data.data(), data.size());
+
+    EXPECT_EQ(buffer.ReadBudget(), 0u);
+    EXPECT_EQ(Drain(&buffer), "01234567");
+    EXPECT_TRUE(buffer.TakeResumeRequest());
+    EXPECT_FALSE(buffer.TakeResumeRequest());
+    EXPECT_EQ(buffer.ReadBudget(), 8u);
+}
+
+// End to end over a socket: a small buffer under backpressure must deliver
+// a much larger transfer intact, holding no more than its capacity.
+TEST(ReceiveBuffer, BackpressureThrottlesSocketWithoutLoss) {
+    constexpr size_t kCapacity = 4096;
+    auto reactor = IoReactor::Create();
+    SocketPair pair;
+    ASSERT_TRUE(MakeSocketPair(&pair));
+    ReceiveBuffer buffer(kCapacity, OverflowPolicy::kBackpressure);
+
+    IoHandler handler;
+    handler.read_budget = [&]() { return buffer.ReadBudget(); };
+    handler.on_data = [&](const uint8_t* data, size_t size) {
+        buffer.Store(data, size);
+    };
+    ASSERT_TRUE(reactor->Add(pair.plugin_side, std::move(handler)));
+
+    std::string payload(1024 * 1024, '\0');
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(i * 13);
+    }
+    std::thread writer(
+        [&]() { SendAll(pair.peer_side, payload.data(), payload.size()); });
+
+    // Let the writer run ahead until the reactor has to pause.
+    std::this_thread::sleep_for(milliseconds(50));
+    EXPECT_LE(buffer.Available(), kCapacity);
+
+    std::string received;
+    size_t max_buffered = 0;
+    auto deadline = steady_clock::now() + milliseconds(10000);
+    while (received.size() < payload.size() &&
+           steady_clock::now() < deadline) {
+        size_t buffered = buffer.Available();
+        if (buffered > max_buffered) max_buffered = buffered;
+        received += Drain(&buffer);
+        if (buffer.TakeResumeRequest()) reactor->Resume(pair.plugin_side);
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    writer.join();
+
+    EXPECT_EQ(received, payload);
+    EXPECT_LE(max_buffered, kCapacity);
+    EXPECT_EQ(buffer.GetStats().dropped_bytes, 0u);
+    EXPECT_GT(buffer.GetStats().overflow_count, 0u);
+
+    reactor->Remove(pair.plugin_side);
+    CloseSocket(pair.plugin_side);
+    CloseSocket(pair.peer_side);
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,68 @@
+#include "reconnect_backoff.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+namespace {
+
+using std::chrono::microseconds;
+
+ReconnectPolicy Policy(int64_t initial, int64_t max, int attempts) {
+    ReconnectPolicy policy;
+    policy.initial_delay = microseconds(initial);
+    policy.max_delay = microseconds(max);
+    policy.max_attempts = attempts;
+    return policy;
+}
+
+}  // namespace
+
+TEST(ReconnectBackoff, FirstAttemptGoesAtOnce) {
+    ReconnectBackoff backoff(Policy(1000, 8000, 0));
+    microseconds delay(-1);
+    ASSERT_TRUE(backoff.Next(&delay));
+    EXPECT_EQ(delay.count(), 0);
+    EXPECT_EQ(backoff.attempts(), 1);
+}
+
+TEST(ReconnectBackoff, DoublesWithJitterUpToMaximum) {
+    for (uint32_t seed = 0; seed < 20; ++seed) {
+        ReconnectBackoff backoff(Policy(1000, 8000, 0), seed);
+        microseconds delay;
+        backoff.Next(&delay);
+        for (int64_t ceiling : {1000, 2000, 4000, 8000, 8000, 8000}) {
+            ASSERT_TRUE(backoff.Next(&delay));
+            EXPECT_GE(delay.count(), ceiling / 2);
+            EXPECT_LE(delay.count(), ceiling);
+        }
+    }
+}
+
+TEST(ReconnectBackoff, JitterSpreadsDevicesApart) {
+    ReconnectBackoff first(Policy(1000000, 1000000, 0), 1);
+    ReconnectBackoff second(Policy(1000000, 1000000, 0), 2);
+    microseconds a;
+    microseconds b;
+    first.Next(&a);
+    second.Next(&b);
+    first.Next(&a);
+    second.Next(&b);
+    EXPECT_NE(a, b);
+}
+
+TEST(ReconnectBackoff, StopsAfterMaxAttempts) {
+    ReconnectBackoff backoff(Policy(1000, 8000, 3));
+    microseconds delay;
+    EXPECT_TRUE(backoff.Next(&delay));
+    EXPECT_TRUE(backoff.Next(&delay));
+    EXPECT_TRUE(backoff.Next(&delay));
+    EXPECT_FALSE(backoff.Next(&delay));
+    EXPECT_EQ(backoff.attempts(), 3);
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,108 @@
+#pragma once
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "io_reactor.h"
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+// A connected pair of stream sockets standing in for an RFCOMM link: the
+// plugin side is handed to the code under test, the peer side plays the
+// remote device.
+struct SocketPair {
+    NativeSocket plugin_side;
+    NativeSocket peer_side;
+};
+
+inline void CloseSocket(NativeSocket socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+#ifdef _WIN32
+
+// Windows has no socketpair(); build one over loopback TCP instead.
+inline bool MakeSocketPair(SocketPair* pair) {
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int length = sizeof(address);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address),
+                    &length) != 0 ||
+        listen(listener, 1) != 0) {
+        closesocket(listener);
+        return false;
+    }
+
+    SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (connect(client, reinterpret_cast<sockaddr*>(&address), length) != 0) {
+        closesocket(client);
+        closesocket(listener);
+        return false;
+    }
+    SOCKET server = accept(listener, nullptr, nullptr);
+    closesocket(listener);
+    if (server == INVALID_SOCKET) {
+        closesocket(client);
+        return false;
+    }
+
+    pair->plugin_side = client;
+    pair->peer_side = server;
+    return true;
+}
+
+#else
+
+inline bool MakeSocketPair(SocketPair* pair) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+    pair->plugin_side = fds[0];
+    pair->peer_side = fds[1];
+    return true;
+}
+
+#endif
+
+inline long SendAll(NativeSocket socket, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    size_t sent = 0;
+    while (sent < size) {
+        long result =
+            send(socket, bytes + sent, static_cast<int>(size - sent), 0);
+        if (result <= 0) return -1;
+        sent += static_cast<size_t>(result);
+    }
+    return static_cast<long>(sent);
+}
+
+// Reads until |size| bytes arrived; returns fewer if the socket closed.
+inline size_t RecvAll(NativeSocket socket, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    size_t received = 0;
+    while (received < size) {
+        long result = recv(socket, bytes + received,
+                           static_cast<int>(size - received), 0);
+        if (result <= 0) break;
+        received += static_cast<size_t>(result);
+    }
+    return received;
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
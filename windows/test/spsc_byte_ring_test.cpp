@@ -0,0 +1,137 @@
+#include "spsc_byte_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+TEST(SpscByteRing, RoundsCapacityUpToPowerOfTwo) {
+    SpscByteRing ring(1000);
+    EXPECT_EQ(ring.capacity(), 1024u);
+}
+
+TEST(SpscByteRing, ReadsBackWhatWasWritten) {
+    SpscByteRing ring(16);
+    const uint8_t input[] = {1, 2, 3, 4, 5};
+    EXPECT_EQ(ring.Write(input, sizeof(input)), sizeof(input));
+    EXPECT_EQ(ring.Available(), sizeof(input));
+
+    std::vector<uint8_t> output;
+    EXPECT_EQ(ring.ReadAll(&output), sizeof(input));
+    EXPECT_EQ(output, std::vector<uint8_t>(input, input + sizeof(input)));
+    EXPECT_EQ(ring.Available(), 0u);
+}
+
+TEST(SpscByteRing, AcceptsOnlyWhatFits) {
+    SpscByteRing ring(8);
+    const uint8_t input[12] = {};
+    EXPECT_EQ(ring.Write(input, sizeof(input)), 8u);
+    EXPECT_EQ(ring.Write(input, 1), 0u);
+
+    uint8_t output[3];
+    EXPECT_EQ(ring.Read(output, sizeof(output)), 3u);
+    EXPECT_EQ(ring.Write(input, sizeof(input)), 3u);
+}
+
+TEST(SpscByteRing, WrapsAroundTheEnd) {
+    SpscByteRing ring(8);
+    const uint8_t first[] = {1, 2, 3, 4, 5, 6};
+    const uint8_t second[] = {7, 8, 9, 10, 11};
+    uint8_t scratch[6];
+    ASSERT_EQ(ring.Write(first, sizeof(first)), sizeof(first));
+    ASSERT_EQ(ring.Read(scratch, sizeof(scratch)), sizeof(scratch));
+    ASSERT_EQ(ring.Write(second, sizeof(second)), sizeof(second));
+
+    std::vector<uint8_t> output;
+    ring.ReadAll(&output);
+    EXPECT_EQ(output, std::vector<uint8_t>(second, second + sizeof(second)));
+}
+
+TEST(SpscByteRing, ClearDropsBufferedBytes) {
+    SpscByteRing ring(8);
+    const uint8_t input[] = {1, 2, 3};
+    ring.Write(input, sizeof(input));
+    ring.Clear();
+    EXPECT_EQ(ring.Available(), 0u);
+    EXPECT_EQ(ring.Write(input, sizeof(input)), sizeof(input));
+}
+
+TEST(SpscByteRing, PreservesOrderAcrossThreads) {
+    constexpr size_t kTotal = 4 * 1024 * 1024;
+    SpscByteRing ring(4096);
+
+    std::thread producer([&]() {
+        uint8_t chunk[333];
+        size_t sent = 0;
+        while (sent < kTotal) {
+            size_t size = sizeof(chunk);
+            if (size > kTotal - sent) size = kTotal - sent;
+            for (size_t i = 0; i < size; ++i) {
+                chunk[i] = static_cast<uint8_t>((sent + i) * 7);
+            }
+            size_t offset = 0;
+            while (offset < size) {
+                size_t written = ring.Write(chunk + offset, size - offset);
+                if (written == 0) std::this_thread::yield();
+                offset += written;
+            }
+            sent += size;
+        }
+    });
+
+    size_t received = 0;
+    bool in_order = true;
+    std::vector<uint8_t> output;
+    while (received < kTotal) {
+        output.clear();
+        if (ring.ReadAll(&output) == 0) std::this_thread::yield();
+        for (uint8_t byte : output) {
+            in_order &= byte == static_cast<uint8_t>(received * 7);
+            ++received;
+        }
+    }
+    producer.join();
+
+    EXPECT_TRUE(in_order);
+    EXPECT_EQ(ring.Available(), 0u);
+}
+
+TEST(SpscByteRing, OverwritingProducerNeverTearsReads) {
+    constexpr size_t kTotal = 4 * 1024 * 1024;
+    constexpr int kPeriod = 251;
+    SpscByteRing ring(1024);
+
+    std::atomic<bool> done{false};
+    std::thread producer([&]() {
+        uint8_t chunk[100];
+        for (size_t sent = 0; sent < kTotal; sent += sizeof(chunk)) {
+            for (size_t i = 0; i < sizeof(chunk); ++i) {
+                chunk[i] = static_cast<uint8_t>((sent + i) % kPeriod);
+            }
+            ring.WriteOverwriting(chunk, sizeof(chunk));
+        }
+        done = true;
+    });
+
+    // Whatever survives, each read must be one contiguous run.
+    bool contiguous = true;
+    std::vector<uint8_t> output;
+    while (!done || ring.Available() > 0) {
+        output.clear();
+        if (ring.ReadAll(&output) == 0) std::this_thread::yield();
+        for (size_t i = 1; i < output.size(); ++i) {
+            contiguous &= output[i] == (output[i - 1] + 1) % kPeriod;
+        }
+    }
+    producer.join();
+
+    EXPECT_TRUE(contiguous);
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
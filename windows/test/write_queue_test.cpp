@@ -0,0 +1,593 @@
+#include "write_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+namespace test {
+
+namespace {
+
+std::vector<uint8_t> Bytes(const std::string& text) {
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+std::string Text(const WriteQueue::Span& span) {
+    return std::string(reinterpret_cast<const char*>(span.data), span.size);
+}
+
+}  // namespace
+
+TEST(WriteQueue, AsksForOneDrainerAtATime) {
+    WriteQueue queue;
+    EXPECT_TRUE(queue.Push(Bytes("a"), nullptr));
+    EXPECT_FALSE(queue.Push(Bytes("b"), nullptr));
+
+    WriteQueue::Span span;
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    queue.Consume(span.size);
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    // Still owned by the drainer until it finds the queue empty.
+    EXPECT_FALSE(queue.Push(Bytes("c"), nullptr));
+    queue.Consume(1);
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    queue.Consume(1);
+
+    EXPECT_EQ(queue.Peek(&span, 1), 0u);
+    EXPECT_TRUE(queue.Push(Bytes("d"), nullptr));
+}
+
+TEST(WriteQueue, PartialSendsCompleteWritesInOrder) {
+    WriteQueue queue;
+    std::vector<std::string> completed;
+    queue.Push(Bytes("hello"), [&](int error) {
+        EXPECT_EQ(error, 0);
+        completed.push_back("hello");
+    });
+    queue.Push(Bytes("world"), [&](int error) {
+        EXPECT_EQ(error, 0);
+        completed.push_back("world");
+    });
+
+    WriteQueue::Span spans[4];
+    ASSERT_EQ(queue.Peek(spans, 4), 2u);
+    EXPECT_EQ(Text(spans[0]), "hello");
+    EXPECT_EQ(Text(spans[1]), "world");
+
+    // The transport took "hel", then "lo" and "wo".
+    queue.Consume(3);
+    EXPECT_TRUE(completed.empty());
+    ASSERT_EQ(queue.Peek(spans, 4), 2u);
+    EXPECT_EQ(Text(spans[0]), "lo");
+    queue.Consume(4);
+    EXPECT_EQ(completed, std::vector<std::string>{"hello"});
+    ASSERT_EQ(queue.Peek(spans, 4), 1u);
+    EXPECT_EQ(Text(spans[0]), "rld");
+    queue.Consume(3);
+    EXPECT_EQ(completed, (std::vector<std::string>{"hello", "world"}));
+}
+
+// A drainer that caps its sends gets no more than that per Peek(), and the
+// write cut short resumes where the last send stopped.
+TEST(WriteQueue, PeekStopsAtMaxBytes) {
+    WriteQueue queue;
+    queue.Push(Bytes("hello"), nullptr);
+    queue.Push(Bytes("world"), nullptr);
+
+    WriteQueue::Span spans[4];
+    ASSERT_EQ(queue.Peek(spans, 4, 7), 2u);
+    EXPECT_EQ(Text(spans[0]), "hello");
+    EXPECT_EQ(Text(spans[1]), "wo");
+    queue.Consume(7);
+    ASSERT_EQ(queue.Peek(spans, 4, 7), 1u);
+    EXPECT_EQ(Text(spans[0]), "rld");
+    queue.Consume(3);
+    EXPECT_EQ(queue.Peek(spans, 4, 7), 0u);
+}
+
+TEST(WriteQueue, CloseFailsQueuedAndLaterWrites) {
+    WriteQueue queue;
+    int first_error = 0;
+    queue.Push(Bytes("queued"), [&](int error) { first_error = error; });
+    queue.Close(42);
+    EXPECT_EQ(first_error, 42);
+
+    int later_error = 0;
+    EXPECT_FALSE(queue.Push(Bytes("late"), [&](int error) {
+        later_error = error;
+    }));
+    EXPECT_EQ(later_error, 42);
+
+    WriteQueue::Span span;
+    EXPECT_EQ(queue.Peek(&span, 1), 0u);
+}
+
+TEST(WriteQueue, SuspendedQueueKeepsUnsentWritesForNextLink) {
+    WriteQueue queue;
+    queue.SetResumable(true);
+    std::vector<int> errors(4, -1);
+    queue.Push(Bytes("abcd"), [&](int error) { errors[0] = error; });
+    queue.Push(Bytes("ef"), [&](int error) { errors[1] = error; });
+
+    WriteQueue::Span span;
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    queue.Consume(2);
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    // The link drops with "cd" in flight: the peer may hold part of it.
+    queue.Close(42);
+    EXPECT_EQ(errors, (std::vector<int>{42, -1, -1, -1}));
+
+    // Writes pushed between links wait without asking for a drainer.
+    EXPECT_FALSE(
+        queue.Push(Bytes("gh"), [&](int error) { errors[2] = error; }));
+    EXPECT_FALSE(queue.BeginDirectSend(8));
+    EXPECT_EQ(queue.Peek(&span, 1), 0u);
+    EXPECT_EQ(queue.GetStats().queued_bytes, 4u);
+
+    ASSERT_TRUE(queue.Resume());
+    WriteQueue::Span spans[2];
+    ASSERT_EQ(queue.Peek(spans, 2), 2u);
+    EXPECT_EQ(Text(spans[0]), "ef");
+    EXPECT_EQ(Text(spans[1]), "gh");
+    queue.Consume(4);
+    EXPECT_EQ(errors, (std::vector<int>{42, 0, 0, -1}));
+
+    // Given up on: what is held fails with the error of the drop.
+    queue.Close(7);
+    queue.Push(Bytes("ij"), [&](int error) { errors[3] = error; });
+    queue.SetResumable(false);
+    EXPECT_EQ(errors[3], 7);
+    EXPECT_FALSE(queue.Resume());
+}
+
+// Remove() of a socket with a send in flight leaves the Close() to the
+// aborted send's completion; Resume() waits for it.
+TEST(WriteQueue, ResumeWaitsForOldDrainer) {
+    WriteQueue queue;
+    queue.SetResumable(true);
+    int error = -1;
+    queue.Push(Bytes("abc"), [&](int e) { error = e; });
+    WriteQueue::Span span;
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+
+    std::thread old_drainer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        queue.Consume(3);
+        queue.Close(42);
+    });
+    EXPECT_FALSE(queue.Resume());
+    old_drainer.join();
+    EXPECT_EQ(error, 0);
+}
+
+TEST(WriteQueue, StatsTrackDepth) {
+    WriteQueue queue;
+    queue.Push(Bytes("abcd"), nullptr);
+    queue.Push(Bytes("ef"), nullptr);
+    WriteQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.queued_bytes, 6u);
+    EXPECT_EQ(stats.queued_writes, 2u);
+
+    queue.Consume(5);
+    stats = queue.GetStats();
+    EXPECT_EQ(stats.queued_bytes, 1u);
+    EXPECT_EQ(stats.queued_writes, 1u);
+    EXPECT_EQ(stats.bytes_sent, 5u);
+    EXPECT_EQ(stats.writes_completed, 1u);
+    EXPECT_EQ(stats.sends, 1u);
+}
+
+TEST(WriteQueue, DirectSendKeepsOrderWithConcurrentPushes) {
+    WriteQueue queue;
+    ASSERT_TRUE(queue.BeginDirectSend(6));
+    // Pushed while the caller sends; queued behind whatever it leaves.
+    EXPECT_FALSE(queue.Push(Bytes("later"), nullptr));
+    EXPECT_FALSE(queue.BeginDirectSend(1));
+
+    int result = -1;
+    // "dir" went out, "ect" did not.
+    EXPECT_TRUE(queue.EndDirectSend(3, Bytes("ect"),
+                                    [&](int error) { result = error; }));
+    EXPECT_EQ(result, -1);
+
+    WriteQueue::Span spans[2];
+    ASSERT_EQ(queue.Peek(spans, 2), 2u);
+    EXPECT_EQ(Text(spans[0]), "ect");
+    EXPECT_EQ(Text(spans[1]), "later");
+    queue.Consume(8);
+    EXPECT_EQ(result, 0);
+    EXPECT_EQ(queue.Peek(spans, 2), 0u);
+
+    // All of it at once: done on the spot, and the queue is idle again.
+    ASSERT_TRUE(queue.BeginDirectSend(4));
+    result = -1;
+    EXPECT_FALSE(queue.EndDirectSend(4, {}, [&](int error) {
+        result = error;
+    }));
+    EXPECT_EQ(result, 0);
+    EXPECT_TRUE(queue.Push(Bytes("next"), nullptr));
+
+    WriteQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.bytes_sent, 15u);
+    EXPECT_EQ(stats.bytes_sent_direct, 7u);
+    EXPECT_EQ(stats.writes_completed, 3u);
+}
+
+TEST(WriteQueue, HighPriorityGoesAheadAtWriteBoundary) {
+    WriteQueue queue;
+    std::vector<std::string> completed;
+    auto push = [&](const char* text, WritePriority priority) {
+        queue.Push(Bytes(text), [&completed, text](int error) {
+            EXPECT_EQ(error, 0);
+            completed.push_back(text);
+        }, priority);
+    };
+    push("bulk1", WritePriority::kNormal);
+    push("bulk2", WritePriority::kNormal);
+    push("bulk3", WritePriority::kNormal);
+
+    // bulk1 is with the transport, which only takes part of it.
+    WriteQueue::Span spans[4];
+    ASSERT_EQ(queue.Peek(spans, 1), 1u);
+    push("ping", WritePriority::kHigh);
+    push("stop", WritePriority::kHigh);
+    queue.Consume(2);
+
+    // The started write is finished first, then the urgent ones go out in
+    // their own order ahead of the rest.
+    ASSERT_EQ(queue.Peek(spans, 4), 4u);
+    EXPECT_EQ(Text(spans[0]), "lk1");
+    EXPECT_EQ(Text(spans[1]), "ping");
+    EXPECT_EQ(Text(spans[2]), "stop");
+    EXPECT_EQ(Text(spans[3]), "bulk2");
+    queue.Consume(16);
+    EXPECT_EQ(completed,
+              (std::vector<std::string>{"bulk1", "ping", "stop", "bulk2"}));
+
+    WriteQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.latency[static_cast<size_t>(WritePriority::kHigh)].count,
+              2u);
+    EXPECT_EQ(
+        stats.latency[static_cast<size_t>(WritePriority::kNormal)].count, 2u);
+}
+
+TEST(WriteQueue, HighPriorityIsNotHeldForCoalescing) {
+    WriteQueue queue;
+    WriteCoalescing coalescing;
+    coalescing.max_bytes = 64;
+    coalescing.max_delay = std::chrono::microseconds(1000000);
+    queue.SetCoalescing(coalescing);
+
+    EXPECT_TRUE(queue.Push(Bytes("a"), nullptr));
+    EXPECT_GT(queue.HoldTime().count(), 0);
+    // Wakes the held drainer and is not merged into the normal buffer.
+    EXPECT_TRUE(queue.Push(Bytes("!"), nullptr, WritePriority::kHigh));
+    EXPECT_EQ(queue.HoldTime().count(), 0);
+
+    WriteQueue::Span spans[2];
+    ASSERT_EQ(queue.Peek(spans, 2), 2u);
+    EXPECT_EQ(Text(spans[0]), "!");
+    EXPECT_EQ(Text(spans[1]), "a");
+}
+
+TEST(WriteQueue, LatencyHistogramBuckets) {
+    WriteLatencyHistogram histogram;
+    histogram.Record(std::chrono::microseconds(0));
+    histogram.Record(std::chrono::microseconds(1));
+    histogram.Record(std::chrono::microseconds(5));
+    histogram.Record(std::chrono::microseconds(100000000));
+    EXPECT_EQ(histogram.buckets[0], 1u);
+    EXPECT_EQ(histogram.buckets[1], 1u);
+    EXPECT_EQ(histogram.buckets[3], 1u);
+    EXPECT_EQ(histogram.buckets[WriteLatencyHistogram::kBuckets - 1], 1u);
+    EXPECT_EQ(histogram.count, 4u);
+    EXPECT_EQ(histogram.max.count(), 100000000);
+}
+
+TEST(WriteQueue, RateLimitPacesSends) {
+    WriteQueue queue;
+    WriteRateLimit limit;
+    limit.bytes_per_second = 1000;
+    limit.burst_bytes = 100;
+    queue.SetRateLimit(limit);
+    // Paced writes always go through the queue.
+    EXPECT_FALSE(queue.BeginDirectSend(300));
+
+    EXPECT_TRUE(queue.Push(std::vector<uint8_t>(300, 'r'), nullptr));
+    // A full burst is there from the start, and no send is larger.
+    EXPECT_EQ(queue.HoldTime().count(), 0);
+    WriteQueue::Span span;
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    EXPECT_EQ(span.size, 100u);
+    queue.Consume(span.size);
+
+    // The drainer comes back once half a burst accrued, 50 ms later...
+    auto wait = queue.HoldTime();
+    EXPECT_GT(wait, std::chrono::microseconds(45000));
+    EXPECT_LE(wait, std::chrono::microseconds(50000));
+    std::this_thread::sleep_for(wait);
+    EXPECT_EQ(queue.HoldTime().count(), 0);
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    EXPECT_GE(span.size, 50u);
+    EXPECT_LT(span.size, 100u);
+    queue.Consume(span.size);
+
+    // ...and a late one finds a larger share, up to a full burst.
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_EQ(queue.HoldTime().count(), 0);
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    EXPECT_EQ(span.size, 100u);
+
+    WriteQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.rate_limit, 1000u);
+    EXPECT_EQ(stats.rate_burst, 100u);
+    EXPECT_EQ(stats.throttles, 1u);
+    EXPECT_GE(stats.throttle_time, wait);
+}
+
+TEST(WriteQueue, ExpireDropsWritesThatDidNotStart) {
+    WriteQueue queue;
+    auto soon = WriteQueue::Clock::now() + std::chrono::seconds(1);
+    auto later = soon + std::chrono::seconds(10);
+    std::vector<int> errors(3, -1);
+    EXPECT_TRUE(queue.Push(Bytes("abc"), [&](int error) { errors[0] = error; },
+                           WritePriority::kNormal, soon));
+    queue.Push(Bytes("def"), [&](int error) { errors[1] = error; });
+    queue.Push(Bytes("ghi"), [&](int error) { errors[2] = error; },
+               WritePriority::kNormal, later);
+    EXPECT_TRUE(queue.ArmExpiry(soon));
+    // Due after an expiry that is still pending anyway.
+    EXPECT_FALSE(queue.ArmExpiry(later));
+
+    WriteQueue::Clock::time_point rearm;
+    EXPECT_FALSE(queue.Expire(soon, &rearm));
+    EXPECT_EQ(errors, (std::vector<int>{kWriteTimedOut, -1, -1}));
+    EXPECT_EQ(rearm, later);
+
+    // The queue carries on with the others.
+    WriteQueue::Span spans[2];
+    ASSERT_EQ(queue.Peek(spans, 2), 2u);
+    EXPECT_EQ(Text(spans[0]), "def");
+    EXPECT_EQ(Text(spans[1]), "ghi");
+    queue.Consume(6);
+    EXPECT_EQ(errors, (std::vector<int>{kWriteTimedOut, 0, 0}));
+
+    WriteQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.timeouts, 1u);
+    EXPECT_FALSE(stats.timed_out);
+    EXPECT_EQ(stats.queued_bytes, 0u);
+}
+
+TEST(WriteQueue, ExpireCutsMergedWrites) {
+    WriteQueue queue;
+    WriteCoalescing coalescing;
+    coalescing.max_bytes = 64;
+    coalescing.max_delay = std::chrono::microseconds(0);
+    queue.SetCoalescing(coalescing);
+    auto now = WriteQueue::Clock::now();
+    std::vector<int> errors(3, -1);
+    queue.Push(Bytes("abc"), [&](int error) { errors[0] = error; });
+    queue.Push(Bytes("def"), [&](int error) { errors[1] = error; },
+               WritePriority::kNormal, now + std::chrono::seconds(1));
+    queue.Push(Bytes("ghi"), [&](int error) { errors[2] = error; });
+
+    // Merged into one buffer, of which the first write goes out.
+    WriteQueue::Span span;
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    EXPECT_EQ(Text(span), "abcdefghi");
+    queue.Consume(3);
+    EXPECT_EQ(errors[0], 0);
+
+    // Its neighbour's bytes are cut out of the buffer.
+    WriteQueue::Clock::time_point rearm;
+    EXPECT_FALSE(queue.Expire(now + std::chrono::seconds(1), &rearm));
+    EXPECT_EQ(errors[1], kWriteTimedOut);
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    EXPECT_EQ(Text(span), "ghi");
+    queue.Consume(3);
+    EXPECT_EQ(errors[2], 0);
+}
+
+TEST(WriteQueue, ExpireOfStartedWriteClosesQueue) {
+    WriteQueue queue;
+    auto now = WriteQueue::Clock::now();
+    std::vector<int> errors(2, -1);
+    queue.Push(Bytes("abcdef"), [&](int error) { errors[0] = error; },
+               WritePriority::kNormal, now);
+    queue.Push(Bytes("ghi"), [&](int error) { errors[1] = error; });
+
+    WriteQueue::Span span;
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    queue.Consume(2);
+
+    // Half sent: the rest cannot be dropped without corrupting the stream.
+    WriteQueue::Clock::time_point rearm;
+    EXPECT_TRUE(queue.Expire(now, &rearm));
+    EXPECT_EQ(errors, (std::vector<int>{kWriteTimedOut, kWriteTimedOut}));
+    EXPECT_EQ(queue.Peek(&span, 1), 0u);
+
+    int later_error = -1;
+    EXPECT_FALSE(queue.Push(Bytes("j"),
+                            [&](int error) { later_error = error; }));
+    EXPECT_EQ(later_error, kWriteTimedOut);
+    WriteQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.timeouts, 1u);
+    EXPECT_TRUE(stats.timed_out);
+}
+
+TEST(WriteQueue, ExpireLeavesSpansInFlightToConsume) {
+    WriteQueue queue;
+    auto now = WriteQueue::Clock::now();
+    int error = -1;
+    queue.Push(Bytes("abc"), [&](int e) { error = e; },
+               WritePriority::kNormal, now);
+
+    // The transport holds the span: it must stay valid.
+    WriteQueue::Span span;
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    WriteQueue::Clock::time_point rearm;
+    EXPECT_TRUE(queue.Expire(now, &rearm));
+    EXPECT_EQ(error, -1);
+    EXPECT_EQ(Text(span), "abc");
+
+    // The cancelled send ends in Consume() (or Close()).
+    queue.Consume(0);
+    EXPECT_EQ(error, kWriteTimedOut);
+    EXPECT_EQ(queue.Peek(&span, 1), 0u);
+}
+
+TEST(WriteQueue, TakeBufferReusesCompletedWrites) {
+    WriteQueue queue;
+    EXPECT_EQ(queue.TakeBuffer().capacity(), 0u);
+
+    std::vector<uint8_t> data(1024, 'x');
+    const uint8_t* storage = data.data();
+    queue.Push(std::move(data), nullptr);
+    WriteQueue::Span span;
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    queue.Consume(span.size);
+
+    // The next write fills the storage of the one that completed.
+    std::vector<uint8_t> buffer = queue.TakeBuffer();
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.data(), storage);
+    EXPECT_GE(buffer.capacity(), 1024u);
+    EXPECT_EQ(queue.TakeBuffer().capacity(), 0u);
+}
+
+TEST(WriteQueue, CoalescingMergesWithinThreshold) {
+    WriteQueue queue;
+    WriteCoalescing coalescing;
+    coalescing.max_bytes = 8;
+    coalescing.max_delay = std::chrono::microseconds(1000000);
+    queue.SetCoalescing(coalescing);
+
+    std::vector<std::string> completed;
+    for (const char* text : {"ab", "cd", "ef", "ghij"}) {
+        queue.Push(Bytes(text), [&completed, text](int error) {
+            EXPECT_EQ(error, 0);
+            completed.push_back(text);
+        });
+    }
+    // 10 bytes queued: a full buffer, so no hold.
+    EXPECT_EQ(queue.HoldTime().count(), 0);
+
+    WriteQueue::Span spans[4];
+    ASSERT_EQ(queue.Peek(spans, 4), 2u);
+    EXPECT_EQ(Text(spans[0]), "abcdef");
+    EXPECT_EQ(Text(spans[1]), "ghij");
+
+    // Writes inside a merged buffer still complete one by one.
+    queue.Consume(3);
+    EXPECT_EQ(completed, std::vector<std::string>{"ab"});
+    queue.Consume(7);
+    EXPECT_EQ(completed,
+              (std::vector<std::string>{"ab", "cd", "ef", "ghij"}));
+
+    WriteQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.writes_completed, 4u);
+    EXPECT_EQ(stats.writes_merged, 2u);
+}
+
+TEST(WriteQueue, HoldsUntilThresholdOrDeadline) {
+    WriteQueue queue;
+    WriteCoalescing coalescing;
+    coalescing.max_bytes = 8;
+    coalescing.max_delay = std::chrono::microseconds(20000);
+    queue.SetCoalescing(coalescing);
+
+    EXPECT_TRUE(queue.Push(Bytes("abc"), nullptr));
+    auto hold = queue.HoldTime();
+    EXPECT_GT(hold.count(), 0);
+    EXPECT_LE(hold, coalescing.max_delay);
+    EXPECT_FALSE(queue.Push(Bytes("de"), nullptr));
+    // Full now: the held drainer is asked back, once.
+    EXPECT_TRUE(queue.Push(Bytes("fgh"), nullptr));
+    EXPECT_FALSE(queue.Push(Bytes("i"), nullptr));
+    EXPECT_EQ(queue.HoldTime().count(), 0);
+
+    WriteQueue::Span span;
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    EXPECT_EQ(Text(span), "abcdefgh");
+    queue.Consume(span.size);
+
+    // The leftover byte waits out the window.
+    EXPECT_GT(queue.HoldTime().count(), 0);
+    std::this_thread::sleep_for(coalescing.max_delay);
+    EXPECT_EQ(queue.HoldTime().count(), 0);
+    ASSERT_EQ(queue.Peek(&span, 1), 1u);
+    EXPECT_EQ(Text(span), "i");
+
+    WriteQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.holds, 2u);
+    EXPECT_GE(stats.max_hold_time, coalescing.max_delay);
+}
+
+TEST(WriteBatchCompletion, FinishesAfterLastWithFirstError) {
+    int calls = 0;
+    int reported = -1;
+    WriteBatchCompletion batch(3, [&](int error) {
+        ++calls;
+        reported = error;
+    });
+    EXPECT_FALSE(batch.Complete(0));
+    EXPECT_FALSE(batch.Complete(5));
+    EXPECT_TRUE(batch.Complete(7));
+    EXPECT_EQ(calls, 0);
+    batch.Finish();
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(reported, 5);
+}
+
+// The writes of a batch complete on the workers of their connections, and
+// exactly one of them sees it was the last.
+TEST(WriteBatchCompletion, OneLastAmongConcurrentCompletions) {
+    constexpr int kThreads = 8;
+    constexpr int kWritesPerThread = 1000;
+    WriteBatchCompletion batch(kThreads * kWritesPerThread, nullptr);
+    std::atomic<int> lasts{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < kWritesPerThread; ++j) {
+                if (batch.Complete(0)) ++lasts;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(lasts, 1);
+}
+
+// A batch across two queues reports the error of the one that closed, once
+// the other one's writes completed too.
+TEST(WriteBatchCompletion, SpansQueues) {
+    WriteQueue first;
+    WriteQueue second;
+    int reported = -1;
+    auto batch = std::make_shared<WriteBatchCompletion>(
+        3, [&](int error) { reported = error; });
+    auto on_sent = [batch](int error) {
+        if (batch->Complete(error)) batch->Finish();
+    };
+    first.Push(Bytes("a"), on_sent);
+    second.Push(Bytes("b"), on_sent);
+    first.Push(Bytes("c"), on_sent);
+
+    second.Close(42);
+    EXPECT_EQ(reported, -1);
+    WriteQueue::Span span;
+    ASSERT_EQ(first.Peek(&span, 1), 1u);
+    first.Consume(span.size);
+    ASSERT_EQ(first.Peek(&span, 1), 1u);
+    first.Consume(span.size);
+    EXPECT_EQ(reported, 42);
+}
+
+}  // namespace test
+}  // namespace bluetooth_classic_multiplatform
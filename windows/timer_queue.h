@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+
+// Deadline-ordered queue of one-shot tasks. The reactor backends own one and
+// wait on the OS until NextDeadline(), then run whatever TakeExpired() hands
+// back.
+class TimerQueue {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    // Returns true if the new task is now the earliest one, i.e. the caller
+    // has to re-arm its OS timer.
+    bool Add(Clock::time_point deadline, std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool earliest = timers_.empty() || deadline < timers_.top().deadline;
+        timers_.push(Timer{deadline, sequence_++, std::move(task)});
+        return earliest;
+    }
+
+    // Pops every task due at |now|, in deadline order.
+    std::vector<std::function<void()>> TakeExpired(Clock::time_point now) {
+        std::vector<std::function<void()>> expired;
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!timers_.empty() && timers_.top().deadline <= now) {
+            expired.push_back(std::move(timers_.top().task));
+            timers_.pop();
+        }
+        return expired;
+    }
+
+    // Returns false when no task is pending.
+    bool NextDeadline(Clock::time_point* deadline) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (timers_.empty()) return false;
+        *deadline = timers_.top().deadline;
+        return true;
+    }
+
+   private:
+    struct Timer {
+        Clock::time_point deadline;
+        // Keeps tasks with equal deadlines in submission order.
+        uint64_t sequence;
+        // Mutable so the task can be moved out of priority_queue::top().
+        mutable std::function<void()> task;
+
+        bool operator>(const Timer& other) const {
+            if (deadline != other.deadline) return deadline > other.deadline;
+            return sequence > other.sequence;
+        }
+    };
+
+    std::mutex mutex_;
+    uint64_t sequence_ = 0;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>>
+        timers_;
+};
+
+}  // namespace bluetooth_classic_multiplatform
@@ -0,0 +1,618 @@
+#include "write_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace bluetooth_classic_multiplatform {
+
+namespace {
+
+// Storage of finished writes kept for TakeBuffer(); larger buffers are
+// freed, so an occasional big write does not stay pinned.
+constexpr size_t kMaxSpareBuffers = 8;
+constexpr size_t kMaxSpareCapacity = 64 * 1024;
+
+size_t Index(WritePriority priority) {
+    return static_cast<size_t>(priority);
+}
+
+// Spells of sending achieved_rate is measured over: a full second, or a
+// shorter one that ended, but not one too short to say much.
+constexpr std::chrono::seconds kRateWindow(1);
+constexpr std::chrono::milliseconds kMinRateWindow(100);
+
+// Rounded up, so a drainer does not come back a little too early.
+std::chrono::microseconds WaitTime(std::chrono::steady_clock::duration left) {
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(left);
+    if (wait < left) ++wait;
+    return wait;
+}
+
+}  // namespace
+
+bool ParseWritePriority(const std::string& name, WritePriority* priority) {
+    if (name == "normal") {
+        *priority = WritePriority::kNormal;
+    } else if (name == "high") {
+        *priority = WritePriority::kHigh;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool WriteBatchCompletion::Complete(int error) {
+    int no_error = 0;
+    if (error != 0) error_.compare_exchange_strong(no_error, error);
+    return --left_ == 0;
+}
+
+void WriteLatencyHistogram::Record(std::chrono::microseconds latency) {
+    size_t bucket = 0;
+    for (auto micros = latency.count(); micros > 0 && bucket + 1 < kBuckets;
+         micros >>= 1) {
+        ++bucket;
+    }
+    ++buckets[bucket];
+    ++count;
+    total += latency;
+    if (latency > max) max = latency;
+}
+
+void WriteQueue::SetCoalescing(const WriteCoalescing& coalescing) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    coalescing_ = coalescing;
+}
+
+void WriteQueue::SetRateLimit(const WriteRateLimit& limit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rate_limit_ = limit;
+    if (rate_limit_.burst_bytes == 0) rate_limit_.burst_bytes = 1;
+    tokens_ = static_cast<double>(rate_limit_.burst_bytes);
+    tokens_updated_ = Clock::now();
+}
+
+std::vector<uint8_t> WriteQueue::TakeBuffer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spare_buffers_.empty()) return {};
+    std::vector<uint8_t> buffer = std::move(spare_buffers_.back());
+    spare_buffers_.pop_back();
+    buffer.clear();
+    return buffer;
+}
+
+bool WriteQueue::Push(std::vector<uint8_t> data, WriteCallback on_sent,
+                      WritePriority priority, Clock::time_point deadline) {
+    int error = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) {
+            error = close_error_;
+        } else if (!data.empty()) {
+            bool high = priority == WritePriority::kHigh;
+            queued_bytes_ += data.size();
+            if (high) queued_high_priority_bytes_ += data.size();
+            Entry entry;
+            entry.priority = priority;
+            entry.queued_at = Clock::now();
+            entry.parts.push_back(Part{data.size(), std::move(on_sent),
+                                       entry.queued_at, deadline});
+            entry.data = std::move(data);
+            size_t at = high ? HighPriorityPositionLocked() : entries_.size();
+            entries_.insert(entries_.begin() + at, std::move(entry));
+            // Held for the next link.
+            if (suspended_) return false;
+            if (draining_) {
+                // A held drainer is woken early once a full buffer or a
+                // high-priority write is in.
+                if (holding_ && !wake_requested_ &&
+                    (high || queued_bytes_ >= coalescing_.max_bytes)) {
+                    wake_requested_ = true;
+                    return true;
+                }
+                return false;
+            }
+            draining_ = true;
+            return true;
+        }
+    }
+    // Nothing to send, or nowhere to send it.
+    if (on_sent) on_sent(error);
+    return false;
+}
+
+bool WriteQueue::BeginDirectSend(size_t size, WritePriority priority) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_ || suspended_ || draining_ || !entries_.empty() ||
+        size < coalescing_.max_bytes || rate_limit_.bytes_per_second != 0) {
+        return false;
+    }
+    draining_ = true;
+    direct_priority_ = priority;
+    direct_started_ = Clock::now();
+    return true;
+}
+
+bool WriteQueue::EndDirectSend(size_t sent, std::vector<uint8_t> rest,
+                               WriteCallback on_sent,
+                               Clock::time_point deadline) {
+    int error = 0;
+    bool flush = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bytes_sent_ += sent;
+        bytes_sent_direct_ += sent;
+        if (sent > 0) {
+            ++sends_;
+            MeasureRateLocked(Clock::now(), sent);
+        }
+        if (closed_ || suspended_) {
+            // Close() came in meanwhile; a write it never saw fails here,
+            // as a started one does on a suspended queue.
+            if (!rest.empty()) error = closed_ ? close_error_ : suspend_error_;
+        } else if (!rest.empty()) {
+            queued_bytes_ += rest.size();
+            if (direct_priority_ == WritePriority::kHigh) {
+                queued_high_priority_bytes_ += rest.size();
+            }
+            Entry entry;
+            entry.started = true;
+            entry.priority = direct_priority_;
+            entry.queued_at = Clock::now();
+            entry.parts.push_back(Part{rest.size(), std::move(on_sent),
+                                       direct_started_, deadline});
+            entry.data = std::move(rest);
+            entries_.push_front(std::move(entry));
+            return true;
+        } else {
+            ++writes_completed_;
+            latency_[Index(direct_priority_)].Record(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - direct_started_));
+            // Writes pushed meanwhile still need a drainer.
+            flush = !entries_.empty();
+            draining_ = flush;
+        }
+    }
+    if (on_sent) on_sent(error);
+    return flush;
+}
+
+std::chrono::microseconds WriteQueue::HoldTime() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Clock::time_point now = Clock::now();
+    Clock::duration throttle = ThrottleTimeLocked(now);
+    if (throttle > Clock::duration::zero()) return WaitTime(throttle);
+    // Never holds back the rest of a buffer the transport already started,
+    // nor a high-priority write.
+    if (coalescing_.max_bytes == 0 || closed_ || entries_.empty() ||
+        entries_.front().sent > 0 || entries_.front().started ||
+        queued_high_priority_bytes_ > 0 ||
+        queued_bytes_ >= coalescing_.max_bytes) {
+        EndHoldLocked(now);
+        return std::chrono::microseconds(0);
+    }
+    Clock::duration left =
+        entries_.front().queued_at + coalescing_.max_delay - now;
+    if (left <= Clock::duration::zero()) {
+        EndHoldLocked(now);
+        return std::chrono::microseconds(0);
+    }
+    if (!holding_) {
+        holding_ = true;
+        wake_requested_ = false;
+    }
+    return WaitTime(left);
+}
+
+size_t WriteQueue::Peek(Span* spans, size_t max_spans, size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t budget = std::max<size_t>(1, max_bytes);
+    if (rate_limit_.bytes_per_second != 0) {
+        // HoldTime() waited for the tokens; at least a byte goes out, so
+        // the drainer never takes an empty Peek() for an empty queue.
+        budget = std::min(
+            budget, std::max<size_t>(1, static_cast<size_t>(tokens_)));
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < entries_.size() && count < max_spans && budget > 0;
+         ++i) {
+        // Once Expire() closed the queue, what is left there only waits for
+        // the drainer's Consume(); a suspended one waits for a new link.
+        if (closed_ || suspended_) break;
+        // No span of an earlier Peek() is in use any more, so unsent
+        // buffers may still grow.
+        if (coalescing_.max_bytes != 0 && entries_[i].sent == 0) {
+            MergeLocked(i);
+        }
+        const Entry& entry = entries_[i];
+        size_t size = std::min(entry.data.size() - entry.sent, budget);
+        spans[count++] = Span{entry.data.data() + entry.sent, size};
+        budget -= size;
+    }
+    in_flight_ = count;
+    if (count == 0) {
+        draining_ = false;
+        EndRateWindowLocked(Clock::now());
+    }
+    return count;
+}
+
+void WriteQueue::Consume(size_t bytes) {
+    std::vector<WriteCallback> completed;
+    std::deque<Entry> failed;
+    int error = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_ = 0;
+        if (closed_) {
+            // Close() already failed whatever these bytes belonged to, or
+            // Expire() left the writes of the spans to fail here.
+            failed.swap(entries_);
+            error = close_error_;
+            bytes = 0;
+        }
+        queued_bytes_ -= bytes;
+        bytes_sent_ += bytes;
+        Clock::time_point now = Clock::now();
+        if (bytes > 0) {
+            ++sends_;
+            MeasureRateLocked(now, bytes);
+        }
+        if (rate_limit_.bytes_per_second != 0) tokens_ -= bytes;
+        while (bytes > 0 && !entries_.empty()) {
+            Entry& entry = entries_.front();
+            size_t take = std::min(bytes, entry.data.size() - entry.sent);
+            entry.sent += take;
+            bytes -= take;
+            if (entry.priority == WritePriority::kHigh) {
+                queued_high_priority_bytes_ -= take;
+            }
+            // Parts complete as soon as their own bytes are out.
+            size_t done = 0;
+            while (done < entry.parts.size() &&
+                   entry.parts[done].end <= entry.sent) {
+                Part& part = entry.parts[done];
+                latency_[Index(entry.priority)].Record(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        now - part.queued_at));
+                completed.push_back(std::move(part.on_sent));
+                entry.parts_begin = part.end;
+                ++done;
+            }
+            entry.parts.erase(entry.parts.begin(), entry.parts.begin() + done);
+            writes_completed_ += done;
+            if (entry.sent < entry.data.size()) break;
+            RecycleLocked(std::move(entry.data));
+            entries_.pop_front();
+        }
+    }
+    // Outside the lock: callbacks may push more.
+    for (auto& on_sent : completed) {
+        if (on_sent) on_sent(0);
+    }
+    FailEntries(&failed, error);
+}
+
+bool WriteQueue::ArmExpiry(Clock::time_point deadline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Nothing times a suspended queue; Resume() has it armed anew.
+    return !closed_ && !suspended_ && ArmExpiryLocked(deadline, Clock::now());
+}
+
+bool WriteQueue::Expire(Clock::time_point now, Clock::time_point* rearm) {
+    std::vector<WriteCallback> expired;
+    std::deque<Entry> failed;
+    bool aborted = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        *rearm = Clock::time_point();
+        if (closed_) return false;
+        Clock::time_point next;
+        for (size_t i = 0; i < entries_.size() && !aborted;) {
+            Entry& entry = entries_[i];
+            size_t begin = entry.parts_begin;
+            size_t p = 0;
+            while (p < entry.parts.size()) {
+                Part& part = entry.parts[p];
+                if (part.deadline == Clock::time_point() ||
+                    part.deadline > now) {
+                    if (part.deadline != Clock::time_point() &&
+                        (next == Clock::time_point() || part.deadline < next)) {
+                        next = part.deadline;
+                    }
+                    begin = part.end;
+                    ++p;
+                    continue;
+                }
+                ++timeouts_;
+                // The transport may hold bytes of a write in flight.
+                if (i < in_flight_ || entry.sent > begin ||
+                    (entry.started && begin == 0)) {
+                    aborted = true;
+                    break;
+                }
+                size_t size = part.end - begin;
+                entry.data.erase(entry.data.begin() + begin,
+                                 entry.data.begin() + part.end);
+                for (size_t later = p + 1; later < entry.parts.size();
+                     ++later) {
+                    entry.parts[later].end -= size;
+                }
+                queued_bytes_ -= size;
+                if (entry.priority == WritePriority::kHigh) {
+                    queued_high_priority_bytes_ -= size;
+                }
+                expired.push_back(std::move(part.on_sent));
+                entry.parts.erase(entry.parts.begin() + p);
+            }
+            if (!aborted && entry.parts.empty()) {
+                // Every write of it expired unsent, so none was in flight.
+                RecycleLocked(std::move(entry.data));
+                entries_.erase(entries_.begin() + i);
+                continue;
+            }
+            ++i;
+        }
+        if (aborted) {
+            // Like Close(), except for the entries in flight: the
+            // transport may still read them until Consume().
+            closed_ = true;
+            close_error_ = kWriteTimedOut;
+            timed_out_ = true;
+            auto rest = entries_.begin() + in_flight_;
+            failed.assign(std::make_move_iterator(rest),
+                          std::make_move_iterator(entries_.end()));
+            entries_.erase(rest, entries_.end());
+            queued_bytes_ = 0;
+            queued_high_priority_bytes_ = 0;
+            draining_ = false;
+            holding_ = false;
+            expiry_armed_ = Clock::time_point();
+        } else if (next != Clock::time_point() &&
+                   ArmExpiryLocked(next, now)) {
+            *rearm = next;
+        }
+    }
+    for (auto& on_sent : expired) {
+        if (on_sent) on_sent(kWriteTimedOut);
+    }
+    FailEntries(&failed, kWriteTimedOut);
+    return aborted;
+}
+
+void WriteQueue::Close(int error) {
+    std::deque<Entry> failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (resumable_ && !closed_) {
+            if (!suspended_) {
+                suspended_ = true;
+                suspend_error_ = error;
+            }
+            error = suspend_error_;
+            std::deque<Entry> kept;
+            queued_bytes_ = 0;
+            queued_high_priority_bytes_ = 0;
+            for (size_t i = 0; i < entries_.size(); ++i) {
+                Entry& entry = entries_[i];
+                if (i < in_flight_ || entry.sent > 0 || entry.started) {
+                    failed.push_back(std::move(entry));
+                    continue;
+                }
+                queued_bytes_ += entry.data.size();
+                if (entry.priority == WritePriority::kHigh) {
+                    queued_high_priority_bytes_ += entry.data.size();
+                }
+                kept.push_back(std::move(entry));
+            }
+            entries_.swap(kept);
+            EndRateWindowLocked(Clock::now());
+        } else {
+            if (!closed_) {
+                closed_ = true;
+                close_error_ = error;
+            }
+            error = close_error_;
+            failed.swap(entries_);
+            queued_bytes_ = 0;
+            queued_high_priority_bytes_ = 0;
+        }
+        in_flight_ = 0;
+        draining_ = false;
+        holding_ = false;
+        suspended_changed_.notify_all();
+    }
+    FailEntries(&failed, error);
+}
+
+void WriteQueue::SetResumable(bool resumable) {
+    int error = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        resumable_ = resumable;
+        if (resumable || !suspended_) return;
+        error = suspend_error_;
+    }
+    Close(error);
+}
+
+bool WriteQueue::Resume() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    suspended_changed_.wait(lock, [this]() { return suspended_ || closed_; });
+    if (closed_) return false;
+    suspended_ = false;
+    expiry_armed_ = Clock::time_point();
+    if (entries_.empty()) return false;
+    draining_ = true;
+    return true;
+}
+
+WriteQueueStats WriteQueue::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    WriteQueueStats stats;
+    stats.queued_bytes = queued_bytes_;
+    for (const Entry& entry : entries_) {
+        stats.queued_writes += entry.parts.size();
+    }
+    stats.bytes_sent = bytes_sent_;
+    stats.writes_completed = writes_completed_;
+    stats.sends = sends_;
+    stats.bytes_sent_direct = bytes_sent_direct_;
+    stats.writes_merged = writes_merged_;
+    stats.holds = holds_;
+    stats.hold_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(hold_time_);
+    stats.max_hold_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(max_hold_time_);
+    stats.rate_limit = rate_limit_.bytes_per_second;
+    stats.rate_burst =
+        rate_limit_.bytes_per_second != 0 ? rate_limit_.burst_bytes : 0;
+    stats.achieved_rate = achieved_rate_;
+    stats.throttles = throttles_;
+    stats.throttle_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(throttle_time_);
+    stats.timeouts = timeouts_;
+    stats.timed_out = timed_out_;
+    for (size_t i = 0; i < kWritePriorityCount; ++i) {
+        stats.latency[i] = latency_[i];
+    }
+    return stats;
+}
+
+size_t WriteQueue::HighPriorityPositionLocked() const {
+    size_t at = in_flight_;
+    if (at == 0 && !entries_.empty() &&
+        (entries_.front().sent > 0 || entries_.front().started)) {
+        at = 1;
+    }
+    while (at < entries_.size() &&
+           entries_[at].priority == WritePriority::kHigh) {
+        ++at;
+    }
+    return at;
+}
+
+void WriteQueue::MergeLocked(size_t index) {
+    while (index + 1 < entries_.size()) {
+        // Looked up each round: erasing from the middle of a deque
+        // invalidates references to its elements.
+        Entry& target = entries_[index];
+        Entry& next = entries_[index + 1];
+        if (next.priority != target.priority ||
+            target.data.size() + next.data.size() > coalescing_.max_bytes) {
+            break;
+        }
+        size_t offset = target.data.size();
+        target.data.insert(target.data.end(), next.data.begin(),
+                           next.data.end());
+        for (auto& part : next.parts) {
+            target.parts.push_back(Part{offset + part.end,
+                                        std::move(part.on_sent),
+                                        part.queued_at, part.deadline});
+        }
+        writes_merged_ += next.parts.size();
+        RecycleLocked(std::move(next.data));
+        entries_.erase(entries_.begin() + index + 1);
+    }
+}
+
+void WriteQueue::RecycleLocked(std::vector<uint8_t> data) {
+    if (spare_buffers_.size() < kMaxSpareBuffers &&
+        data.capacity() <= kMaxSpareCapacity) {
+        spare_buffers_.push_back(std::move(data));
+    }
+}
+
+bool WriteQueue::ArmExpiryLocked(Clock::time_point deadline,
+                                 Clock::time_point now) {
+    if (expiry_armed_ > now && expiry_armed_ <= deadline) return false;
+    expiry_armed_ = deadline;
+    return true;
+}
+
+// static
+void WriteQueue::FailEntries(std::deque<Entry>* entries, int error) {
+    for (auto& entry : *entries) {
+        for (auto& part : entry.parts) {
+            if (part.on_sent) part.on_sent(error);
+        }
+    }
+}
+
+void WriteQueue::EndHoldLocked(Clock::time_point now) {
+    if (!holding_) return;
+    holding_ = false;
+    if (entries_.empty()) return;
+    Clock::duration added = now - entries_.front().queued_at;
+    ++holds_;
+    hold_time_ += added;
+    if (added > max_hold_time_) max_hold_time_ = added;
+}
+
+WriteQueue::Clock::duration WriteQueue::ThrottleTimeLocked(
+    Clock::time_point now) {
+    bool waiting = rate_limit_.bytes_per_second != 0 && !closed_ &&
+                   !entries_.empty();
+    double needed = 0;
+    if (waiting) {
+        double rate = static_cast<double>(rate_limit_.bytes_per_second);
+        double burst = static_cast<double>(rate_limit_.burst_bytes);
+        double elapsed =
+            std::chrono::duration<double>(now - tokens_updated_).count();
+        tokens_ = std::min(burst, tokens_ + rate * elapsed);
+        tokens_updated_ = now;
+        // Half a burst, or all that is queued if that is less: the other
+        // half absorbs a late wakeup, which would otherwise overflow the
+        // bucket and cost rate.
+        needed = std::min(static_cast<double>(queued_bytes_),
+                          std::max(1.0, std::floor(burst / 2)));
+        waiting = tokens_ < needed;
+    }
+    if (!waiting) {
+        if (throttling_) {
+            throttling_ = false;
+            throttle_time_ += now - throttle_started_;
+        }
+        return Clock::duration::zero();
+    }
+    if (!throttling_) {
+        throttling_ = true;
+        throttle_started_ = now;
+        ++throttles_;
+    }
+    std::chrono::duration<double> left(
+        (needed - tokens_) / static_cast<double>(rate_limit_.bytes_per_second));
+    return std::chrono::duration_cast<Clock::duration>(left);
+}
+
+void WriteQueue::MeasureRateLocked(Clock::time_point now, size_t bytes) {
+    // A spell starts with a send; only the bytes after it took time.
+    if (rate_window_start_ == Clock::time_point()) {
+        rate_window_start_ = now;
+        rate_window_bytes_ = 0;
+        return;
+    }
+    rate_window_bytes_ += bytes;
+    if (now - rate_window_start_ < kRateWindow) return;
+    double seconds =
+        std::chrono::duration<double>(now - rate_window_start_).count();
+    achieved_rate_ = static_cast<uint64_t>(rate_window_bytes_ / seconds);
+    rate_window_start_ = now;
+    rate_window_bytes_ = 0;
+}
+
+void WriteQueue::EndRateWindowLocked(Clock::time_point now) {
+    if (rate_window_start_ == Clock::time_point()) return;
+    Clock::duration elapsed = now - rate_window_start_;
+    if (elapsed >= kMinRateWindow && rate_window_bytes_ > 0) {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        achieved_rate_ = static_cast<uint64_t>(rate_window_bytes_ / seconds);
+    }
+    rate_window_start_ = Clock::time_point();
+    rate_window_bytes_ = 0;
+}
+
+}  // namespace bluetooth_classic_multiplatform
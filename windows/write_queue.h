@@ -0,0 +1,348 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bluetooth_classic_multiplatform {
+
+// Completion of one queued write: 0 once every byte was handed to the
+// transport, otherwise the socket error that ended it.
+using WriteCallback = std::function<void(int error)>;
+
+// Error a write fails with once its deadline passed.
+#ifdef _WIN32
+constexpr int kWriteTimedOut = 10060;  // WSAETIMEDOUT
+#else
+constexpr int kWriteTimedOut = ETIMEDOUT;
+#endif
+
+// Optional batching of small writes. Off while max_bytes is 0.
+struct WriteCoalescing {
+    // Writes are merged into buffers of up to this many bytes, and the
+    // drainer holds off while less than this is queued...
+    size_t max_bytes = 0;
+    // ...but for no longer than this after the oldest waiting write came in.
+    std::chrono::microseconds max_delay{0};
+};
+
+// Optional pacing of outbound bytes, for peers that lose data when fed
+// faster than their link drains (a token bucket). Off while bytes_per_second
+// is 0.
+struct WriteRateLimit {
+    // Long-run rate the transport is fed at...
+    uint64_t bytes_per_second = 0;
+    // ...and the most it gets at once after a pause; also caps every send.
+    size_t burst_bytes = 0;
+};
+
+// Class of a write. High-priority writes go out ahead of every normal one
+// that has not started yet; a write that started is always finished first,
+// so writes never interleave on the link.
+enum class WritePriority { kNormal, kHigh };
+
+constexpr size_t kWritePriorityCount = 2;
+
+// Parses a Dart WritePriority name; false for an unknown one.
+bool ParseWritePriority(const std::string& name, WritePriority* priority);
+
+// Joins the completions of the writes of one "writeBatch" call, which may
+// span several connections and so several queues.
+class WriteBatchCompletion {
+   public:
+    WriteBatchCompletion(size_t writes, WriteCallback on_done)
+        : left_(writes), on_done_(std::move(on_done)) {}
+
+    // Counts a write of the batch that completed with |error|; any thread.
+    // True for the last one, after which Finish() is due.
+    bool Complete(int error);
+
+    // Runs the batch's callback with the first error any write had, 0 if
+    // none did.
+    void Finish() { on_done_(error_); }
+
+   private:
+    std::atomic<size_t> left_;
+    std::atomic<int> error_{0};
+    WriteCallback on_done_;
+};
+
+// Time from Push() until the last byte of a write was handed to the
+// transport, in power-of-two buckets: bucket 0 counts latencies below 1 us,
+// bucket i those from 2^(i-1) us up to 2^i us, and the last one everything
+// longer.
+struct WriteLatencyHistogram {
+    static constexpr size_t kBuckets = 24;
+
+    uint64_t count = 0;
+    std::chrono::microseconds total{0};
+    std::chrono::microseconds max{0};
+    uint64_t buckets[kBuckets] = {};
+
+    void Record(std::chrono::microseconds latency);
+};
+
+struct WriteQueueStats {
+    size_t queued_bytes = 0;
+    size_t queued_writes = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t writes_completed = 0;
+    // Transport calls that took bytes; one may carry several writes.
+    uint64_t sends = 0;
+    // Part of bytes_sent that went out straight from the caller's buffer.
+    uint64_t bytes_sent_direct = 0;
+    // Writes merged into the buffer of an earlier one; the merge ratio is
+    // writes_completed / (writes_completed - writes_merged).
+    uint64_t writes_merged = 0;
+    // Times the drainer held off, and the latency that added to the oldest
+    // write of each hold.
+    uint64_t holds = 0;
+    std::chrono::microseconds hold_time{0};
+    std::chrono::microseconds max_hold_time{0};
+    // The configured WriteRateLimit, 0 when off...
+    uint64_t rate_limit = 0;
+    size_t rate_burst = 0;
+    // ...the rate the transport actually took bytes at, over the last
+    // second of sending (or the last burst, if shorter)...
+    uint64_t achieved_rate = 0;
+    // ...and how often and how long the drainer waited for it.
+    uint64_t throttles = 0;
+    std::chrono::microseconds throttle_time{0};
+    // Writes that failed with kWriteTimedOut because their own deadline
+    // passed, and whether one of them had started, which aborted sending.
+    uint64_t timeouts = 0;
+    bool timed_out = false;
+    // Indexed by WritePriority.
+    WriteLatencyHistogram latency[kWritePriorityCount];
+};
+
+// Outbound data of one connection. Any thread pushes; the IoReactor drains
+// it from its workers, sending straight out of the pushed buffers. At most
+// one drainer runs at a time: the thread whose Push() found the queue idle
+// owns it until Peek() comes back empty, and only then does the next Push()
+// ask for a drainer again.
+class WriteQueue {
+   public:
+    // Bytes of one queued write not yet handed to the transport.
+    struct Span {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    WriteQueue() = default;
+
+    // Disallow copy and assign.
+    WriteQueue(const WriteQueue&) = delete;
+    WriteQueue& operator=(const WriteQueue&) = delete;
+
+    // Set before the first Push().
+    void SetCoalescing(const WriteCoalescing& coalescing);
+    // Set before the first Push(). Starts with a full burst.
+    void SetRateLimit(const WriteRateLimit& limit);
+
+    // An empty vector to fill for the next Push(). It reuses the storage of
+    // a completed write when one is spare, so a steady stream of writes
+    // does not allocate.
+    std::vector<uint8_t> TakeBuffer();
+
+    // Appends |data|, behind the writes of its class that are already
+    // queued; a high-priority write also goes ahead of every normal one
+    // that did not start yet. Returns true if the queue was idle, or a held
+    // queue just filled up or got a high-priority write, and the caller
+    // then has to start a drainer (IoReactor::Flush()); never while the
+    // queue is suspended. On a closed queue |on_sent| runs right away with
+    // the error the queue was closed with.
+    // A write with a |deadline| fails with kWriteTimedOut if it is not sent
+    // by then; see Expire().
+    bool Push(std::vector<uint8_t> data, WriteCallback on_sent,
+              WritePriority priority = WritePriority::kNormal,
+              Clock::time_point deadline = Clock::time_point());
+
+    // Fast path for a write of |size| bytes, which the caller may then send
+    // straight from its own buffer instead of copying it into the queue.
+    // Returns true if the queue was idle and empty (and not coalescing
+    // writes this small, nor pacing them); the caller is its drainer until
+    // EndDirectSend().
+    bool BeginDirectSend(size_t size,
+                         WritePriority priority = WritePriority::kNormal);
+
+    // Ends the fast path: |sent| bytes went out, |rest| did not and is
+    // queued in front of whatever was pushed meanwhile. |on_sent| runs right
+    // away if |rest| is empty. Returns true if the caller has to start a
+    // drainer for what is queued now, as after Push().
+    bool EndDirectSend(size_t sent, std::vector<uint8_t> rest,
+                       WriteCallback on_sent,
+                       Clock::time_point deadline = Clock::time_point());
+
+    // Drainer side, asked before each Peek(). Returns 0 to send now, or how
+    // long to wait for more writes to merge or, under a rate limit, for the
+    // bucket to refill; the drainer then keeps the queue but leaves it
+    // alone until that elapsed or Push() asks again. High-priority writes
+    // are never held for merging, but they are paced.
+    std::chrono::microseconds HoldTime();
+
+    // Drainer side. Fills up to |max_spans| spans with the unsent bytes from
+    // the front, in order, no more than |max_bytes| in all nor than a rate
+    // limit allows right now, and returns how many it filled. They stay
+    // valid until the next Peek() or Consume(). Returning 0 hands the queue
+    // back; the drainer must not touch it again until it is asked to.
+    size_t Peek(Span* spans, size_t max_spans, size_t max_bytes = SIZE_MAX);
+
+    // Drainer side, once per transport call, also one that took nothing.
+    // Marks |bytes| from the front as handed to the transport and completes
+    // the writes that are now whole; the next Peek() resumes right after
+    // them. Until then, high-priority writes queue behind the peeked spans.
+    void Consume(size_t bytes);
+
+    // Deadline side, after a Push() with |deadline|. Returns true if no
+    // earlier Expire() is due, and the caller then has to call Expire()
+    // once |deadline| passed.
+    bool ArmExpiry(Clock::time_point deadline);
+
+    // Deadline side. Fails the writes whose deadline passed by |now| with
+    // kWriteTimedOut. One that did not start yet is just dropped, and the
+    // queue carries on. Once one started, the link stopped taking data and
+    // the rest of it cannot be sent without corrupting the stream: the
+    // queue then closes with kWriteTimedOut, like Close(), and Expire()
+    // returns true so the caller aborts a send the transport still holds.
+    // Writes in the spans of such a send fail on the drainer's Consume().
+    // |rearm| gets the deadline to call Expire() at next, or stays unset.
+    bool Expire(Clock::time_point now, Clock::time_point* rearm);
+
+    // Fails every queued write with |error| and every later one too. Must
+    // not race with a drainer that still uses spans from Peek().
+    void Close(int error);
+
+    // Makes Close() suspend the queue instead, so a new link can take over
+    // its writes. A suspended queue fails the writes that started, as the
+    // peer may hold part of them, along with those merged into the same
+    // buffer; it keeps the others and takes later pushes, but asks for no
+    // drainer until Resume(). Turning it off closes a suspended queue with
+    // the error it was suspended with.
+    void SetResumable(bool resumable);
+
+    // Hands a suspended queue to a new link. Blocks until it is suspended,
+    // as the Close() of a send IoReactor::Remove() aborted may still be on
+    // its way. Returns true if the caller has to start a drainer, as after
+    // Push(); false with nothing queued or once the queue closed for good.
+    // The deadlines of the writes it held are not armed any more; an
+    // ArmExpiry() with the current time has them checked again.
+    bool Resume();
+
+    WriteQueueStats GetStats() const;
+
+   private:
+    // One pushed write inside an entry's buffer.
+    struct Part {
+        // Offset just past its last byte.
+        size_t end;
+        WriteCallback on_sent;
+        Clock::time_point queued_at;
+        // Unset for none.
+        Clock::time_point deadline;
+    };
+
+    // One buffer handed to the transport; several parts of the same class
+    // once merged.
+    struct Entry {
+        std::vector<uint8_t> data;
+        size_t sent = 0;
+        // The rest of a direct send: its write already started.
+        bool started = false;
+        // Offset where the first of |parts| starts; the bytes before it
+        // belong to writes that completed.
+        size_t parts_begin = 0;
+        WritePriority priority = WritePriority::kNormal;
+        std::vector<Part> parts;
+        Clock::time_point queued_at;
+    };
+
+    // Where a new high-priority entry goes: behind the entries in flight,
+    // a started one and the high-priority ones already queued.
+    size_t HighPriorityPositionLocked() const;
+    // Merges the unsent entries of its class after |index| into it, within
+    // max_bytes.
+    void MergeLocked(size_t index);
+    // Keeps the storage of a finished write for TakeBuffer().
+    void RecycleLocked(std::vector<uint8_t> data);
+    // Moves expiry_armed_ up to |deadline| unless an earlier one is still
+    // due after |now|; true if it did.
+    bool ArmExpiryLocked(Clock::time_point deadline, Clock::time_point now);
+    // Runs the callbacks of |entries| with |error|; outside the lock.
+    static void FailEntries(std::deque<Entry>* entries, int error);
+    // Records the hold that ends now, if there was one.
+    void EndHoldLocked(Clock::time_point now);
+    // How long until the bucket holds the next send; adds the tokens that
+    // accrued since the last call.
+    Clock::duration ThrottleTimeLocked(Clock::time_point now);
+    // Feeds achieved_rate a send of |bytes|...
+    void MeasureRateLocked(Clock::time_point now, size_t bytes);
+    // ...and the end of a spell of sending.
+    void EndRateWindowLocked(Clock::time_point now);
+
+    mutable std::mutex mutex_;
+    // std::deque keeps the buffers of queued entries in place while more are
+    // appended, so spans handed out stay valid.
+    std::deque<Entry> entries_;
+    std::vector<std::vector<uint8_t>> spare_buffers_;
+    size_t queued_bytes_ = 0;
+    size_t queued_high_priority_bytes_ = 0;
+    // Entries at the front whose spans the last Peek() handed out; they
+    // stay in place until the drainer's Consume().
+    size_t in_flight_ = 0;
+    // Class and start of the write of a direct send.
+    WritePriority direct_priority_ = WritePriority::kNormal;
+    Clock::time_point direct_started_;
+    bool draining_ = false;
+    bool closed_ = false;
+    int close_error_ = 0;
+    bool resumable_ = false;
+    // Suspended by Close() and the error it came with; Resume() waits for
+    // it.
+    bool suspended_ = false;
+    int suspend_error_ = 0;
+    std::condition_variable suspended_changed_;
+    // Deadline the caller was last asked to call Expire() at.
+    Clock::time_point expiry_armed_;
+    uint64_t timeouts_ = 0;
+    bool timed_out_ = false;
+    WriteCoalescing coalescing_;
+    // The drainer is holding off, and whether Push() already cut it short.
+    bool holding_ = false;
+    bool wake_requested_ = false;
+    uint64_t bytes_sent_ = 0;
+    uint64_t writes_completed_ = 0;
+    uint64_t sends_ = 0;
+    uint64_t bytes_sent_direct_ = 0;
+    uint64_t writes_merged_ = 0;
+    uint64_t holds_ = 0;
+    Clock::duration hold_time_{0};
+    Clock::duration max_hold_time_{0};
+    WriteLatencyHistogram latency_[kWritePriorityCount];
+    WriteRateLimit rate_limit_;
+    // Bytes that may be sent now; fractional so slow rates do not round
+    // away.
+    double tokens_ = 0;
+    Clock::time_point tokens_updated_;
+    bool throttling_ = false;
+    Clock::time_point throttle_started_;
+    uint64_t throttles_ = 0;
+    Clock::duration throttle_time_{0};
+    // Sending spell achieved_rate is measured over; unset while idle.
+    Clock::time_point rate_window_start_;
+    uint64_t rate_window_bytes_ = 0;
+    uint64_t achieved_rate_ = 0;
+};
+
+}  // namespace bluetooth_classic_multiplatform